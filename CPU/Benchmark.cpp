@@ -0,0 +1,953 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include "Benchmark.h"
+#include "FrameRecorder.h"
+#include "ImageDiff.h"
+#include "KernelAtlas.h"
+#include "PFM.h"
+#include "ProfileFitter.h"
+#include "ThreadPool.h"
+#include "TransmittanceCPU.h"
+#include "TransmittanceLUT.h"
+#include "Transpose.h"
+using namespace std;
+
+
+static double measure(const function<void()> &f, int repetitions) {
+    double best = numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; i++) {
+        chrono::high_resolution_clock::time_point t0 = chrono::high_resolution_clock::now();
+        f();
+        chrono::high_resolution_clock::time_point t1 = chrono::high_resolution_clock::now();
+        best = min(best, chrono::duration<double, milli>(t1 - t0).count());
+    }
+    return best;
+}
+
+
+SyntheticFrame::SyntheticFrame(int width, int height, float coverage, unsigned int seed) :
+        width(width), height(height),
+        color(4 * width * height),
+        depth(width * height),
+        strength(width * height),
+        stencil(width * height),
+        material(width * height) {
+    /**
+     * Heads are laid out in a 4x3 grid. All cells share the same shape, a
+     * disc clipped by the cell borders, whose radius is chosen so that the
+     * requested fraction of each cell gets covered.
+     */
+    const int CELLS_X = 4, CELLS_Y = 3;
+    int cellWidth = (width + CELLS_X - 1) / CELLS_X;
+    int cellHeight = (height + CELLS_Y - 1) / CELLS_Y;
+
+    vector<float> distances(cellWidth * cellHeight);
+    for (int y = 0; y < cellHeight; y++) {
+        for (int x = 0; x < cellWidth; x++) {
+            float dx = (x + 0.5f) / cellWidth - 0.5f;
+            float dy = (y + 0.5f) / cellHeight - 0.5f;
+            distances[y * cellWidth + x] = sqrt(dx * dx + dy * dy);
+        }
+    }
+    vector<float> sorted = distances;
+    size_t covered = size_t(max(0.0f, min(coverage, 1.0f)) * sorted.size());
+    float radius = 0.0f;
+    if (covered > 0) {
+        nth_element(sorted.begin(), sorted.begin() + (covered - 1), sorted.end());
+        radius = sorted[covered - 1];
+    }
+
+    unsigned int state = seed;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int i = y * width + x;
+            int cell = (y / cellHeight) * CELLS_X + x / cellWidth;
+            float d = distances[(y % cellHeight) * cellWidth + x % cellWidth];
+            bool skin = covered > 0 && d <= radius;
+
+            // Small pseudo-random variations, for some high frequency detail:
+            state = state * 1664525u + 1013904223u;
+            float noise = float(state >> 8) / float(1 << 24);
+
+            if (skin) {
+                float h = sqrt(max(0.0f, 1.0f - (d * d) / (radius * radius)));
+                depth[i] = 1.0f + 0.25f * float(cell % 5) - 0.1f * h;
+                color[4 * i + 0] = 0.6f + 0.3f * h + 0.1f * noise;
+                color[4 * i + 1] = 0.35f + 0.2f * h + 0.1f * noise;
+                color[4 * i + 2] = 0.25f + 0.15f * h + 0.1f * noise;
+                color[4 * i + 3] = 1.0f;
+                strength[i] = 1.0f;
+                stencil[i] = 1;
+                material[i] = (unsigned char) (cell % 4);
+            } else {
+                depth[i] = 50.0f;
+                color[4 * i + 0] = 0.1f + 0.2f * noise;
+                color[4 * i + 1] = 0.1f + 0.2f * noise;
+                color[4 * i + 2] = 0.15f + 0.2f * noise;
+                color[4 * i + 3] = 0.0f;
+                strength[i] = 0.0f;
+                stencil[i] = 0;
+                material[i] = 0;
+            }
+        }
+    }
+}
+
+
+bool SyntheticFrame::load(const string &prefix) {
+    int w[3], h[3], channels[3];
+    vector<float> rgb;
+    if (!PFM::load(prefix + "color.pfm", w[0], h[0], channels[0], rgb) ||
+        !PFM::load(prefix + "depth.pfm", w[1], h[1], channels[1], depth) ||
+        !PFM::load(prefix + "strength.pfm", w[2], h[2], channels[2], strength))
+        return false;
+    if (w[1] != w[0] || w[2] != w[0] || h[1] != h[0] || h[2] != h[0] ||
+        channels[0] != 3 || channels[1] != 1 || channels[2] != 1)
+        return false;
+
+    width = w[0];
+    height = h[0];
+    color.resize(4 * width * height);
+    stencil.resize(width * height);
+    material.assign(width * height, 0);
+    for (int i = 0; i < width * height; i++) {
+        color[4 * i + 0] = rgb[3 * i + 0];
+        color[4 * i + 1] = rgb[3 * i + 1];
+        color[4 * i + 2] = rgb[3 * i + 2];
+        color[4 * i + 3] = strength[i];
+        stencil[i] = strength[i] != 0.0f? 1 : 0;
+    }
+    return true;
+}
+
+
+bool SyntheticFrame::save(const string &prefix) const {
+    vector<float> rgb(3 * width * height);
+    for (int i = 0; i < width * height; i++) {
+        rgb[3 * i + 0] = color[4 * i + 0];
+        rgb[3 * i + 1] = color[4 * i + 1];
+        rgb[3 * i + 2] = color[4 * i + 2];
+    }
+    return PFM::save(prefix + "color.pfm", width, height, 3, &rgb.front()) &&
+           PFM::save(prefix + "depth.pfm", width, height, 1, &depth.front()) &&
+           PFM::save(prefix + "strength.pfm", width, height, 1, &strength.front());
+}
+
+
+double Benchmark::time(SeparableSSSCPU &sss, const SyntheticFrame &frame, int repetitions) {
+    vector<float> color;
+    vector<unsigned char> stencil;
+    double best = numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; i++) {
+        color = frame.color;
+        stencil = frame.stencil;
+
+        chrono::high_resolution_clock::time_point t0 = chrono::high_resolution_clock::now();
+        sss.go(&color.front(), &frame.depth.front(), &stencil.front(), &frame.strength.front(), 1);
+        chrono::high_resolution_clock::time_point t1 = chrono::high_resolution_clock::now();
+
+        best = min(best, chrono::duration<double, milli>(t1 - t0).count());
+    }
+    return best;
+}
+
+
+void Benchmark::backends(ostream &out, int repetitions) {
+    const int resolutions[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    const int samples[] = { 11, 17, 25 };
+    const BlurPass::Backend backends[] = { BlurPass::BACKEND_SCALAR,
+                                           BlurPass::BACKEND_SSE42,
+                                           BlurPass::BACKEND_AVX2,
+                                           BlurPass::BACKEND_AVX512 };
+
+    out << setprecision(2) << fixed;
+    for (int r = 0; r < 2; r++) {
+        SyntheticFrame frame(resolutions[r][0], resolutions[r][1], 1.0f);
+        for (int s = 0; s < 3; s++) {
+            SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, samples[s], true, true, true);
+
+            double scalar = 0.0;
+            for (int b = 0; b < 4; b++) {
+                if (!BlurPass::isSupported(backends[b]))
+                    continue;
+
+                sss.setBackend(backends[b]);
+                double t = time(sss, frame, repetitions);
+                if (backends[b] == BlurPass::BACKEND_SCALAR)
+                    scalar = t;
+
+                out << frame.width << "x" << frame.height << " : "
+                    << samples[s] << " samples : "
+                    << BlurPass::getName(backends[b]) << " : "
+                    << t << "ms : " << scalar / t << "x" << endl;
+            }
+        }
+    }
+}
+
+
+void Benchmark::scaling(ostream &out, int maxThreads, int repetitions) {
+    if (maxThreads <= 0)
+        maxThreads = max(1, int(thread::hardware_concurrency()));
+
+    SyntheticFrame frame(3840, 2160, 1.0f);
+    SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, 17, true, true, true);
+
+    out << setprecision(2) << fixed;
+    double single = 0.0;
+    for (int n = 1; ; n = min(2 * n, maxThreads)) {
+        ThreadPool pool(n);
+        sss.setThreadPool(&pool);
+        double t = time(sss, frame, repetitions);
+        if (n == 1)
+            single = t;
+
+        out << n << " threads : "
+            << t << "ms : " << single / t << "x : "
+            << int(100.0 * single / (t * n)) << "% efficiency" << endl;
+
+        if (n == maxThreads)
+            break;
+    }
+    sss.setThreadPool(NULL);
+}
+
+
+void Benchmark::streaming(ostream &out, int maxHeight, int repetitions) {
+    const int resolutions[][2] = { { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+
+    out << setprecision(2) << fixed;
+    for (int r = 0; r < 3 && resolutions[r][1] <= maxHeight; r++) {
+        SyntheticFrame frame(resolutions[r][0], resolutions[r][1], 1.0f);
+        SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, 17, true, true, true);
+
+        double regular = time(sss, frame, repetitions);
+        double regularSize = 4.0 * sizeof(float) * frame.width * frame.height;
+        sss.setStreaming(true);
+        double streamed = time(sss, frame, repetitions);
+        double streamedSize = double(sss.getStreamingScheduler().getBufferSize());
+
+        out << frame.width << "x" << frame.height << " : "
+            << "regular " << regular << "ms, " << regularSize / (1024.0 * 1024.0) << "MB : "
+            << "streaming " << streamed << "ms, " << streamedSize / (1024.0 * 1024.0) << "MB ("
+            << sss.getStreamingScheduler().getRingRows() << " rows) : "
+            << regular / streamed << "x" << endl;
+    }
+}
+
+
+void Benchmark::passes(ostream &out, int repetitions) {
+    SyntheticFrame frame(3840, 2160, 1.0f);
+    const int width = frame.width, height = frame.height;
+    const BlurPass::Backend backends[] = { BlurPass::BACKEND_SCALAR,
+                                           BlurPass::BACKEND_SSE42,
+                                           BlurPass::BACKEND_AVX2,
+                                           BlurPass::BACKEND_AVX512 };
+
+    vector<KernelSample> kernel;
+    Kernel::calculate(kernel, 17, Vector3(0.48f, 0.41f, 0.28f), Vector3(1.0f, 0.37f, 0.3f));
+
+    vector<float> color = frame.color, tmp(4 * width * height);
+    vector<float> depthT(width * height), strengthT(width * height);
+    vector<unsigned char> stencilT(width * height);
+
+    BlurPass x;
+    x.src = &color.front();
+    x.dst = &tmp.front();
+    x.depth = &frame.depth.front();
+    x.strength = &frame.strength.front();
+    x.stencil = &frame.stencil.front();
+    x.width = width;
+    x.height = height;
+    x.followSurface = true;
+    x.sssWidth = 0.012f;
+    x.distanceToProjectionWindow = 1.0f / tan(0.5f * 20.0f * 3.14159265f / 180.0f);
+    x.kernel = &kernel.front();
+    x.nSamples = int(kernel.size());
+
+    BlurPass y = x;
+    y.dir = BlurPass::VERTICAL;
+    y.src = &tmp.front();
+    y.dst = &color.front();
+
+    // The transposed versions:
+    BlurPass xt = x;
+    xt.dstTransposed = true;
+
+    BlurPass yt = y;
+    yt.dir = BlurPass::HORIZONTAL;
+    yt.width = height;
+    yt.height = width;
+    yt.depth = &depthT.front();
+    yt.strength = &strengthT.front();
+    yt.stencil = &stencilT.front();
+    yt.dstTransposed = true;
+
+    double transposition = measure([&] {
+        Transpose::run(&frame.depth.front(), &depthT.front(), width, height, 1, 0, 0, width, height);
+        Transpose::run(&frame.strength.front(), &strengthT.front(), width, height, 1, 0, 0, width, height);
+        Transpose::run(&frame.stencil.front(), &stencilT.front(), width, height, 1, 0, 0, width, height);
+    }, repetitions);
+
+    out << setprecision(2) << fixed;
+    for (int b = 0; b < 4; b++) {
+        BlurPass::Backend backend = backends[b];
+        if (!BlurPass::isSupported(backend))
+            continue;
+
+        double h = measure([&] { x.run(0, 0, width, height, backend); }, repetitions);
+        double v = measure([&] { y.run(0, 0, width, height, backend); }, repetitions);
+        double ht = measure([&] { xt.run(0, 0, width, height, backend); }, repetitions);
+        double vt = measure([&] { yt.run(0, 0, height, width, backend); }, repetitions);
+
+        out << BlurPass::getName(backend) << " : "
+            << "regular: horizontal " << h << "ms, vertical " << v << "ms ("
+            << int(100.0 * v / h) << "%) : "
+            << "transposed: horizontal " << ht << "ms, vertical " << vt << "ms ("
+            << int(100.0 * vt / h) << "%), inputs " << transposition << "ms" << endl;
+    }
+}
+
+
+void Benchmark::formats(ostream &out, int maxHeight, int repetitions) {
+    const int resolutions[][2] = { { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+    const PixelFormat::Format formats[] = { PixelFormat::FORMAT_RGBA32F,
+                                            PixelFormat::FORMAT_RGBA16F,
+                                            PixelFormat::FORMAT_RGBA8_SRGB };
+
+    out << setprecision(2) << fixed;
+    for (int r = 0; r < 3 && resolutions[r][1] <= maxHeight; r++) {
+        SyntheticFrame frame(resolutions[r][0], resolutions[r][1], 1.0f);
+
+        double full = 0.0;
+        vector<float> reference;
+        for (int f = 0; f < 3; f++) {
+            SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, 17, true, true, true, formats[f]);
+            double t = time(sss, frame, repetitions);
+            double size = double(PixelFormat::getSize(formats[f])) * frame.width * frame.height;
+
+            // Run it once more to compare the results against the full
+            // precision ones:
+            vector<float> color = frame.color;
+            vector<unsigned char> stencil = frame.stencil;
+            sss.go(&color.front(), &frame.depth.front(), &stencil.front(), &frame.strength.front(), 1);
+            if (f == 0) {
+                full = t;
+                reference = color;
+            }
+            float error = 0.0f;
+            for (size_t i = 0; i < color.size(); i++)
+                error = max(error, abs(color[i] - reference[i]));
+
+            out << frame.width << "x" << frame.height << " : "
+                << PixelFormat::getName(formats[f]) << " : "
+                << t << "ms : " << full / t << "x : "
+                << size / (1024.0 * 1024.0) << "MB : "
+                << "max error " << scientific << error << fixed << endl;
+        }
+    }
+}
+
+
+void Benchmark::kernels(ostream &out) {
+    const Vector3 strength(0.48f, 0.41f, 0.28f), falloff(1.0f, 0.37f, 0.3f);
+    const float scales[] = { 4.0f, 16.0f, 64.0f };
+    const Kernel::Placement placements[] = { Kernel::PLACEMENT_POWER,
+                                             Kernel::PLACEMENT_CDF_RED,
+                                             Kernel::PLACEMENT_CDF_MAX };
+
+    out << setprecision(4) << fixed;
+    for (int s = 0; s < 3; s++) {
+        for (int nSamples = 5; nSamples <= 33; nSamples += 2) {
+            out << int(scales[s]) << " pixels per unit : " << nSamples << " samples";
+            for (int p = 0; p < 3; p++) {
+                vector<KernelSample> kernel;
+                Kernel::calculate(kernel, nSamples, strength, falloff, placements[p]);
+                KernelError error = Kernel::measure(kernel, strength, falloff, scales[s]);
+                float maxError = max(error.max.x, max(error.max.y, error.max.z));
+                float rmsError = max(error.rms.x, max(error.rms.y, error.rms.z));
+                out << " : " << Kernel::getName(placements[p])
+                    << " max " << maxError << ", RMS " << rmsError;
+            }
+            out << endl;
+        }
+    }
+}
+
+
+
+void Benchmark::materials(ostream &out, int repetitions) {
+    const int resolutions[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    const Vector3 strengths[] = { Vector3(0.48f, 0.41f, 0.28f),
+                                  Vector3(0.55f, 0.45f, 0.3f),
+                                  Vector3(0.8f, 0.8f, 0.8f),
+                                  Vector3(0.7f, 0.6f, 0.4f) };
+    const Vector3 falloffs[] = { Vector3(1.0f, 0.37f, 0.3f),
+                                 Vector3(0.9f, 0.3f, 0.25f),
+                                 Vector3(0.6f, 0.6f, 0.6f),
+                                 Vector3(1.0f, 0.8f, 0.5f) };
+
+    KernelAtlas atlas;
+    for (int m = 0; m < 4; m++)
+        atlas.setProfile(m, 17, strengths[m], falloffs[m]);
+
+    out << setprecision(2) << fixed;
+    for (int r = 0; r < 2; r++) {
+        SyntheticFrame frame(resolutions[r][0], resolutions[r][1], 0.5f);
+        const int n = frame.width * frame.height;
+
+        // Mark each material with its own id (from 1 to 4) in the stencil:
+        vector<unsigned char> stencil(n);
+        for (int i = 0; i < n; i++)
+            stencil[i] = frame.stencil[i] != 0? frame.material[i] + 1 : 0;
+
+        SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, 17, true, true, true);
+        sss.setSparse(true);
+        vector<float> color;
+        double separate = measure([&] {
+            color = frame.color;
+            for (int m = 0; m < 4; m++) {
+                sss.setStrength(strengths[m]);
+                sss.setFalloff(falloffs[m]);
+                sss.go(&color.front(), &frame.depth.front(), &stencil.front(), &frame.strength.front(), m + 1);
+            }
+        }, repetitions);
+
+        sss.setKernelAtlas(&atlas);
+        double atlased = measure([&] {
+            color = frame.color;
+            sss.go(&color.front(), &frame.depth.front(), &frame.stencil.front(), &frame.strength.front(), 1, &frame.material.front());
+        }, repetitions);
+
+        out << frame.width << "x" << frame.height << " : "
+            << "one call per material " << separate << "ms : "
+            << "atlas " << atlased << "ms : "
+            << separate / atlased << "x" << endl;
+    }
+}
+
+
+void Benchmark::profiles(ostream &out, int nMaterials) {
+    vector<MeasuredProfile> measured(nMaterials);
+    unsigned int seed = 1;
+    for (int m = 0; m < nMaterials; m++) {
+        Vector3 falloff;
+        for (int c = 0; c < 3; c++) {
+            seed = seed * 1664525u + 1013904223u;
+            falloff[c] = 0.2f + 0.8f * float(seed >> 8) / float(1 << 24);
+        }
+
+        Profile profile = Profile::fromFalloff(falloff);
+        const float range = 0.5f * profile.getRange();
+        for (int i = 0; i < 64; i++) {
+            float r = range * float(i) / 63.0f;
+            measured[m].radii.push_back(r);
+            measured[m].values.push_back(profile.evaluate(r));
+        }
+    }
+
+    ProfileFitter fitter;
+    vector<Profile> fitted;
+    vector<Vector3> errors;
+    double single = measure([&] { fitter.fit(measured, fitted); }, 1);
+
+    ThreadPool pool;
+    fitter.setThreadPool(&pool);
+    double threaded = measure([&] { fitter.fit(measured, fitted, &errors); }, 1);
+
+    float worst = 0.0f;
+    for (int m = 0; m < nMaterials; m++)
+        worst = max(worst, max(errors[m].x, max(errors[m].y, errors[m].z)));
+
+    out << setprecision(2) << fixed;
+    out << nMaterials << " materials : "
+        << "1 thread " << single / 1000.0 << "s : "
+        << pool.getThreadCount() << " threads " << threaded / 1000.0 << "s : "
+        << scientific << "worst error " << worst << endl;
+}
+
+
+void Benchmark::transmittance(ostream &out, int repetitions) {
+    const int n = 1 << 22;
+    const Profile profile = Profile::skin();
+
+    // Same distribution of thicknesses as a thin slab, with most of them
+    // close to zero:
+    vector<float> d(n), r(n), g(n), b(n);
+    unsigned int seed = 1;
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        float u = float(seed >> 8) / float(1 << 24);
+        d[i] = 10.0f * u * u;
+    }
+
+    out << setprecision(2) << fixed;
+    const vector<Profile::Term> &terms = profile.getTerms();
+    double analytic = measure([&] {
+        for (int i = 0; i < n; i++) {
+            float dd = -d[i] * d[i];
+            float sum[3] = { 0.0f, 0.0f, 0.0f };
+            for (size_t k = 0; k < terms.size(); k++) {
+                float e = exp(dd / terms[k].variance.x); // Same variance for the three channels
+                sum[0] += terms[k].weight.x * e;
+                sum[1] += terms[k].weight.y * e;
+                sum[2] += terms[k].weight.z * e;
+            }
+            r[i] = sum[0];
+            g[i] = sum[1];
+            b[i] = sum[2];
+        }
+    }, repetitions);
+    out << "Analytic : " << analytic << "ms" << endl;
+
+    TransmittanceLUT lut;
+    lut.build(profile);
+    const BlurPass::Backend backends[] = { BlurPass::BACKEND_SCALAR, BlurPass::BACKEND_AVX2, BlurPass::BACKEND_AVX512 };
+    for (int k = 0; k < 3; k++) {
+        if (!BlurPass::isSupported(backends[k]))
+            continue;
+        double t = measure([&] { lut.evaluate(&d.front(), &r.front(), &g.front(), &b.front(), n, backends[k]); }, repetitions);
+        out << "LUT " << BlurPass::getName(backends[k]) << " : " << t << "ms : " << analytic / t << "x" << endl;
+    }
+
+    out << scientific;
+    for (int resolution = 64; resolution <= 1024; resolution *= 2) {
+        lut.build(profile, resolution);
+        Vector3 error = lut.getMaxError();
+        out << resolution << " entries : max error " << max(error.x, max(error.y, error.z)) << endl;
+    }
+}
+
+
+void Benchmark::relighting(ostream &out, int repetitions) {
+    const int width = 1920, height = 1080, n = width * height;
+    const int shadowSize = 1024, nLights = 5;
+
+    // A wavy surface facing the lights, with the shadow maps holding its
+    // depth as seen from them, plus some noise for the thickness:
+    vector<float> position(3 * n), normal(3 * n), color(4 * n);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int i = y * width + x;
+            float u = float(x) / float(width) - 0.5f, v = float(y) / float(height) - 0.5f;
+            position[3 * i + 0] = u;
+            position[3 * i + 1] = v;
+            position[3 * i + 2] = 0.02f * sin(40.0f * u) * cos(30.0f * v);
+            normal[3 * i + 0] = 0.0f;
+            normal[3 * i + 1] = 0.0f;
+            normal[3 * i + 2] = 1.0f;
+        }
+    }
+
+    vector<vector<float> > shadowMaps(nLights, vector<float>(shadowSize * shadowSize));
+    vector<TransmittanceCPU::Light> lights(nLights);
+    unsigned int seed = 1;
+    for (int l = 0; l < nLights; l++) {
+        for (int i = 0; i < shadowSize * shadowSize; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            shadowMaps[l][i] = 0.2f + 0.001f * float(seed >> 8) / float(1 << 24);
+        }
+
+        // Lights behind the surface, looking at it; the projection maps
+        // [-0.5, 0.5] to the texture and stores the linear depth:
+        TransmittanceCPU::Light &light = lights[l];
+        light.position = Vector3(0.1f * float(l - 2), 0.0f, -2.0f);
+        light.direction = Vector3(0.0f, 0.0f, 1.0f);
+        light.falloffStart = 0.5f;
+        light.falloffWidth = 0.05f;
+        light.color = Vector3(1.0f, 1.0f, 1.0f);
+        light.attenuation = 1.0f / 128.0f;
+        light.farPlane = 10.0f;
+        const float viewProjection[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                                           0.0f, -1.0f, 0.0f, 0.0f,
+                                           0.0f, 0.0f, 1.0f, 0.0f,
+                                           0.5f - 0.1f * float(l - 2), 0.5f, 2.0f, 1.0f };
+        copy(viewProjection, viewProjection + 16, light.viewProjection);
+        light.shadowMap = &shadowMaps[l].front();
+        light.shadowWidth = shadowSize;
+        light.shadowHeight = shadowSize;
+    }
+
+    TransmittanceCPU transmittance(width, height);
+    ThreadPool pool;
+    const BlurPass::Backend backends[] = { BlurPass::BACKEND_SCALAR, BlurPass::BACKEND_AVX2, BlurPass::BACKEND_AVX512 };
+
+    out << setprecision(2) << fixed;
+    double scalar = 0.0;
+    for (int k = 0; k < 3; k++) {
+        if (!BlurPass::isSupported(backends[k]))
+            continue;
+        transmittance.setBackend(backends[k]);
+        for (int threaded = 0; threaded < 2; threaded++) {
+            transmittance.setThreadPool(threaded? &pool : NULL);
+            double t = measure([&] {
+                transmittance.go(&color.front(), &position.front(), &normal.front(), lights, 0.0f, 0.012f);
+            }, repetitions);
+            if (k == 0 && !threaded)
+                scalar = t;
+
+            out << BlurPass::getName(backends[k]) << " : "
+                << (threaded? pool.getThreadCount() : 1) << " threads : "
+                << t << "ms : " << scalar / t << "x" << endl;
+        }
+    }
+}
+
+
+void Benchmark::frames(ostream &out, int nFrames, ostream *csv) {
+    SyntheticFrame frame(1920, 1080, 0.5f);
+    SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, 17, true, true, true);
+    ThreadPool pool;
+    sss.setThreadPool(&pool);
+
+    FrameRecorder recorder(nFrames);
+    vector<float> color;
+    vector<unsigned char> stencil;
+    for (int i = 0; i < nFrames; i++) {
+        color = frame.color;
+        stencil = frame.stencil;
+        recorder.record(measure([&] {
+            sss.go(&color.front(), &frame.depth.front(), &stencil.front(), &frame.strength.front(), 1);
+        }, 1));
+    }
+
+    out << setprecision(2) << fixed;
+    out << frame.width << "x" << frame.height << " : 17 samples : "
+        << BlurPass::getName(BlurPass::resolve(BlurPass::BACKEND_AUTO)) << " : "
+        << pool.getThreadCount() << " threads" << endl;
+    recorder.print(out);
+    if (csv != NULL)
+        recorder.writeCSV(*csv);
+}
+
+
+/**
+ * Runs 'sss' once over 'frame', and returns the result.
+ */
+static vector<float> render(SeparableSSSCPU &sss, const SyntheticFrame &frame) {
+    vector<float> color = frame.color;
+    vector<unsigned char> stencil = frame.stencil;
+    sss.go(&color.front(), &frame.depth.front(), &stencil.front(), &frame.strength.front(), 1);
+    return color;
+}
+
+
+/**
+ * Prints the difference of an approximation against the full result.
+ */
+static void printDiff(ostream &out, const ImageDiff::Result &r) {
+    out << "max error " << scientific << setprecision(2) << r.maxError << fixed << " : "
+        << "SSIM " << setprecision(4) << r.ssim << " : "
+        << r.nVisible << " visible" << setprecision(2);
+}
+
+
+void Benchmark::pyramid(ostream &out, int repetitions) {
+    const float widths[] = { 0.001f, 0.003f, 0.012f, 0.05f, 0.2f };
+    SyntheticFrame frame(1920, 1080, 0.6f);
+
+    out << setprecision(2) << fixed;
+    for (int w = 0; w < 5; w++) {
+        SeparableSSSCPU dense(frame.width, frame.height, 20.0f, widths[w], 17, true, true, true);
+        SeparableSSSCPU sss(frame.width, frame.height, 20.0f, widths[w], 17, true, true, true);
+        sss.setPyramid(Pyramid::MAX_LEVELS);
+
+        double full = time(dense, frame, repetitions);
+        double t = time(sss, frame, repetitions);
+        ImageDiff::Result r = ImageDiff::compare(&render(dense, frame).front(), &render(sss, frame).front(), frame.width, frame.height);
+
+        out << frame.width << "x" << frame.height << " : "
+            << "width " << setprecision(3) << widths[w] << setprecision(2) << " : "
+            << "dense " << full << "ms : pyramid " << t << "ms : "
+            << full / t << "x : pixels per level";
+        const Pyramid &pyramid = sss.getPyramid();
+        int total = 0;
+        for (int l = 0; l < pyramid.getLevelCount(); l++)
+            total += pyramid.getLevel(l).pixelCount;
+        for (int l = 0; l < pyramid.getLevelCount(); l++)
+            out << " " << int(100.0 * pyramid.getLevel(l).pixelCount / max(total, 1)) << "%";
+        out << " : ";
+        printDiff(out, r);
+        out << endl;
+    }
+}
+
+
+void Benchmark::checkerboard(ostream &out, int repetitions) {
+    const int samples[] = { 17, 25 };
+    const float widths[] = { 0.012f, 0.05f, 0.2f };
+    const float thresholds[] = { numeric_limits<float>::infinity(), 0.02f, 0.01f };
+    SyntheticFrame frame(1920, 1080, 0.6f);
+
+    out << setprecision(2) << fixed;
+    for (int s = 0; s < 2; s++) {
+        for (int w = 0; w < 3; w++) {
+            SeparableSSSCPU dense(frame.width, frame.height, 20.0f, widths[w], samples[s], true, true, true);
+            double full = time(dense, frame, repetitions);
+            vector<float> reference = render(dense, frame);
+
+            for (int t = 0; t < 3; t++) {
+                SeparableSSSCPU sss(frame.width, frame.height, 20.0f, widths[w], samples[s], true, true, true);
+                sss.setCheckerboard(true, thresholds[t]);
+                double half = time(sss, frame, repetitions);
+                ImageDiff::Result r = ImageDiff::compare(&reference.front(), &render(sss, frame).front(), frame.width, frame.height);
+
+                out << frame.width << "x" << frame.height << " : "
+                    << samples[s] << " samples : "
+                    << "width " << setprecision(3) << widths[w] << " : "
+                    << "threshold " << thresholds[t] << setprecision(2) << " : "
+                    << "dense " << full << "ms : checkerboard " << half << "ms : "
+                    << full / half << "x : "
+                    << 100.0 * sss.getCheckerboardFullCount() / (2.0 * frame.width * frame.height) << "% evaluated in full : ";
+                printDiff(out, r);
+                out << endl;
+            }
+        }
+    }
+}
+
+
+void Benchmark::adaptive(ostream &out, int repetitions) {
+    const int samples[] = { 17, 25 };
+    const float distances[] = { 1.0f, 10.0f, 60.0f };
+
+    out << setprecision(2) << fixed;
+    for (int d = 0; d < 3; d++) {
+        // Heads further away, with the same layout:
+        SyntheticFrame frame(1920, 1080, 0.6f);
+        for (size_t i = 0; i < frame.depth.size(); i++)
+            frame.depth[i] *= distances[d];
+
+        for (int s = 0; s < 2; s++) {
+            SeparableSSSCPU dense(frame.width, frame.height, 20.0f, 0.012f, samples[s], true, true, true);
+            SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, samples[s], true, true, true);
+            sss.setAdaptiveSampling(true);
+
+            double full = time(dense, frame, repetitions);
+            double t = time(sss, frame, repetitions);
+            ImageDiff::Result r = ImageDiff::compare(&render(dense, frame).front(), &render(sss, frame).front(), frame.width, frame.height);
+
+            const TileClassifier &classifier = sss.getTileClassifier();
+            out << frame.width << "x" << frame.height << " : "
+                << "depth x" << int(distances[d]) << " : "
+                << samples[s] << " samples : "
+                << "dense " << full << "ms : adaptive " << t << "ms : "
+                << full / t << "x : "
+                << classifier.getSavings() << "% taps saved : tiles per class";
+            for (size_t c = 0; c < classifier.getTileCounts().size(); c++)
+                out << " " << classifier.getTileCounts()[c];
+            out << " : ";
+            printDiff(out, r);
+            out << endl;
+        }
+    }
+}
+
+
+void Benchmark::merging(ostream &out, int repetitions) {
+    const int samples[] = { 17, 25 };
+    const float distances[] = { 1.0f, 10.0f, 60.0f };
+
+    out << setprecision(2) << fixed;
+    for (int d = 0; d < 3; d++) {
+        // Heads further away, with the same layout:
+        SyntheticFrame frame(1920, 1080, 0.6f);
+        for (size_t i = 0; i < frame.depth.size(); i++)
+            frame.depth[i] *= distances[d];
+
+        for (int s = 0; s < 2; s++) {
+            SeparableSSSCPU dense(frame.width, frame.height, 20.0f, 0.012f, samples[s], true, true, true);
+            SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, samples[s], true, true, true);
+            sss.setTapMerging(true);
+
+            double full = time(dense, frame, repetitions);
+            double t = time(sss, frame, repetitions);
+            ImageDiff::Result r = ImageDiff::compare(&render(dense, frame).front(), &render(sss, frame).front(), frame.width, frame.height);
+
+            const TileClassifier &classifier = sss.getTileClassifier();
+            out << frame.width << "x" << frame.height << " : "
+                << "depth x" << int(distances[d]) << " : "
+                << samples[s] << " samples : "
+                << "dense " << full << "ms : merged " << t << "ms : "
+                << full / t << "x : "
+                << classifier.getSavings() << "% taps saved : tiles per kernel";
+            for (size_t c = 0; c < classifier.getTileCounts().size(); c++)
+                out << " " << sss.getKernelSet()[c].size() << ":" << classifier.getTileCounts()[c];
+            out << " : ";
+            printDiff(out, r);
+            out << endl;
+        }
+    }
+}
+
+
+Benchmark::Sweep::Sweep() : nKernels(64), repetitions(3) {
+    const int defaultHeights[] = { 720, 1080, 1440, 2160, 4320 };
+    const int defaultSamples[] = { 3, 7, 11, 17, 25, 33 };
+    const float defaultCoverages[] = { 0.01f, 0.1f, 0.5f, 1.0f };
+    heights.assign(defaultHeights, defaultHeights + 5);
+    samples.assign(defaultSamples, defaultSamples + 6);
+    followSurface.push_back(0);
+    followSurface.push_back(1);
+    coverages.assign(defaultCoverages, defaultCoverages + 4);
+    threads.push_back(1);
+    int hardwareThreads = int(thread::hardware_concurrency());
+    if (hardwareThreads > 1)
+        threads.push_back(hardwareThreads);
+}
+
+
+static string jsonString(const string &s) {
+    ostringstream out;
+    out << '"';
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '"' || s[i] == '\\')
+            out << '\\' << s[i];
+        else if ((unsigned char) s[i] < 0x20)
+            out << "\\u" << hex << setw(4) << setfill('0') << int(s[i]) << dec;
+        else
+            out << s[i];
+    }
+    out << '"';
+    return out.str();
+}
+
+
+void Benchmark::sweep(ostream &out, const Sweep &sweep) {
+    const int nThreads = int(sweep.threads.size());
+    vector<ThreadPool *> pools(nThreads);
+    for (int t = 0; t < nThreads; t++)
+        pools[t] = new ThreadPool(sweep.threads[t]);
+
+    out << setprecision(4) << fixed;
+    out << "{ \"backend\": " << jsonString(BlurPass::getName(BlurPass::resolve(BlurPass::BACKEND_AUTO)))
+        << ", \"hardwareThreads\": " << thread::hardware_concurrency()
+        << ", \"repetitions\": " << sweep.repetitions << "," << endl;
+
+    // Kernel generation, for falloffs spread over their usual range:
+    out << "  \"kernels\": [";
+    bool first = true;
+    for (size_t s = 0; s < sweep.samples.size(); s++) {
+        for (int t = 0; t < nThreads; t++) {
+            const int nSamples = sweep.samples[s], nKernels = sweep.nKernels;
+            ThreadPool *pool = pools[t];
+            vector<vector<KernelSample> > kernels(nKernels);
+            double ms = measure([&] {
+                for (int k = 0; k < nKernels; k++) {
+                    vector<KernelSample> *kernel = &kernels[k];
+                    float f = 0.1f + 0.9f * float(k) / float(max(nKernels - 1, 1));
+                    pool->submit([kernel, nSamples, f] {
+                        Kernel::calculate(*kernel, nSamples, Vector3(0.48f, 0.41f, 0.28f), Vector3(1.0f, f, 0.3f * f));
+                    });
+                }
+                pool->wait();
+            }, sweep.repetitions);
+
+            out << (first? "\n" : ",\n") << "    { \"samples\": " << nSamples
+                << ", \"threads\": " << sweep.threads[t]
+                << ", \"kernels\": " << nKernels
+                << ", \"ms\": " << ms
+                << ", \"usPerKernel\": " << 1000.0 * ms / max(nKernels, 1) << " }";
+            first = false;
+        }
+    }
+    out << " ]," << endl;
+
+    // The blur, for every input:
+    vector<string> errors;
+    out << "  \"blur\": [";
+    first = true;
+    const int nSynthetic = int(sweep.heights.size() * sweep.coverages.size());
+    for (int input = 0; input < nSynthetic + int(sweep.captures.size()); input++) {
+        SyntheticFrame frame;
+        string name = "synthetic";
+        float coverage = 0.0f;
+        if (input < nSynthetic) {
+            int height = sweep.heights[input / sweep.coverages.size()];
+            coverage = sweep.coverages[input % sweep.coverages.size()];
+            frame = SyntheticFrame(height * 16 / 9, height, coverage);
+        } else {
+            name = sweep.captures[input - nSynthetic];
+            if (!frame.load(name)) {
+                errors.push_back(name);
+                continue;
+            }
+            coverage = float(count(frame.stencil.begin(), frame.stencil.end(), 1)) / float(frame.width * frame.height);
+        }
+
+        for (size_t s = 0; s < sweep.samples.size(); s++) {
+            for (size_t f = 0; f < sweep.followSurface.size(); f++) {
+                SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, sweep.samples[s], true, sweep.followSurface[f] != 0, true);
+                for (int t = 0; t < nThreads; t++) {
+                    sss.setThreadPool(pools[t]);
+                    double ms = time(sss, frame, sweep.repetitions);
+
+                    out << (first? "\n" : ",\n") << "    { \"input\": " << jsonString(name)
+                        << ", \"width\": " << frame.width
+                        << ", \"height\": " << frame.height
+                        << ", \"coverage\": " << coverage
+                        << ", \"samples\": " << sweep.samples[s]
+                        << ", \"followSurface\": " << (sweep.followSurface[f] != 0? "true" : "false")
+                        << ", \"threads\": " << sweep.threads[t]
+                        << ", \"ms\": " << ms
+                        << ", \"megapixelsPerSecond\": " << double(frame.width) * frame.height / (1000.0 * ms) << " }";
+                    first = false;
+                }
+                sss.setThreadPool(NULL);
+            }
+        }
+    }
+    out << " ]";
+
+    if (!errors.empty()) {
+        out << "," << endl << "  \"errors\": [";
+        for (size_t i = 0; i < errors.size(); i++)
+            out << (i > 0? ", " : " ") << jsonString("cannot load " + errors[i]);
+        out << " ]";
+    }
+    out << " }" << endl;
+
+    for (int t = 0; t < nThreads; t++)
+        delete pools[t];
+}
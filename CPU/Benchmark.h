@@ -0,0 +1,251 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "SeparableSSSCPU.h"
+
+/**
+ * Synthetic inputs for the CPU engine: a grid of heads (spheres) in front of
+ * a distant background. 'coverage' is the fraction of the frame covered by
+ * skin, which gets marked in the stencil (with id 1) and has full strength.
+ * Each head also gets a material ID, cycling from 0 to 3 (the background is
+ * 0 too).
+ *
+ * Frames captured from a renderer can be loaded instead (see 'load').
+ */
+class SyntheticFrame {
+    public:
+        SyntheticFrame(int width, int height, float coverage=0.15f, unsigned int seed=1);
+
+        /**
+         * Empty frame, to be filled by 'load'.
+         */
+        SyntheticFrame() : width(0), height(0) {}
+
+        /**
+         * Captured frames are stored as three PFM files (see 'PFM'):
+         * '<prefix>color.pfm' (linear RGB), '<prefix>depth.pfm' (linear
+         * depth) and '<prefix>strength.pfm' (SSS strength). The strength is
+         * also copied into the alpha channel, pixels with non-zero strength
+         * get marked in the stencil, and all of them get material 0.
+         * Returns false if a file cannot be loaded or their sizes differ.
+         */
+        bool load(const std::string &prefix);
+        bool save(const std::string &prefix) const;
+
+        int width, height;
+        std::vector<float> color;
+        std::vector<float> depth;
+        std::vector<float> strength;
+        std::vector<unsigned char> stencil;
+        std::vector<unsigned char> material;
+};
+
+
+class Benchmark {
+    public:
+        /**
+         * Parameters swept by 'sweep'; every combination is measured.
+         * Resolutions are 16:9, given by their height.
+         */
+        struct Sweep {
+            Sweep();
+
+            std::vector<int> heights;
+            std::vector<int> samples;
+            std::vector<int> followSurface; // 0 (off) and/or 1 (on)
+            std::vector<float> coverages;
+            std::vector<int> threads;
+            std::vector<std::string> captures; // Prefixes of captured frames (see 'SyntheticFrame::load')
+            int nKernels; // Kernels generated per kernel measurement
+            int repetitions;
+        };
+
+        /**
+         * Returns the minimum time, in milliseconds, of 'repetitions' runs of
+         * 'sss' over 'frame' (the frame is restored before each run).
+         */
+        static double time(SeparableSSSCPU &sss, const SyntheticFrame &frame, int repetitions=5);
+
+        /**
+         * Compares all the backends supported by the running CPU against the
+         * scalar one, at 1080p and 4K, for 11, 17 and 25 samples.
+         */
+        static void backends(std::ostream &out, int repetitions=5);
+
+        /**
+         * Measures the scaling of the tiled scheduler at 4K with 17 samples,
+         * doubling the number of threads up to 'maxThreads' (all hardware
+         * threads if zero).
+         */
+        static void scaling(std::ostream &out, int maxThreads=0, int repetitions=5);
+
+        /**
+         * Compares the streaming mode against the regular one, in time and in
+         * size of the temporal buffers, from 1080p up to 'maxHeight' (8K by
+         * default) with 17 samples.
+         */
+        static void streaming(std::ostream &out, int maxHeight=4320, int repetitions=5);
+
+        /**
+         * Times each pass on its own at 4K with 17 samples, for all the
+         * backends supported by the running CPU: the regular vertical pass,
+         * and the transposed one (see 'SeparableSSSCPU::setTransposed'),
+         * against the horizontal pass.
+         */
+        static void passes(std::ostream &out, int repetitions=5);
+
+        /**
+         * Compares the storage formats of the temporal buffer (see
+         * 'PixelFormat'), in time, size and maximum error against full
+         * floats, from 1080p up to 'maxHeight' (8K by default) with 17
+         * samples.
+         */
+        static void formats(std::ostream &out, int maxHeight=4320, int repetitions=5);
+
+        /**
+         * Compares the placements of the kernel samples (see
+         * 'Kernel::Placement') for the default strength and falloff, from 5
+         * to 33 samples: maximum and RMS error against the continuous
+         * convolution, for kernels of 4, 16 and 64 pixels per unit of offset
+         * (see 'Kernel::measure').
+         */
+        static void kernels(std::ostream &out);
+
+        /**
+         * Compares a frame with four materials processed with a kernel atlas
+         * in a single 'go' call against one sparse 'go' call per material
+         * (with each material marked with its own stencil), at 1080p and 4K
+         * with 17 samples.
+         */
+        static void materials(std::ostream &out, int repetitions=5);
+
+        /**
+         * Fits 'nMaterials' profiles (see 'ProfileFitter') to 64 samples of
+         * falloff profiles with random falloffs, with one thread and with
+         * all of them, and reports the worst fitting error.
+         */
+        static void profiles(std::ostream &out, int nMaterials=500);
+
+        /**
+         * Compares the analytic transmittance of 'SSSSTransmittance' (six
+         * 'exp' per pixel) against 'TransmittanceLUT' with each backend, for
+         * 4M thicknesses, and reports the error of several resolutions.
+         */
+        static void transmittance(std::ostream &out, int repetitions=5);
+
+        /**
+         * Times 'TransmittanceCPU' with each backend for a 1080p G-buffer
+         * lit by five spot lights (as 'N_LIGHTS' in 'Main.fx') with 1024x1024
+         * shadow maps.
+         */
+        static void relighting(std::ostream &out, int repetitions=5);
+
+        /**
+         * Runs the whole 1080p 17 samples pipeline 'nFrames' times, as a
+         * sequence of frames, and reports the distribution of frame times
+         * (see 'FrameRecorder'). If 'csv' is not NULL, the frame times are
+         * also written to it.
+         */
+        static void frames(std::ostream &out, int nFrames=500, std::ostream *csv=NULL);
+
+        /**
+         * Compares the multi-resolution mode (see
+         * 'SeparableSSSCPU::setPyramid'), with all the levels and the default
+         * tap spacing, against the dense path at 1080p with 60% coverage and
+         * 17 samples, for widths from 0.001 to 0.2: times, share of the
+         * processed pixels routed to each level, and error.
+         */
+        static void pyramid(std::ostream &out, int repetitions=5);
+
+        /**
+         * Compares the checkerboard mode (see
+         * 'SeparableSSSCPU::setCheckerboard') against the dense path at
+         * 1080p with 60% coverage, for 17 and 25 samples and widths from
+         * 0.012 to 0.2, without the residual test and with thresholds of
+         * 0.02 and 0.01: times, share of the pixels of both passes evaluated
+         * in full, and error.
+         */
+        static void checkerboard(std::ostream &out, int repetitions=5);
+
+        /**
+         * Compares adaptive sampling (see
+         * 'SeparableSSSCPU::setAdaptiveSampling'), with the default tap
+         * spacing, against the dense path at 1080p with 60% coverage, for 17
+         * and 25 samples, with the depth of the frame scaled by 1, 10 and 60
+         * (heads further away): times, share of the taps saved over the
+         * tiles with skin, tiles of each class, and error.
+         */
+        static void adaptive(std::ostream &out, int repetitions=5);
+
+        /**
+         * Same as above, for tap merging (see
+         * 'SeparableSSSCPU::setTapMerging'): times, share of the taps saved
+         * over the tiles with skin, tiles using each kernel (as taps:tiles),
+         * and error.
+         */
+        static void merging(std::ostream &out, int repetitions=5);
+
+        /**
+         * Measures kernel generation for each number of samples and threads,
+         * and the whole CPU blur for each combination of the parameters of
+         * 'sweep', over synthetic frames of each resolution and coverage and
+         * over the captured frames (at their own resolution). Results are
+         * written as JSON, one measurement per line so that runs can be
+         * diffed:
+         *
+         *     { "backend": "AVX2", "hardwareThreads": 8, "repetitions": 3,
+         *       "kernels": [
+         *         { "samples": 17, "threads": 1, "kernels": 64, "ms": ..., "usPerKernel": ... },
+         *         ... ],
+         *       "blur": [
+         *         { "input": "synthetic", "width": 1920, "height": 1080, "coverage": 0.5,
+         *           "samples": 17, "followSurface": true, "threads": 1, "ms": ...,
+         *           "megapixelsPerSecond": ... },
+         *         ... ] }
+         *
+         * Times are the minimum of 'repetitions' runs. Captured frames that
+         * cannot be loaded are reported in 'errors'.
+         */
+        static void sweep(std::ostream &out, const Sweep &sweep=Sweep());
+};
+
+#endif
@@ -0,0 +1,236 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "BlurPass.h"
+#include "CPUFeatures.h"
+using namespace std;
+
+
+bool BlurPass::isSupported(Backend backend) {
+    switch (backend) {
+        case BACKEND_SSE42:
+            return CPUFeatures::hasSSE42();
+        case BACKEND_AVX2:
+            return CPUFeatures::hasAVX2() && CPUFeatures::hasF16C();
+        case BACKEND_AVX512:
+            return CPUFeatures::hasAVX512();
+        default:
+            return true;
+    }
+}
+
+
+BlurPass::Backend BlurPass::resolve(Backend backend) {
+    if (backend != BACKEND_AUTO && isSupported(backend))
+        return backend;
+    else if (CPUFeatures::hasAVX512())
+        return BACKEND_AVX512;
+    else if (CPUFeatures::hasAVX2() && CPUFeatures::hasF16C())
+        return BACKEND_AVX2;
+    else if (CPUFeatures::hasSSE42())
+        return BACKEND_SSE42;
+    else
+        return BACKEND_SCALAR;
+}
+
+
+const char *BlurPass::getName(Backend backend) {
+    switch (backend) {
+        case BACKEND_AUTO:   return "Auto";
+        case BACKEND_SCALAR: return "Scalar";
+        case BACKEND_SSE42:  return "SSE4.2";
+        case BACKEND_AVX2:   return "AVX2";
+        case BACKEND_AVX512: return "AVX-512";
+        default:             return "Unknown";
+    }
+}
+
+
+void BlurPass::run(int x0, int y0, int x1, int y1, Backend backend) const {
+    switch (resolve(backend)) {
+        case BACKEND_SSE42:
+            runSSE42(x0, y0, x1, y1);
+            break;
+        case BACKEND_AVX2:
+            runAVX2(x0, y0, x1, y1);
+            break;
+        case BACKEND_AVX512:
+            runAVX512(x0, y0, x1, y1);
+            break;
+        default:
+            runScalar(x0, y0, x1, y1);
+            break;
+    }
+}
+
+
+int BlurPass::reach(int x0, int y0, int x1, int y1) const {
+    const int n = dir == HORIZONTAL? width : height;
+
+    const int srcMask = srcRows > 0? srcRows - 1 : ~0;
+
+    float maxOffset = 0.0f;
+    for (int k = 1; k < nSamples; k++)
+        maxOffset = max(maxOffset, abs(kernel[k].offset));
+
+    // Find the biggest 'strength / depth' ratio (or step, if the footprint is
+    // available), which determines the step:
+    float maxRatio = 0.0f;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            const int i = y * width + x;
+            float s = strength != NULL? strength[i] : PixelFormat::loadAlpha(srcFormat, src, (y & srcMask) * width + x);
+            if (initStencil != NULL) {
+                if (s == 0.0f) continue;
+            } else if (stencil != NULL && stencil[i] != id) {
+                continue;
+            }
+            float ratio = footprint != NULL? abs(footprint[i]) : abs(s / depth[i]);
+            if (!(ratio < numeric_limits<float>::max())) // Infinities and NaNs
+                return n;
+            maxRatio = max(maxRatio, ratio);
+        }
+    }
+
+    float scale = footprint != NULL? 1.0f : sssWidth * distanceToProjectionWindow * (1.0f / 3.0f);
+    float r = maxOffset * scale * maxRatio * float(n);
+    return r < float(n)? int(ceil(r)) + 1 : n;
+}
+
+
+void BlurPass::runScalar(int x0, int y0, int x1, int y1) const {
+    /**
+     * Everything is expressed in terms of the axis of the blur ('along') and
+     * the other one ('across'), so that the same loop serves both passes.
+     * Offsets are converted from texcoord units into pixels by multiplying by
+     * the size of the image along the axis.
+     *
+     * Indices into 'src' and 'dst' go through the row masks, so that ring
+     * buffers can be used (with full size buffers the masks have all bits
+     * set). Their pixels are decoded into floats on load (see 'PixelFormat').
+     */
+    const int n = dir == HORIZONTAL? width : height;
+    const int stride = dir == HORIZONTAL? 1 : width;
+    const float last = float(n - 1);
+    const int srcMask = srcRows > 0? srcRows - 1 : ~0;
+    const int dstMask = dstRows > 0? dstRows - 1 : ~0;
+    const int srcAlongMask = dir == HORIZONTAL? ~0 : srcMask;
+
+    const int xStep = checkerboard >= 0? 2 : 1;
+
+    for (int y = y0; y < y1; y++) {
+        const int xFirst = checkerboard >= 0? x0 + ((x0 + y + checkerboard) & 1) : x0;
+        for (int x = xFirst; x < x1; x += xStep) {
+            const int i = y * width + x;
+            const int along = dir == HORIZONTAL? x : y;
+            const int base = i - along * stride;
+            const int srcBase = dir == HORIZONTAL? (y & srcMask) * width : x;
+
+            // Stencil test:
+            if (initStencil == NULL && stencil != NULL && stencil[i] != id)
+                continue;
+
+            // Fetch color of current pixel:
+            float colorM[4];
+            PixelFormat::load(srcFormat, src, (y & srcMask) * width + x, colorM);
+            float s = strength != NULL? strength[i] : colorM[3];
+
+            // Initialize the stencil buffer in case it was not already available:
+            if (initStencil != NULL) {
+                if (s == 0.0f) continue;
+                initStencil[i] = (unsigned char) id;
+            }
+
+            // Fetch linear depth of current pixel:
+            float depthM = depth[i];
+
+            // Calculate the final step to fetch the surrounding pixels:
+            float finalStep;
+            if (footprint != NULL) {
+                finalStep = footprint[i] * float(n);
+            } else {
+                float scale = distanceToProjectionWindow / depthM;
+                finalStep = sssWidth * scale * s * (1.0f / 3.0f) * float(n);
+            }
+
+            // Accumulate the center sample:
+            float r = colorM[0] * kernel[0].r;
+            float g = colorM[1] * kernel[0].g;
+            float b = colorM[2] * kernel[0].b;
+
+            // Accumulate the other samples:
+            for (int k = 1; k < nSamples; k++) {
+                // Bilinear fetch with clamp addressing (written so that NaNs
+                // and infinities end up clamped too):
+                float t = float(along) + kernel[k].offset * finalStep;
+                t = t > 0.0f? (t < last? t : last) : 0.0f;
+                int t0 = int(t);
+                int t1 = t0 < n - 1? t0 + 1 : t0;
+                float f = t - float(t0);
+
+                float c0[4], c1[4];
+                PixelFormat::load(srcFormat, src, srcBase + (t0 & srcAlongMask) * stride, c0);
+                PixelFormat::load(srcFormat, src, srcBase + (t1 & srcAlongMask) * stride, c1);
+                float cr = c0[0] + f * (c1[0] - c0[0]);
+                float cg = c0[1] + f * (c1[1] - c0[1]);
+                float cb = c0[2] + f * (c1[2] - c0[2]);
+
+                if (followSurface) {
+                    // If the difference in depth is huge, we lerp color back to "colorM":
+                    float d0 = depth[base + t0 * stride];
+                    float d1 = depth[base + t1 * stride];
+                    float d = d0 + f * (d1 - d0);
+                    float w = 300.0f * distanceToProjectionWindow * sssWidth * abs(depthM - d);
+                    w = w < 1.0f? w : 1.0f;
+                    cr += w * (colorM[0] - cr);
+                    cg += w * (colorM[1] - cg);
+                    cb += w * (colorM[2] - cb);
+                }
+
+                // Accumulate:
+                r += kernel[k].r * cr;
+                g += kernel[k].g * cg;
+                b += kernel[k].b * cb;
+            }
+
+            float out[4] = { r, g, b, colorM[3] };
+            PixelFormat::store(dstFormat, dst, dstTransposed? x * height + y : (y & dstMask) * width + x, out);
+        }
+    }
+}
@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef BLURPASS_H
+#define BLURPASS_H
+
+#include "Kernel.h"
+#include "PixelFormat.h"
+
+/**
+ * One of the two passes of 'SSSSBlurPS', described over plain memory buffers.
+ * All images are row-major, with the first row being the top one (texcoord.y
+ * = 0), and 'width * height' pixels.
+ *
+ * Coordinates are interpreted as the shader does: the center of pixel (x, y)
+ * is at texcoord ((x + 0.5) / width, (y + 0.5) / height), and samples are
+ * bilinearly filtered with clamp addressing.
+ */
+class BlurPass {
+    public:
+        enum Direction { HORIZONTAL = 0, VERTICAL = 1 };
+
+        /**
+         * Implementations of the inner loop. The SIMD ones evaluate 4, 8 or 16
+         * neighbouring pixels per iteration; BACKEND_AUTO selects the widest
+         * one supported by the running CPU. BACKEND_SCALAR is the reference
+         * all others are checked against. BACKEND_AVX2 also requires F16C,
+         * used for the half precision formats.
+         */
+        enum Backend { BACKEND_AUTO = 0,
+                       BACKEND_SCALAR = 1,
+                       BACKEND_SSE42 = 2,
+                       BACKEND_AVX2 = 3,
+                       BACKEND_AVX512 = 4 };
+
+        BlurPass() : src(NULL), dst(NULL),
+                     srcFormat(PixelFormat::FORMAT_RGBA32F), dstFormat(PixelFormat::FORMAT_RGBA32F),
+                     depth(NULL), strength(NULL), footprint(NULL),
+                     stencil(NULL), initStencil(NULL), id(1),
+                     width(0), height(0), srcRows(0), dstRows(0),
+                     dstTransposed(false), checkerboard(-1), dir(HORIZONTAL),
+                     followSurface(false), sssWidth(0.0f),
+                     distanceToProjectionWindow(0.0f),
+                     kernel(NULL), nSamples(0) {}
+
+        /**
+         * Runs the pass over the pixels in [x0, x1) x [y0, y1).
+         */
+        void run(int x0, int y0, int x1, int y1, Backend backend=BACKEND_SCALAR) const;
+
+        /**
+         * Returns how far, in pixels along the direction of the pass, the taps
+         * of the pixels in [x0, x1) x [y0, y1) can reach (only the pixels that
+         * pass the stencil test are taken into account). The result is
+         * clamped to the size of the image along that direction.
+         */
+        int reach(int x0, int y0, int x1, int y1) const;
+
+        static bool isSupported(Backend backend);
+        static Backend resolve(Backend backend);
+        static const char *getName(Backend backend);
+
+        /**
+         * RGBA input and output colors, stored in the specified formats (see
+         * 'PixelFormat'). They must not alias.
+         */
+        const void *src;
+        void *dst;
+        PixelFormat::Format srcFormat, dstFormat;
+
+        /**
+         * Linear depth, one float per pixel.
+         */
+        const float *depth;
+
+        /**
+         * SSS strength, one float per pixel. If NULL, the alpha channel of
+         * 'src' is used instead (see SSSS_STREGTH_SOURCE).
+         */
+        const float *strength;
+
+        /**
+         * Optional per-pixel footprint (see 'Footprint'). If not NULL, the
+         * step of each pixel is taken from it instead of being calculated
+         * from its strength and depth.
+         */
+        const float *footprint;
+
+        /**
+         * Stencil handling, mirroring the 'BlurStencil' and 'InitStencil'
+         * states of 'SeparableSSS.fx':
+         *   - If 'initStencil' is not NULL, pixels with zero strength are
+         *     discarded, and the others get marked with 'id' in it.
+         *   - Otherwise, if 'stencil' is not NULL, only the pixels marked
+         *     with 'id' in it are processed.
+         *   - Otherwise, every pixel is processed.
+         * Discarded pixels leave 'dst' untouched.
+         */
+        const unsigned char *stencil;
+        unsigned char *initStencil;
+        int id;
+
+        int width, height;
+
+        /**
+         * If not zero, 'src' (or 'dst') only holds this many rows, used as a
+         * ring buffer: row y is stored at row 'y & (rows - 1)'. It must be a
+         * power of two. The other buffers are always full size.
+         */
+        int srcRows, dstRows;
+
+        /**
+         * If true, 'dst' is stored transposed: pixel (x, y) goes to
+         * 'x * height + y'. This allows a following pass along the other
+         * axis to read its input row by row (see 'Transpose').
+         */
+        bool dstTransposed;
+
+        /**
+         * If not negative, only the pixels whose '(x + y) & 1' equals it are
+         * processed, the others being left untouched, as if they failed the
+         * stencil test (see 'Checkerboard'). Not supported along with
+         * 'dstTransposed'.
+         */
+        int checkerboard;
+
+        Direction dir;
+
+        bool followSurface;
+        float sssWidth;
+        float distanceToProjectionWindow;
+
+        const KernelSample *kernel;
+        int nSamples;
+
+    private:
+        void runScalar(int x0, int y0, int x1, int y1) const;
+        void runSSE42(int x0, int y0, int x1, int y1) const;
+        void runAVX2(int x0, int y0, int x1, int y1) const;
+        void runAVX512(int x0, int y0, int x1, int y1) const;
+};
+
+#endif
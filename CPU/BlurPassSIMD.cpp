@@ -0,0 +1,782 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include "BlurPass.h"
+#include "CPUFeatures.h"
+
+#if SSSS_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * SIMD versions of 'BlurPass::runScalar'. Each iteration evaluates a group of
+ * horizontally neighbouring output pixels, one per lane, for both passes: in
+ * the horizontal one the lanes sample along the row, in the vertical one each
+ * lane walks down its own column. As every pixel has its own step (it depends
+ * on its depth and strength), the taps are fetched using gathers.
+ *
+ * The stencil is handled per group: groups without any active pixel are
+ * skipped, and only the active ones are written. In checkerboard mode, the
+ * pixels of a group are two columns apart, so that no lane is wasted.
+ *
+ * Colors stored with less precision (see 'PixelFormat') are gathered as
+ * 32-bit words and decoded in registers: halfs with F16C (or with integer
+ * operations in the SSE4.2 backend), and sRGB bytes through the decoding
+ * table, which stays in L1.
+ */
+
+#if SSSS_X86
+
+/**
+ * Number of pixels of the group of 'lanes' that starts at column 'x' of row
+ * 'y' (and ends before 'x1'), and the first of them, 'xs'. In checkerboard
+ * mode the group spans twice as many columns, as only the pixels of one
+ * parity are taken, two columns apart.
+ */
+static inline int groupSpan(const BlurPass &p, int x, int x1, int y, int lanes, int &xs) {
+    if (p.checkerboard < 0) {
+        xs = x;
+        return x1 - x < lanes? x1 - x : lanes;
+    }
+    xs = x + ((x + y + p.checkerboard) & 1);
+    int count = (x1 - xs + 1) / 2;
+    return count < lanes? count : lanes;
+}
+
+
+/**
+ * Stencil test (or initialization) for the 'count' pixels starting at 'i'
+ * ('si' in 'src'), 'pitch' pixels apart. Returns a bit mask with the pixels
+ * that must be processed.
+ */
+static inline unsigned int activeMask(const BlurPass &p, int i, int si, int count, int pitch) {
+    unsigned int mask = 0;
+    for (int l = 0; l < count; l++) {
+        const int j = i + l * pitch;
+        if (p.initStencil != NULL) {
+            float s = p.strength != NULL? p.strength[j] : PixelFormat::loadAlpha(p.srcFormat, p.src, si + l * pitch);
+            if (s != 0.0f) {
+                p.initStencil[j] = (unsigned char) p.id;
+                mask |= 1 << l;
+            }
+        } else if (p.stencil == NULL || p.stencil[j] == p.id) {
+            mask |= 1 << l;
+        }
+    }
+    return mask;
+}
+
+
+/**
+ * Writes pixel 'i' of 'dst', encoding it if required.
+ */
+static inline void storePixel(const BlurPass &p, int i, float r, float g, float b, float a) {
+    if (p.dstFormat == PixelFormat::FORMAT_RGBA32F) {
+        float *out = (float *) p.dst + 4 * i;
+        out[0] = r;
+        out[1] = g;
+        out[2] = b;
+        out[3] = a;
+    } else {
+        float rgba[4] = { r, g, b, a };
+        PixelFormat::store(p.dstFormat, p.dst, i, rgba);
+    }
+}
+
+
+/**
+ * Writes the active lanes of a group starting at pixel (x, y), whose pixels
+ * are 'pitch' pixels apart.
+ */
+static inline void storeActive(const BlurPass &p, int x, int y, int pitch, unsigned int mask,
+                               const float *r, const float *g, const float *b, const float *a) {
+    const int dstMask = p.dstRows > 0? p.dstRows - 1 : ~0;
+    const int di = (y & dstMask) * p.width + x;
+    for (int l = 0; mask != 0; l++, mask >>= 1)
+        if (mask & 1)
+            storePixel(p, di + l * pitch, r[l], g[l], b[l], a[l]);
+}
+
+
+/**
+ * Same as above, for groups already converted to halfs.
+ */
+static inline void storeActive(const BlurPass &p, int x, int y, int pitch, unsigned int mask,
+                               const unsigned short *r, const unsigned short *g,
+                               const unsigned short *b, const unsigned short *a) {
+    const int dstMask = p.dstRows > 0? p.dstRows - 1 : ~0;
+    const int di = (y & dstMask) * p.width + x;
+    for (int l = 0; mask != 0; l++, mask >>= 1) {
+        if (mask & 1) {
+            unsigned short *out = (unsigned short *) p.dst + 4 * (di + l * pitch);
+            out[0] = r[l];
+            out[1] = g[l];
+            out[2] = b[l];
+            out[3] = a[l];
+        }
+    }
+}
+
+
+/**
+ * Source colors of a pass, with the decoding tables at hand.
+ */
+struct Source {
+    Source(const BlurPass &p) : data(p.src), format(p.srcFormat),
+                                srgb(PixelFormat::getSRGBTable()),
+                                unorm(PixelFormat::getUNormTable()) {}
+
+    const void *data;
+    PixelFormat::Format format;
+    const float *srgb;
+    const float *unorm;
+};
+
+
+/**
+ * When 'dst' is transposed, the lanes of a group land in different columns of
+ * it (far apart in memory), so the results of a few rows are gathered here
+ * first, and then written one column at a time.
+ */
+class ColumnBlock {
+    public:
+        static const int ROWS = 16;
+
+        void clear() {
+            for (int j = 0; j < ROWS; j++)
+                masks[j] = 0;
+        }
+
+        void store(int row, unsigned int mask,
+                   const float *r, const float *g, const float *b, const float *a) {
+            masks[row] = mask;
+            for (int l = 0; mask != 0; l++, mask >>= 1) {
+                if (mask & 1) {
+                    float *out = data[l][row];
+                    out[0] = r[l];
+                    out[1] = g[l];
+                    out[2] = b[l];
+                    out[3] = a[l];
+                }
+            }
+        }
+
+        void flush(const BlurPass &p, int x, int y, int rows, int lanes) {
+            for (int l = 0; l < lanes; l++) {
+                const int di = (x + l) * p.height + y;
+                for (int j = 0; j < rows; j++) {
+                    if (masks[j] & (1 << l)) {
+                        const float *c = data[l][j];
+                        storePixel(p, di + j, c[0], c[1], c[2], c[3]);
+                    }
+                }
+            }
+        }
+
+    private:
+        float data[16][ROWS][4];
+        unsigned int masks[ROWS];
+};
+
+
+SSSS_TARGET("sse4.2")
+static inline __m128 gather4(const float *base, __m128i index) {
+    SSSS_ALIGN(16) int idx[4];
+    _mm_store_si128((__m128i *) idx, index);
+    return _mm_setr_ps(base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]]);
+}
+
+
+SSSS_TARGET("sse4.2")
+static inline __m128i gather4i(const int *base, __m128i index) {
+    SSSS_ALIGN(16) int idx[4];
+    _mm_store_si128((__m128i *) idx, index);
+    return _mm_setr_epi32(base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]]);
+}
+
+
+/**
+ * Vector version of 'PixelFormat::halfToFloat', for the halfs in the low 16
+ * bits of each lane (the upper ones must be zero).
+ */
+SSSS_TARGET("sse4.2")
+static inline __m128 halfToFloat4(__m128i h) {
+    __m128i em = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+    __m128 f = _mm_mul_ps(_mm_castsi128_ps(em), _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+    __m128i special = _mm_cmpgt_epi32(em, _mm_set1_epi32(0x0f7fffff));
+    __m128i nan = _mm_cmpgt_epi32(em, _mm_set1_epi32(0x0f800000));
+    __m128i bits = _mm_or_si128(_mm_and_si128(special, _mm_set1_epi32(0x7f800000)),
+                                _mm_and_si128(nan, _mm_set1_epi32(0x00400000)));
+    bits = _mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16));
+    return _mm_or_ps(f, _mm_castsi128_ps(bits));
+}
+
+
+/**
+ * Fetches the RGB channels of pixels 'pix' of 'src'.
+ */
+SSSS_TARGET("sse4.2")
+static inline void fetch4(const Source &src, __m128i pix, __m128 &r, __m128 &g, __m128 &b) {
+    const __m128i low = _mm_set1_epi32(0xff);
+    switch (src.format) {
+        case PixelFormat::FORMAT_RGBA16F: {
+            const int *words = (const int *) src.data;
+            __m128i pix2 = _mm_slli_epi32(pix, 1);
+            __m128i rg = gather4i(words, pix2), ba = gather4i(words + 1, pix2);
+            r = halfToFloat4(_mm_and_si128(rg, _mm_set1_epi32(0xffff)));
+            g = halfToFloat4(_mm_srli_epi32(rg, 16));
+            b = halfToFloat4(_mm_and_si128(ba, _mm_set1_epi32(0xffff)));
+            break;
+        }
+        case PixelFormat::FORMAT_RGBA8_SRGB: {
+            __m128i c = gather4i((const int *) src.data, pix);
+            r = gather4(src.srgb, _mm_and_si128(c, low));
+            g = gather4(src.srgb, _mm_and_si128(_mm_srli_epi32(c, 8), low));
+            b = gather4(src.srgb, _mm_and_si128(_mm_srli_epi32(c, 16), low));
+            break;
+        }
+        default: {
+            const float *floats = (const float *) src.data;
+            __m128i pix4 = _mm_slli_epi32(pix, 2);
+            r = gather4(floats, pix4);
+            g = gather4(floats + 1, pix4);
+            b = gather4(floats + 2, pix4);
+            break;
+        }
+    }
+}
+
+
+SSSS_TARGET("sse4.2")
+static inline __m128 fetchAlpha4(const Source &src, __m128i pix) {
+    switch (src.format) {
+        case PixelFormat::FORMAT_RGBA16F:
+            return halfToFloat4(_mm_srli_epi32(gather4i((const int *) src.data + 1, _mm_slli_epi32(pix, 1)), 16));
+        case PixelFormat::FORMAT_RGBA8_SRGB:
+            return gather4(src.unorm, _mm_srli_epi32(gather4i((const int *) src.data, pix), 24));
+        default:
+            return gather4((const float *) src.data + 3, _mm_slli_epi32(pix, 2));
+    }
+}
+
+
+/**
+ * AVX2 versions of the above. Halfs are converted with F16C.
+ */
+SSSS_TARGET("avx2,fma,f16c")
+static inline __m256 halfToFloat8(__m256i h) {
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(h, h), 0x08);
+    return _mm256_cvtph_ps(_mm256_castsi256_si128(packed));
+}
+
+
+SSSS_TARGET("avx2,fma,f16c")
+static inline void fetch8(const Source &src, __m256i pix, __m256 &r, __m256 &g, __m256 &b) {
+    const __m256i low = _mm256_set1_epi32(0xff);
+    switch (src.format) {
+        case PixelFormat::FORMAT_RGBA16F: {
+            const int *words = (const int *) src.data;
+            __m256i pix2 = _mm256_slli_epi32(pix, 1);
+            __m256i rg = _mm256_i32gather_epi32(words, pix2, 4);
+            __m256i ba = _mm256_i32gather_epi32(words + 1, pix2, 4);
+            r = halfToFloat8(_mm256_and_si256(rg, _mm256_set1_epi32(0xffff)));
+            g = halfToFloat8(_mm256_srli_epi32(rg, 16));
+            b = halfToFloat8(_mm256_and_si256(ba, _mm256_set1_epi32(0xffff)));
+            break;
+        }
+        case PixelFormat::FORMAT_RGBA8_SRGB: {
+            __m256i c = _mm256_i32gather_epi32((const int *) src.data, pix, 4);
+            r = _mm256_i32gather_ps(src.srgb, _mm256_and_si256(c, low), 4);
+            g = _mm256_i32gather_ps(src.srgb, _mm256_and_si256(_mm256_srli_epi32(c, 8), low), 4);
+            b = _mm256_i32gather_ps(src.srgb, _mm256_and_si256(_mm256_srli_epi32(c, 16), low), 4);
+            break;
+        }
+        default: {
+            const float *floats = (const float *) src.data;
+            __m256i pix4 = _mm256_slli_epi32(pix, 2);
+            r = _mm256_i32gather_ps(floats, pix4, 4);
+            g = _mm256_i32gather_ps(floats + 1, pix4, 4);
+            b = _mm256_i32gather_ps(floats + 2, pix4, 4);
+            break;
+        }
+    }
+}
+
+
+SSSS_TARGET("avx2,fma,f16c")
+static inline __m256 fetchAlpha8(const Source &src, __m256i pix) {
+    switch (src.format) {
+        case PixelFormat::FORMAT_RGBA16F:
+            return halfToFloat8(_mm256_srli_epi32(_mm256_i32gather_epi32((const int *) src.data + 1, _mm256_slli_epi32(pix, 1), 4), 16));
+        case PixelFormat::FORMAT_RGBA8_SRGB:
+            return _mm256_i32gather_ps(src.unorm, _mm256_srli_epi32(_mm256_i32gather_epi32((const int *) src.data, pix, 4), 24), 4);
+        default:
+            return _mm256_i32gather_ps((const float *) src.data + 3, _mm256_slli_epi32(pix, 2), 4);
+    }
+}
+
+
+/**
+ * AVX-512 versions of the above.
+ */
+SSSS_TARGET("avx512f")
+static inline __m512 halfToFloat16(__m512i h) {
+    return _mm512_cvtph_ps(_mm512_cvtepi32_epi16(h));
+}
+
+
+SSSS_TARGET("avx512f")
+static inline void fetch16(const Source &src, __m512i pix, __m512 &r, __m512 &g, __m512 &b) {
+    const __m512i low = _mm512_set1_epi32(0xff);
+    switch (src.format) {
+        case PixelFormat::FORMAT_RGBA16F: {
+            const int *words = (const int *) src.data;
+            __m512i pix2 = _mm512_slli_epi32(pix, 1);
+            __m512i rg = _mm512_i32gather_epi32(pix2, words, 4);
+            __m512i ba = _mm512_i32gather_epi32(pix2, words + 1, 4);
+            r = halfToFloat16(rg);
+            g = halfToFloat16(_mm512_srli_epi32(rg, 16));
+            b = halfToFloat16(ba);
+            break;
+        }
+        case PixelFormat::FORMAT_RGBA8_SRGB: {
+            __m512i c = _mm512_i32gather_epi32(pix, (const int *) src.data, 4);
+            r = _mm512_i32gather_ps(_mm512_and_si512(c, low), src.srgb, 4);
+            g = _mm512_i32gather_ps(_mm512_and_si512(_mm512_srli_epi32(c, 8), low), src.srgb, 4);
+            b = _mm512_i32gather_ps(_mm512_and_si512(_mm512_srli_epi32(c, 16), low), src.srgb, 4);
+            break;
+        }
+        default: {
+            const float *floats = (const float *) src.data;
+            __m512i pix4 = _mm512_slli_epi32(pix, 2);
+            r = _mm512_i32gather_ps(pix4, floats, 4);
+            g = _mm512_i32gather_ps(pix4, floats + 1, 4);
+            b = _mm512_i32gather_ps(pix4, floats + 2, 4);
+            break;
+        }
+    }
+}
+
+
+SSSS_TARGET("avx512f")
+static inline __m512 fetchAlpha16(const Source &src, __m512i pix) {
+    switch (src.format) {
+        case PixelFormat::FORMAT_RGBA16F:
+            return halfToFloat16(_mm512_srli_epi32(_mm512_i32gather_epi32(_mm512_slli_epi32(pix, 1), (const int *) src.data + 1, 4), 16));
+        case PixelFormat::FORMAT_RGBA8_SRGB:
+            return _mm512_i32gather_ps(_mm512_srli_epi32(_mm512_i32gather_epi32(pix, (const int *) src.data, 4), 24), src.unorm, 4);
+        default:
+            return _mm512_i32gather_ps(_mm512_slli_epi32(pix, 2), (const float *) src.data + 3, 4);
+    }
+}
+
+
+SSSS_TARGET("sse4.2")
+void BlurPass::runSSE42(int x0, int y0, int x1, int y1) const {
+    const int n = dir == HORIZONTAL? width : height;
+    const int stride = dir == HORIZONTAL? 1 : width;
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 last = _mm_set1_ps(float(n - 1));
+    const __m128i lastI = _mm_set1_epi32(n - 1);
+    const __m128i strideV = _mm_set1_epi32(stride);
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    const int pitch = checkerboard >= 0? 2 : 1;
+    const __m128i laneX = pitch == 2? _mm_add_epi32(lane, lane) : lane;
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 stepScale = _mm_set1_ps(sssWidth * distanceToProjectionWindow * (1.0f / 3.0f) * float(n));
+    const __m128 followScale = _mm_set1_ps(300.0f * distanceToProjectionWindow * sssWidth);
+    const int srcMask = srcRows > 0? srcRows - 1 : ~0;
+    const __m128i srcAlongMask = _mm_set1_epi32(dir == HORIZONTAL? ~0 : srcMask);
+    const Source source(*this);
+
+    const __m128 size = _mm_set1_ps(float(n));
+
+    const int rowBlock = dstTransposed? ColumnBlock::ROWS : 1;
+    ColumnBlock block;
+
+    for (int yb = y0; yb < y1; yb += rowBlock) {
+        const int ye = yb + rowBlock < y1? yb + rowBlock : y1;
+        for (int x = x0; x < x1; x += 4 * pitch) {
+            const int count = x1 - x < 4? x1 - x : 4;
+            block.clear();
+
+            for (int y = yb; y < ye; y++) {
+                int xs;
+                const int rowCount = groupSpan(*this, x, x1, y, 4, xs);
+                if (rowCount <= 0) continue;
+                const int i = y * width + xs;
+                const int si = (y & srcMask) * width + xs;
+                unsigned int mask = activeMask(*this, i, si, rowCount, pitch);
+                if (mask == 0) continue;
+
+                // Lanes past the end of the span replicate the last pixel:
+                __m128i xl = _mm_min_epi32(_mm_add_epi32(_mm_set1_epi32(xs), laneX), _mm_set1_epi32(xs + (rowCount - 1) * pitch));
+                __m128i pix = _mm_add_epi32(_mm_set1_epi32(y * width), xl);
+                __m128i spix = _mm_add_epi32(_mm_set1_epi32((y & srcMask) * width), xl);
+                __m128 along = dir == HORIZONTAL? _mm_cvtepi32_ps(xl) : _mm_set1_ps(float(y));
+                __m128i base = dir == HORIZONTAL? _mm_set1_epi32(y * width) : xl;
+                __m128i srcBase = dir == HORIZONTAL? _mm_set1_epi32((y & srcMask) * width) : xl;
+
+                // Fetch color and depth of current pixels:
+                __m128 rM, gM, bM;
+                fetch4(source, spix, rM, gM, bM);
+                __m128 aM = fetchAlpha4(source, spix);
+                __m128 sM = strength != NULL? gather4(strength, pix) : aM;
+                __m128 depthM = gather4(depth, pix);
+
+                // Calculate the final step to fetch the surrounding pixels:
+                __m128 finalStep = footprint != NULL?
+                    _mm_mul_ps(gather4(footprint, pix), size) :
+                    _mm_div_ps(_mm_mul_ps(stepScale, sM), depthM);
+
+                // Accumulate the center sample:
+                __m128 r = _mm_mul_ps(rM, _mm_set1_ps(kernel[0].r));
+                __m128 g = _mm_mul_ps(gM, _mm_set1_ps(kernel[0].g));
+                __m128 b = _mm_mul_ps(bM, _mm_set1_ps(kernel[0].b));
+
+                // Accumulate the other samples:
+                for (int k = 1; k < nSamples; k++) {
+                    __m128 t = _mm_add_ps(along, _mm_mul_ps(_mm_set1_ps(kernel[k].offset), finalStep));
+                    t = _mm_min_ps(_mm_max_ps(t, zero), last);
+                    __m128i t0 = _mm_cvttps_epi32(t);
+                    __m128i t1 = _mm_min_epi32(_mm_add_epi32(t0, _mm_set1_epi32(1)), lastI);
+                    __m128 f = _mm_sub_ps(t, _mm_cvtepi32_ps(t0));
+
+                    __m128i s0 = _mm_add_epi32(srcBase, _mm_mullo_epi32(_mm_and_si128(t0, srcAlongMask), strideV));
+                    __m128i s1 = _mm_add_epi32(srcBase, _mm_mullo_epi32(_mm_and_si128(t1, srcAlongMask), strideV));
+                    __m128 r0, g0, b0, r1, g1, b1;
+                    fetch4(source, s0, r0, g0, b0);
+                    fetch4(source, s1, r1, g1, b1);
+                    __m128 cr = _mm_add_ps(r0, _mm_mul_ps(f, _mm_sub_ps(r1, r0)));
+                    __m128 cg = _mm_add_ps(g0, _mm_mul_ps(f, _mm_sub_ps(g1, g0)));
+                    __m128 cb = _mm_add_ps(b0, _mm_mul_ps(f, _mm_sub_ps(b1, b0)));
+
+                    if (followSurface) {
+                        __m128i p0 = _mm_add_epi32(base, _mm_mullo_epi32(t0, strideV));
+                        __m128i p1 = _mm_add_epi32(base, _mm_mullo_epi32(t1, strideV));
+                        __m128 d0 = gather4(depth, p0), d1 = gather4(depth, p1);
+                        __m128 d = _mm_add_ps(d0, _mm_mul_ps(f, _mm_sub_ps(d1, d0)));
+                        __m128 w = _mm_mul_ps(followScale, _mm_and_ps(_mm_sub_ps(depthM, d), absMask));
+                        w = _mm_min_ps(w, one);
+                        cr = _mm_add_ps(cr, _mm_mul_ps(w, _mm_sub_ps(rM, cr)));
+                        cg = _mm_add_ps(cg, _mm_mul_ps(w, _mm_sub_ps(gM, cg)));
+                        cb = _mm_add_ps(cb, _mm_mul_ps(w, _mm_sub_ps(bM, cb)));
+                    }
+
+                    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(kernel[k].r), cr));
+                    g = _mm_add_ps(g, _mm_mul_ps(_mm_set1_ps(kernel[k].g), cg));
+                    b = _mm_add_ps(b, _mm_mul_ps(_mm_set1_ps(kernel[k].b), cb));
+                }
+
+                SSSS_ALIGN(16) float out[4][4];
+                _mm_store_ps(out[0], r);
+                _mm_store_ps(out[1], g);
+                _mm_store_ps(out[2], b);
+                _mm_store_ps(out[3], aM);
+                if (dstTransposed)
+                    block.store(y - yb, mask, out[0], out[1], out[2], out[3]);
+                else
+                    storeActive(*this, xs, y, pitch, mask, out[0], out[1], out[2], out[3]);
+            }
+
+            if (dstTransposed)
+                block.flush(*this, x, yb, ye - yb, count);
+        }
+    }
+}
+
+
+SSSS_TARGET("avx2,fma,f16c")
+void BlurPass::runAVX2(int x0, int y0, int x1, int y1) const {
+    const int n = dir == HORIZONTAL? width : height;
+    const int stride = dir == HORIZONTAL? 1 : width;
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 last = _mm256_set1_ps(float(n - 1));
+    const __m256i lastI = _mm256_set1_epi32(n - 1);
+    const __m256i strideV = _mm256_set1_epi32(stride);
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const int pitch = checkerboard >= 0? 2 : 1;
+    const __m256i laneX = pitch == 2? _mm256_add_epi32(lane, lane) : lane;
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 stepScale = _mm256_set1_ps(sssWidth * distanceToProjectionWindow * (1.0f / 3.0f) * float(n));
+    const __m256 followScale = _mm256_set1_ps(300.0f * distanceToProjectionWindow * sssWidth);
+    const int srcMask = srcRows > 0? srcRows - 1 : ~0;
+    const __m256i srcAlongMask = _mm256_set1_epi32(dir == HORIZONTAL? ~0 : srcMask);
+    const Source source(*this);
+
+    const __m256 size = _mm256_set1_ps(float(n));
+
+    const int rowBlock = dstTransposed? ColumnBlock::ROWS : 1;
+    ColumnBlock block;
+
+    for (int yb = y0; yb < y1; yb += rowBlock) {
+        const int ye = yb + rowBlock < y1? yb + rowBlock : y1;
+        for (int x = x0; x < x1; x += 8 * pitch) {
+            const int count = x1 - x < 8? x1 - x : 8;
+            block.clear();
+
+            for (int y = yb; y < ye; y++) {
+                int xs;
+                const int rowCount = groupSpan(*this, x, x1, y, 8, xs);
+                if (rowCount <= 0) continue;
+                const int i = y * width + xs;
+                const int si = (y & srcMask) * width + xs;
+                unsigned int mask = activeMask(*this, i, si, rowCount, pitch);
+                if (mask == 0) continue;
+
+                // Lanes past the end of the span replicate the last pixel:
+                __m256i xl = _mm256_min_epi32(_mm256_add_epi32(_mm256_set1_epi32(xs), laneX), _mm256_set1_epi32(xs + (rowCount - 1) * pitch));
+                __m256i pix = _mm256_add_epi32(_mm256_set1_epi32(y * width), xl);
+                __m256i spix = _mm256_add_epi32(_mm256_set1_epi32((y & srcMask) * width), xl);
+                __m256 along = dir == HORIZONTAL? _mm256_cvtepi32_ps(xl) : _mm256_set1_ps(float(y));
+                __m256i base = dir == HORIZONTAL? _mm256_set1_epi32(y * width) : xl;
+                __m256i srcBase = dir == HORIZONTAL? _mm256_set1_epi32((y & srcMask) * width) : xl;
+
+                // Fetch color and depth of current pixels:
+                __m256 rM, gM, bM;
+                fetch8(source, spix, rM, gM, bM);
+                __m256 aM = fetchAlpha8(source, spix);
+                __m256 sM = strength != NULL? _mm256_i32gather_ps(strength, pix, 4) : aM;
+                __m256 depthM = _mm256_i32gather_ps(depth, pix, 4);
+
+                // Calculate the final step to fetch the surrounding pixels:
+                __m256 finalStep = footprint != NULL?
+                    _mm256_mul_ps(_mm256_i32gather_ps(footprint, pix, 4), size) :
+                    _mm256_div_ps(_mm256_mul_ps(stepScale, sM), depthM);
+
+                // Accumulate the center sample:
+                __m256 r = _mm256_mul_ps(rM, _mm256_set1_ps(kernel[0].r));
+                __m256 g = _mm256_mul_ps(gM, _mm256_set1_ps(kernel[0].g));
+                __m256 b = _mm256_mul_ps(bM, _mm256_set1_ps(kernel[0].b));
+
+                // Accumulate the other samples:
+                for (int k = 1; k < nSamples; k++) {
+                    __m256 t = _mm256_fmadd_ps(_mm256_set1_ps(kernel[k].offset), finalStep, along);
+                    t = _mm256_min_ps(_mm256_max_ps(t, zero), last);
+                    __m256i t0 = _mm256_cvttps_epi32(t);
+                    __m256i t1 = _mm256_min_epi32(_mm256_add_epi32(t0, _mm256_set1_epi32(1)), lastI);
+                    __m256 f = _mm256_sub_ps(t, _mm256_cvtepi32_ps(t0));
+
+                    __m256i s0 = _mm256_add_epi32(srcBase, _mm256_mullo_epi32(_mm256_and_si256(t0, srcAlongMask), strideV));
+                    __m256i s1 = _mm256_add_epi32(srcBase, _mm256_mullo_epi32(_mm256_and_si256(t1, srcAlongMask), strideV));
+                    __m256 r0, g0, b0, r1, g1, b1;
+                    fetch8(source, s0, r0, g0, b0);
+                    fetch8(source, s1, r1, g1, b1);
+                    __m256 cr = _mm256_fmadd_ps(f, _mm256_sub_ps(r1, r0), r0);
+                    __m256 cg = _mm256_fmadd_ps(f, _mm256_sub_ps(g1, g0), g0);
+                    __m256 cb = _mm256_fmadd_ps(f, _mm256_sub_ps(b1, b0), b0);
+
+                    if (followSurface) {
+                        __m256i p0 = _mm256_add_epi32(base, _mm256_mullo_epi32(t0, strideV));
+                        __m256i p1 = _mm256_add_epi32(base, _mm256_mullo_epi32(t1, strideV));
+                        __m256 d0 = _mm256_i32gather_ps(depth, p0, 4), d1 = _mm256_i32gather_ps(depth, p1, 4);
+                        __m256 d = _mm256_fmadd_ps(f, _mm256_sub_ps(d1, d0), d0);
+                        __m256 w = _mm256_mul_ps(followScale, _mm256_and_ps(_mm256_sub_ps(depthM, d), absMask));
+                        w = _mm256_min_ps(w, one);
+                        cr = _mm256_fmadd_ps(w, _mm256_sub_ps(rM, cr), cr);
+                        cg = _mm256_fmadd_ps(w, _mm256_sub_ps(gM, cg), cg);
+                        cb = _mm256_fmadd_ps(w, _mm256_sub_ps(bM, cb), cb);
+                    }
+
+                    r = _mm256_fmadd_ps(_mm256_set1_ps(kernel[k].r), cr, r);
+                    g = _mm256_fmadd_ps(_mm256_set1_ps(kernel[k].g), cg, g);
+                    b = _mm256_fmadd_ps(_mm256_set1_ps(kernel[k].b), cb, b);
+                }
+
+                if (dstFormat == PixelFormat::FORMAT_RGBA16F && !dstTransposed) {
+                    SSSS_ALIGN(32) unsigned short out[4][8];
+                    _mm_store_si128((__m128i *) out[0], _mm256_cvtps_ph(r, _MM_FROUND_TO_NEAREST_INT));
+                    _mm_store_si128((__m128i *) out[1], _mm256_cvtps_ph(g, _MM_FROUND_TO_NEAREST_INT));
+                    _mm_store_si128((__m128i *) out[2], _mm256_cvtps_ph(b, _MM_FROUND_TO_NEAREST_INT));
+                    _mm_store_si128((__m128i *) out[3], _mm256_cvtps_ph(aM, _MM_FROUND_TO_NEAREST_INT));
+                    storeActive(*this, xs, y, pitch, mask, out[0], out[1], out[2], out[3]);
+                    continue;
+                }
+
+                SSSS_ALIGN(32) float out[4][8];
+                _mm256_store_ps(out[0], r);
+                _mm256_store_ps(out[1], g);
+                _mm256_store_ps(out[2], b);
+                _mm256_store_ps(out[3], aM);
+                if (dstTransposed)
+                    block.store(y - yb, mask, out[0], out[1], out[2], out[3]);
+                else
+                    storeActive(*this, xs, y, pitch, mask, out[0], out[1], out[2], out[3]);
+            }
+
+            if (dstTransposed)
+                block.flush(*this, x, yb, ye - yb, count);
+        }
+    }
+}
+
+
+SSSS_TARGET("avx512f")
+void BlurPass::runAVX512(int x0, int y0, int x1, int y1) const {
+    const int n = dir == HORIZONTAL? width : height;
+    const int stride = dir == HORIZONTAL? 1 : width;
+
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 last = _mm512_set1_ps(float(n - 1));
+    const __m512i lastI = _mm512_set1_epi32(n - 1);
+    const __m512i strideV = _mm512_set1_epi32(stride);
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const int pitch = checkerboard >= 0? 2 : 1;
+    const __m512i laneX = pitch == 2? _mm512_add_epi32(lane, lane) : lane;
+    const __m512 stepScale = _mm512_set1_ps(sssWidth * distanceToProjectionWindow * (1.0f / 3.0f) * float(n));
+    const __m512 followScale = _mm512_set1_ps(300.0f * distanceToProjectionWindow * sssWidth);
+    const int srcMask = srcRows > 0? srcRows - 1 : ~0;
+    const __m512i srcAlongMask = _mm512_set1_epi32(dir == HORIZONTAL? ~0 : srcMask);
+    const Source source(*this);
+
+    const __m512 size = _mm512_set1_ps(float(n));
+
+    const int rowBlock = dstTransposed? ColumnBlock::ROWS : 1;
+    ColumnBlock block;
+
+    for (int yb = y0; yb < y1; yb += rowBlock) {
+        const int ye = yb + rowBlock < y1? yb + rowBlock : y1;
+        for (int x = x0; x < x1; x += 16 * pitch) {
+            const int count = x1 - x < 16? x1 - x : 16;
+            block.clear();
+
+            for (int y = yb; y < ye; y++) {
+                int xs;
+                const int rowCount = groupSpan(*this, x, x1, y, 16, xs);
+                if (rowCount <= 0) continue;
+                const int i = y * width + xs;
+                const int si = (y & srcMask) * width + xs;
+                unsigned int mask = activeMask(*this, i, si, rowCount, pitch);
+                if (mask == 0) continue;
+
+                // Lanes past the end of the span replicate the last pixel:
+                __m512i xl = _mm512_min_epi32(_mm512_add_epi32(_mm512_set1_epi32(xs), laneX), _mm512_set1_epi32(xs + (rowCount - 1) * pitch));
+                __m512i pix = _mm512_add_epi32(_mm512_set1_epi32(y * width), xl);
+                __m512i spix = _mm512_add_epi32(_mm512_set1_epi32((y & srcMask) * width), xl);
+                __m512 along = dir == HORIZONTAL? _mm512_cvtepi32_ps(xl) : _mm512_set1_ps(float(y));
+                __m512i base = dir == HORIZONTAL? _mm512_set1_epi32(y * width) : xl;
+                __m512i srcBase = dir == HORIZONTAL? _mm512_set1_epi32((y & srcMask) * width) : xl;
+
+                // Fetch color and depth of current pixels:
+                __m512 rM, gM, bM;
+                fetch16(source, spix, rM, gM, bM);
+                __m512 aM = fetchAlpha16(source, spix);
+                __m512 sM = strength != NULL? _mm512_i32gather_ps(pix, strength, 4) : aM;
+                __m512 depthM = _mm512_i32gather_ps(pix, depth, 4);
+
+                // Calculate the final step to fetch the surrounding pixels:
+                __m512 finalStep = footprint != NULL?
+                    _mm512_mul_ps(_mm512_i32gather_ps(pix, footprint, 4), size) :
+                    _mm512_div_ps(_mm512_mul_ps(stepScale, sM), depthM);
+
+                // Accumulate the center sample:
+                __m512 r = _mm512_mul_ps(rM, _mm512_set1_ps(kernel[0].r));
+                __m512 g = _mm512_mul_ps(gM, _mm512_set1_ps(kernel[0].g));
+                __m512 b = _mm512_mul_ps(bM, _mm512_set1_ps(kernel[0].b));
+
+                // Accumulate the other samples:
+                for (int k = 1; k < nSamples; k++) {
+                    __m512 t = _mm512_fmadd_ps(_mm512_set1_ps(kernel[k].offset), finalStep, along);
+                    t = _mm512_min_ps(_mm512_max_ps(t, zero), last);
+                    __m512i t0 = _mm512_cvttps_epi32(t);
+                    __m512i t1 = _mm512_min_epi32(_mm512_add_epi32(t0, _mm512_set1_epi32(1)), lastI);
+                    __m512 f = _mm512_sub_ps(t, _mm512_cvtepi32_ps(t0));
+
+                    __m512i s0 = _mm512_add_epi32(srcBase, _mm512_mullo_epi32(_mm512_and_si512(t0, srcAlongMask), strideV));
+                    __m512i s1 = _mm512_add_epi32(srcBase, _mm512_mullo_epi32(_mm512_and_si512(t1, srcAlongMask), strideV));
+                    __m512 r0, g0, b0, r1, g1, b1;
+                    fetch16(source, s0, r0, g0, b0);
+                    fetch16(source, s1, r1, g1, b1);
+                    __m512 cr = _mm512_fmadd_ps(f, _mm512_sub_ps(r1, r0), r0);
+                    __m512 cg = _mm512_fmadd_ps(f, _mm512_sub_ps(g1, g0), g0);
+                    __m512 cb = _mm512_fmadd_ps(f, _mm512_sub_ps(b1, b0), b0);
+
+                    if (followSurface) {
+                        __m512i p0 = _mm512_add_epi32(base, _mm512_mullo_epi32(t0, strideV));
+                        __m512i p1 = _mm512_add_epi32(base, _mm512_mullo_epi32(t1, strideV));
+                        __m512 d0 = _mm512_i32gather_ps(p0, depth, 4), d1 = _mm512_i32gather_ps(p1, depth, 4);
+                        __m512 d = _mm512_fmadd_ps(f, _mm512_sub_ps(d1, d0), d0);
+                        __m512 w = _mm512_mul_ps(followScale, _mm512_abs_ps(_mm512_sub_ps(depthM, d)));
+                        w = _mm512_min_ps(w, one);
+                        cr = _mm512_fmadd_ps(w, _mm512_sub_ps(rM, cr), cr);
+                        cg = _mm512_fmadd_ps(w, _mm512_sub_ps(gM, cg), cg);
+                        cb = _mm512_fmadd_ps(w, _mm512_sub_ps(bM, cb), cb);
+                    }
+
+                    r = _mm512_fmadd_ps(_mm512_set1_ps(kernel[k].r), cr, r);
+                    g = _mm512_fmadd_ps(_mm512_set1_ps(kernel[k].g), cg, g);
+                    b = _mm512_fmadd_ps(_mm512_set1_ps(kernel[k].b), cb, b);
+                }
+
+                if (dstFormat == PixelFormat::FORMAT_RGBA16F && !dstTransposed) {
+                    SSSS_ALIGN(64) unsigned short out[4][16];
+                    _mm256_store_si256((__m256i *) out[0], _mm512_cvtps_ph(r, _MM_FROUND_TO_NEAREST_INT));
+                    _mm256_store_si256((__m256i *) out[1], _mm512_cvtps_ph(g, _MM_FROUND_TO_NEAREST_INT));
+                    _mm256_store_si256((__m256i *) out[2], _mm512_cvtps_ph(b, _MM_FROUND_TO_NEAREST_INT));
+                    _mm256_store_si256((__m256i *) out[3], _mm512_cvtps_ph(aM, _MM_FROUND_TO_NEAREST_INT));
+                    storeActive(*this, xs, y, pitch, mask, out[0], out[1], out[2], out[3]);
+                    continue;
+                }
+
+                SSSS_ALIGN(64) float out[4][16];
+                _mm512_store_ps(out[0], r);
+                _mm512_store_ps(out[1], g);
+                _mm512_store_ps(out[2], b);
+                _mm512_store_ps(out[3], aM);
+                if (dstTransposed)
+                    block.store(y - yb, mask, out[0], out[1], out[2], out[3]);
+                else
+                    storeActive(*this, xs, y, pitch, mask, out[0], out[1], out[2], out[3]);
+            }
+
+            if (dstTransposed)
+                block.flush(*this, x, yb, ye - yb, count);
+        }
+    }
+}
+
+#else
+
+void BlurPass::runSSE42(int x0, int y0, int x1, int y1) const { runScalar(x0, y0, x1, y1); }
+void BlurPass::runAVX2(int x0, int y0, int x1, int y1) const { runScalar(x0, y0, x1, y1); }
+void BlurPass::runAVX512(int x0, int y0, int x1, int y1) const { runScalar(x0, y0, x1, y1); }
+
+#endif
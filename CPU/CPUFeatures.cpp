@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include "CPUFeatures.h"
+
+#if SSSS_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+
+#if SSSS_X86
+static void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+    #if defined(_MSC_VER)
+    __cpuidex((int *) regs, leaf, subleaf);
+    #else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+}
+
+
+static unsigned long long xgetbv() {
+    #if defined(_MSC_VER)
+    return _xgetbv(0);
+    #else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (unsigned long long) edx << 32 | eax;
+    #endif
+}
+#endif
+
+
+CPUFeatures::CPUFeatures() : sse42(false), avx2(false), f16c(false), avx512(false) {
+    #if SSSS_X86
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    int maxLeaf = int(regs[0]);
+
+    cpuid(1, 0, regs);
+    unsigned int ecx1 = regs[2];
+    sse42 = (ecx1 & (1 << 20)) != 0;
+
+    // AVX state must be enabled by the OS (XMM and YMM registers):
+    bool osxsave = (ecx1 & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave? xgetbv() : 0;
+    bool avxState = (xcr0 & 0x06) == 0x06;
+    bool avx512State = (xcr0 & 0xe6) == 0xe6;
+
+    bool avx = avxState && (ecx1 & (1 << 28)) != 0;
+    bool fma = (ecx1 & (1 << 12)) != 0;
+    f16c = avx && (ecx1 & (1 << 29)) != 0;
+
+    if (maxLeaf >= 7) {
+        cpuid(7, 0, regs);
+        unsigned int ebx7 = regs[1];
+        avx2 = avx && fma && (ebx7 & (1 << 5)) != 0;
+        avx512 = avx2 && avx512State && (ebx7 & (1 << 16)) != 0;
+    }
+    #endif
+}
+
+
+const CPUFeatures &CPUFeatures::get() {
+    static CPUFeatures features;
+    return features;
+}
@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SSSS_X86 1
+#else
+#define SSSS_X86 0
+#endif
+
+/**
+ * Allows to compile a single function for a specific instruction set, without
+ * requiring special compiler flags for the whole translation unit (MSVC
+ * doesn't need them to emit these instructions, so it's a no-op there).
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define SSSS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SSSS_TARGET(isa)
+#endif
+
+#if defined(_MSC_VER)
+#define SSSS_ALIGN(n) __declspec(align(n))
+#else
+#define SSSS_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
+/**
+ * Runtime detection of the instruction sets used by the CPU backends. Both
+ * the CPU and the operating system must support them (the latter is required
+ * for saving the wider registers on context switches).
+ */
+class CPUFeatures {
+    public:
+        static bool hasSSE42() { return get().sse42; }
+        static bool hasAVX2() { return get().avx2; }
+        static bool hasF16C() { return get().f16c; }
+        static bool hasAVX512() { return get().avx512; }
+
+    private:
+        CPUFeatures();
+        static const CPUFeatures &get();
+
+        bool sse42;
+        bool avx2;
+        bool f16c;
+        bool avx512;
+};
+
+#endif
@@ -0,0 +1,249 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "Checkerboard.h"
+using namespace std;
+
+
+static const int BAND_HEIGHT = 64;
+
+
+static inline float strengthOf(const BlurPass &pass, int i) {
+    return pass.strength != NULL? pass.strength[i] : PixelFormat::loadAlpha(pass.srcFormat, pass.src, i);
+}
+
+
+/**
+ * Same stencil test as 'BlurPass::run' (without initializing the stencil).
+ */
+static inline bool isActive(const BlurPass &pass, int i, float s) {
+    if (pass.initStencil != NULL)
+        return s != 0.0f;
+    return pass.stencil == NULL || pass.stencil[i] == pass.id;
+}
+
+
+int Checkerboard::run(const BlurPass &pass, int parity, float maxResidualDifference, BlurPass::Backend backend, ThreadPool *pool) {
+    BlurPass half = pass;
+    half.checkerboard = parity;
+
+    const BlurPass *p = &half;
+    for (int y0 = 0; y0 < pass.height; y0 += BAND_HEIGHT) {
+        int y1 = min(y0 + BAND_HEIGHT, pass.height);
+        if (pool != NULL)
+            pool->submit([p, y0, y1, backend] { p->run(0, y0, p->width, y1, backend); });
+        else
+            half.run(0, y0, pass.width, y1, backend);
+    }
+    if (pool != NULL)
+        pool->wait();
+
+    // Reconstruction only reads the pixels written above, so the bands
+    // can go in parallel again. The pixels that cannot be reconstructed get
+    // marked in 'full':
+    const int nBands = (pass.height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    vector<unsigned char> full(pass.width * pass.height, 0);
+    vector<int> counts(nBands, 0);
+    const BlurPass *q = &pass;
+    unsigned char *f = &full.front();
+    for (int band = 0; band < nBands; band++) {
+        int y0 = band * BAND_HEIGHT, y1 = min(y0 + BAND_HEIGHT, pass.height);
+        int *count = &counts[band];
+        if (pool != NULL)
+            pool->submit([q, parity, maxResidualDifference, y0, y1, f, count] { reconstruct(*q, parity, maxResidualDifference, y0, y1, f, count); });
+        else
+            reconstruct(pass, parity, maxResidualDifference, y0, y1, f, count);
+    }
+    if (pool != NULL)
+        pool->wait();
+
+    // And evaluate those in full, with the marks as the stencil:
+    BlurPass rest = pass;
+    rest.checkerboard = parity ^ 1;
+    rest.stencil = f;
+    rest.initStencil = NULL;
+    rest.id = 1;
+
+    const BlurPass *r = &rest;
+    int total = 0;
+    for (int band = 0; band < nBands; band++) {
+        total += counts[band];
+        if (counts[band] == 0)
+            continue;
+        int y0 = band * BAND_HEIGHT, y1 = min(y0 + BAND_HEIGHT, pass.height);
+        if (pool != NULL)
+            pool->submit([r, y0, y1, backend] { r->run(0, y0, r->width, y1, backend); });
+        else
+            rest.run(0, y0, pass.width, y1, backend);
+    }
+    if (pool != NULL)
+        pool->wait();
+    return total;
+}
+
+
+/**
+ * Fills 'row' with the residual of each evaluated pixel of row 'y' (its
+ * result minus its center tap), its strength, which is set to -1 for the
+ * pixels that fail the stencil test, and its color, ROW_STRIDE floats per
+ * pixel.
+ */
+static const int ROW_STRIDE = 8;
+
+static void prepareRow(const BlurPass &pass, int parity, int y, float *row) {
+    const KernelSample &center = pass.kernel[0];
+    for (int x = (y + parity) & 1; x < pass.width; x += 2) {
+        const int i = y * pass.width + x;
+        float *r = row + ROW_STRIDE * x;
+        float s = strengthOf(pass, i);
+        if (!isActive(pass, i, s)) {
+            r[3] = -1.0f;
+            continue;
+        }
+
+        float c[4], b[4];
+        PixelFormat::load(pass.srcFormat, pass.src, i, c);
+        PixelFormat::load(pass.dstFormat, pass.dst, i, b);
+        r[0] = b[0] - center.r * c[0];
+        r[1] = b[1] - center.g * c[1];
+        r[2] = b[2] - center.b * c[2];
+        r[3] = s;
+        r[4] = c[0];
+        r[5] = c[1];
+        r[6] = c[2];
+    }
+}
+
+
+void Checkerboard::reconstruct(const BlurPass &shared, int parity, float maxResidualDifference,
+                               int y0, int y1, unsigned char *full, int *count) {
+    const BlurPass pass = shared;
+    const int width = pass.width, height = pass.height;
+    const float surfaceScale = 300.0f * pass.distanceToProjectionWindow * pass.sssWidth;
+    const KernelSample &center = pass.kernel[0];
+    const float centerWeights[3] = { center.r, center.g, center.b };
+
+    // Each evaluated pixel is the neighbour of up to four others, so the rows
+    // around the current one are decoded in advance, in a ring of three:
+    const int rowSize = ROW_STRIDE * width;
+    vector<float> ring(3 * rowSize);
+    for (int y = max(y0 - 1, 0); y <= y0; y++)
+        prepareRow(pass, parity, y, &ring[rowSize * (y % 3)]);
+
+    for (int y = y0; y < y1; y++) {
+        if (y + 1 < height)
+            prepareRow(pass, parity, y + 1, &ring[rowSize * ((y + 1) % 3)]);
+        const float *above = y > 0? &ring[rowSize * ((y - 1) % 3)] : NULL;
+        const float *current = &ring[rowSize * (y % 3)];
+        const float *below = y + 1 < height? &ring[rowSize * ((y + 1) % 3)] : NULL;
+
+        for (int x = (y + parity + 1) & 1; x < width; x += 2) {
+            const int i = y * width + x;
+            float sM = strengthOf(pass, i);
+            if (!isActive(pass, i, sM))
+                continue;
+            if (pass.initStencil != NULL)
+                pass.initStencil[i] = (unsigned char) pass.id;
+            float depthM = pass.depth[i];
+
+            // Interpolate the taps other than the center one:
+            const float *neighbours[4] = { x > 0? current + ROW_STRIDE * (x - 1) : NULL,
+                                           x + 1 < width? current + ROW_STRIDE * (x + 1) : NULL,
+                                           above != NULL? above + ROW_STRIDE * x : NULL,
+                                           below != NULL? below + ROW_STRIDE * x : NULL };
+            const int offsets[4] = { -1, 1, -width, width };
+            float sum[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }, total = 0.0f;
+            float lo[3] = { 0.0f, 0.0f, 0.0f }, hi[3] = { 0.0f, 0.0f, 0.0f };
+            int usable = 0;
+            for (int k = 0; k < 4; k++) {
+                const float *r = neighbours[k];
+                if (r == NULL || r[3] < 0.0f)
+                    continue;
+
+                float w = max(0.0f, 1.0f - surfaceScale * abs(depthM - pass.depth[i + offsets[k]]));
+                if (r[3] != sM)
+                    w *= min(r[3], sM) / max(r[3], sM);
+                if (!(w > 0.0f))
+                    continue;
+
+                for (int c = 0; c < 3; c++) {
+                    lo[c] = total == 0.0f? r[c] : min(lo[c], r[c]);
+                    hi[c] = total == 0.0f? r[c] : max(hi[c], r[c]);
+                    sum[c] += w * r[c];
+                    sum[3 + c] += w * r[4 + c];
+                }
+                total += w;
+                usable++;
+            }
+
+            /**
+             * The interpolation fails next to silhouettes and to the edges
+             * of the stencil and of the frame, where some neighbour is not
+             * usable (the taps of the pixel reach further into what lies
+             * beyond than the ones of the others, and without follow-surface
+             * they blur it in), where the residuals of the neighbours
+             * disagree (edges of the lighting, of the strength...), and where
+             * the color of the pixel differs from theirs: the taps that follow-surface lerps back to
+             * the center color carry the color of each pixel into its own
+             * residual, which then can't be taken from the neighbours. The
+             * error of the latter is at most the non-center weight times the
+             * difference in color.
+             */
+            float colorM[4];
+            PixelFormat::load(pass.srcFormat, pass.src, i, colorM);
+            bool smooth = usable == 4;
+            float inv = 1.0f / total;
+            for (int c = 0; c < 3 && smooth; c++) {
+                float colorError = (1.0f - centerWeights[c]) * abs(colorM[c] - sum[3 + c] * inv);
+                smooth = hi[c] - lo[c] <= maxResidualDifference && colorError <= maxResidualDifference;
+            }
+            if (!smooth) {
+                full[i] = 1;
+                (*count)++;
+                continue;
+            }
+
+            float out[4] = { center.r * colorM[0] + sum[0] * inv,
+                             center.g * colorM[1] + sum[1] * inv,
+                             center.b * colorM[2] + sum[2] * inv,
+                             colorM[3] };
+            PixelFormat::store(pass.dstFormat, pass.dst, i, out);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef CHECKERBOARD_H
+#define CHECKERBOARD_H
+
+#include "BlurPass.h"
+#include "ThreadPool.h"
+
+/**
+ * Half rate evaluation of a pass (see 'SeparableSSSCPU::setCheckerboard').
+ *
+ * The pass is only run over the pixels of one parity of a checkerboard (see
+ * 'BlurPass::checkerboard'), which halves its taps. Each of the other pixels
+ * is then reconstructed from its four neighbours, which all belong to the
+ * evaluated parity, with a cross filter:
+ *   - Neighbours that fail the stencil test are skipped.
+ *   - Neighbours are weighted by their difference in depth, using the same
+ *     test as follow-surface ('SSSS_FOLLOW_SURFACE'), so that silhouettes
+ *     are not blurred into the skin.
+ *   - And by the ratio of their SSS strengths, as the footprint of the
+ *     kernel is proportional to the strength.
+ * As the blurred result of a pixel is mostly driven by its own color (the
+ * center tap of the kernel), only the contribution of the other taps (the
+ * residual) is interpolated, and the center one is evaluated for the pixel
+ * itself. When some neighbour is not usable (next to silhouettes and to the
+ * edges of the stencil and of the frame), or when the residuals of the
+ * neighbours (or their colors, see 'reconstruct') differ too much, the pixel
+ * is evaluated in full instead; these pixels are gathered and run after the
+ * reconstruction, with the selected backend. The reconstruction itself is
+ * plain C++ code, whatever the backend, and costs about as much as the half
+ * pass with the AVX-512 backend and 17 samples, so with that backend the mode
+ * only pays off with more samples or slower backends.
+ *
+ * The reconstruction follows each pass, so the vertical pass reads a
+ * complete output of the horizontal one.
+ */
+class Checkerboard {
+    public:
+        /**
+         * Runs 'pass' over the pixels whose '(x + y) & 1' equals 'parity',
+         * and reconstructs the other ones. 'dst' must be a full size buffer,
+         * not transposed, and 'src' must be full size too.
+         *
+         * Pixels with some neighbour that is not usable, whose neighbours
+         * have residuals that differ more than 'maxResidualDifference' in
+         * any channel, or whose color would bring an error larger than
+         * that, are evaluated in full. Returns the number of them.
+         */
+        static int run(const BlurPass &pass, int parity, float maxResidualDifference,
+                       BlurPass::Backend backend, ThreadPool *pool=NULL);
+
+    private:
+        static void reconstruct(const BlurPass &pass, int parity, float maxResidualDifference,
+                                int y0, int y1, unsigned char *full, int *count);
+};
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "Footprint.h"
+using namespace std;
+
+
+void Footprint::build(const BlurPass &pass, int tileWidth, int tileHeight, ThreadPool *pool) {
+    width = pass.width;
+    height = pass.height;
+    this->tileWidth = tileWidth;
+    this->tileHeight = tileHeight;
+    tilesX = (width + tileWidth - 1) / tileWidth;
+    tilesY = (height + tileHeight - 1) / tileHeight;
+    data.resize(width * height);
+    maxSteps.resize(tilesX * tilesY);
+
+    const BlurPass *p = &pass;
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            if (pool != NULL)
+                pool->submit([this, p, tx, ty] { buildTile(*p, tx, ty); });
+            else
+                buildTile(pass, tx, ty);
+        }
+    }
+    if (pool != NULL)
+        pool->wait();
+}
+
+
+void Footprint::buildTile(const BlurPass &pass, int tx, int ty) {
+    int x0 = tx * tileWidth, x1 = min(x0 + tileWidth, width);
+    int y0 = ty * tileHeight, y1 = min(y0 + tileHeight, height);
+
+    float maxStep = 0.0f;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            const int i = y * width + x;
+            float s = pass.strength != NULL? pass.strength[i] : PixelFormat::loadAlpha(pass.srcFormat, pass.src, i);
+            float depthM = pass.depth[i];
+
+            // Same stencil test as 'BlurPass::run':
+            bool active;
+            if (pass.initStencil != NULL)
+                active = s != 0.0f;
+            else
+                active = pass.stencil == NULL || pass.stencil[i] == pass.id;
+
+            // Same operations as 'BlurPass::run', so that the results match
+            // exactly:
+            float step = 0.0f;
+            if (active) {
+                float scale = pass.distanceToProjectionWindow / depthM;
+                step = pass.sssWidth * scale * s * (1.0f / 3.0f);
+                if (!(abs(step) < numeric_limits<float>::max())) // Infinities and NaNs
+                    maxStep = numeric_limits<float>::infinity();
+                else
+                    maxStep = max(maxStep, abs(step));
+            }
+
+            data[i] = step;
+        }
+    }
+    maxSteps[ty * tilesX + tx] = maxStep;
+}
+
+
+int Footprint::reach(const BlurPass &pass, int tx, int ty) const {
+    const int n = pass.dir == BlurPass::HORIZONTAL? pass.width : pass.height;
+
+    float maxOffset = 0.0f;
+    for (int k = 1; k < pass.nSamples; k++)
+        maxOffset = max(maxOffset, abs(pass.kernel[k].offset));
+
+    float maxStep = getMaxStep(tx, ty);
+    if (!(maxStep < numeric_limits<float>::max()))
+        return n;
+
+    float r = maxOffset * maxStep * float(n);
+    return r < float(n)? int(ceil(r)) + 1 : n;
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+#include <vector>
+#include "BlurPass.h"
+#include "ThreadPool.h"
+
+/**
+ * Per-pixel blur footprint, calculated once per frame and shared by both
+ * passes (see 'BlurPass::footprint'): the step between samples of each pixel,
+ * in texcoord units per unit of kernel offset (passes multiply it by the size
+ * of the image along their axis). It's zero for the pixels that won't be
+ * processed.
+ *
+ * Together with the depth buffer, which is already one float per pixel, it's
+ * all the passes need to place their taps.
+ *
+ * The largest step of each tile is also kept, so that schedulers can find how
+ * far the taps of a tile reach, or classify tiles, without visiting their
+ * pixels.
+ */
+class Footprint {
+    public:
+        Footprint() : width(0), height(0), tileWidth(0), tileHeight(0), tilesX(0), tilesY(0) {}
+
+        /**
+         * Calculates the footprint of the pixels processed by 'pass' (only
+         * its depth, strength, stencil and width parameters are used). The
+         * work is split in tiles of the specified size, which run on 'pool'
+         * if it's not NULL.
+         */
+        void build(const BlurPass &pass, int tileWidth, int tileHeight, ThreadPool *pool=NULL);
+
+        const float *getData() const { return &data.front(); }
+
+        int getTileWidth() const { return tileWidth; }
+        int getTileHeight() const { return tileHeight; }
+        int getTilesX() const { return tilesX; }
+        int getTilesY() const { return tilesY; }
+
+        /**
+         * Largest step of the pixels in tile (tx, ty). It's infinite if the
+         * step of any of them is infinite or NaN.
+         */
+        float getMaxStep(int tx, int ty) const { return maxSteps[ty * tilesX + tx]; }
+
+        /**
+         * Same as 'BlurPass::reach', for the pixels of tile (tx, ty), using
+         * the kernel and axis of 'pass'.
+         */
+        int reach(const BlurPass &pass, int tx, int ty) const;
+
+    private:
+        void buildTile(const BlurPass &pass, int tx, int ty);
+
+        int width, height;
+        int tileWidth, tileHeight;
+        int tilesX, tilesY;
+        std::vector<float> data;
+        std::vector<float> maxSteps;
+};
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include "FrameRecorder.h"
+using namespace std;
+
+
+FrameRecorder::FrameRecorder(int logSize) : logSize(logSize) {
+    log.reserve(logSize);
+    reset();
+}
+
+
+void FrameRecorder::record(double milliseconds) {
+    milliseconds = max(milliseconds, 0.0);
+
+    double us = floor(milliseconds * 1000.0 + 0.5);
+    unsigned int microseconds = us < 4294967295.0? (unsigned int) us : 4294967295u;
+    buckets[getBucket(microseconds)]++;
+
+    count++;
+    sum += milliseconds;
+    minimum = min(minimum, milliseconds);
+    maximum = max(maximum, milliseconds);
+
+    if (int(log.size()) < logSize)
+        log.push_back(float(milliseconds));
+}
+
+
+void FrameRecorder::reset() {
+    fill(buckets, buckets + N_BUCKETS, 0u);
+    count = 0;
+    sum = 0.0;
+    minimum = numeric_limits<double>::infinity();
+    maximum = 0.0;
+    log.clear();
+}
+
+
+double FrameRecorder::getMean() const {
+    return count > 0? sum / double(count) : 0.0;
+}
+
+
+double FrameRecorder::getMin() const {
+    return count > 0? minimum : 0.0;
+}
+
+
+double FrameRecorder::getMax() const {
+    return maximum;
+}
+
+
+double FrameRecorder::getPercentile(double percentile) const {
+    if (count == 0)
+        return 0.0;
+
+    // Rank of the frame we are looking for, starting at 1:
+    long long rank = (long long) ceil(percentile / 100.0 * double(count));
+    rank = min(max(rank, 1LL), count);
+
+    long long accumulated = 0;
+    for (int i = 0; i < N_BUCKETS; i++) {
+        accumulated += buckets[i];
+        if (accumulated >= rank)
+            return min(max(getBucketValue(i), minimum), maximum);
+    }
+    return maximum;
+}
+
+
+double FrameRecorder::getAverageFPS() const {
+    return sum > 0.0? 1000.0 * double(count) / sum : 0.0;
+}
+
+
+double FrameRecorder::getLowFPS(double fraction) const {
+    if (count == 0)
+        return 0.0;
+
+    // Average the slowest frames, walking the histogram from the top:
+    long long n = max((long long) ceil(fraction * double(count)), 1LL);
+    long long left = n;
+    double total = 0.0;
+    for (int i = N_BUCKETS - 1; i >= 0 && left > 0; i--) {
+        long long taken = min((long long) buckets[i], left);
+        total += double(taken) * min(max(getBucketValue(i), minimum), maximum);
+        left -= taken;
+    }
+    return total > 0.0? 1000.0 * double(n) / total : 0.0;
+}
+
+
+FrameRecorder::Stats FrameRecorder::getStats() const {
+    Stats stats;
+    stats.count = count;
+    stats.mean = getMean();
+    stats.min = getMin();
+    stats.max = getMax();
+    stats.p50 = getPercentile(50.0);
+    stats.p90 = getPercentile(90.0);
+    stats.p95 = getPercentile(95.0);
+    stats.p99 = getPercentile(99.0);
+    stats.p999 = getPercentile(99.9);
+    stats.averageFPS = getAverageFPS();
+    stats.low1FPS = getLowFPS(0.01);
+    stats.low01FPS = getLowFPS(0.001);
+    return stats;
+}
+
+
+void FrameRecorder::print(ostream &out) const {
+    Stats stats = getStats();
+    out << "Frames: " << stats.count << endl;
+    out << "Average FPS: " << stats.averageFPS << endl;
+    out << "1% low FPS: " << stats.low1FPS << endl;
+    out << "0.1% low FPS: " << stats.low01FPS << endl;
+    out << "Frame time (ms): mean " << stats.mean << ", min " << stats.min << ", max " << stats.max << endl;
+    out << "Percentiles (ms): p50 " << stats.p50 << ", p90 " << stats.p90 << ", p95 " << stats.p95
+        << ", p99 " << stats.p99 << ", p99.9 " << stats.p999 << endl;
+}
+
+
+void FrameRecorder::writeCSV(ostream &out) const {
+    out << "frame,milliseconds" << endl;
+    for (int i = 0; i < int(log.size()); i++)
+        out << i << "," << log[i] << endl;
+}
+
+
+void FrameRecorder::writeHistogramCSV(ostream &out) const {
+    out << "milliseconds,frames,percentile" << endl;
+    long long accumulated = 0;
+    for (int i = 0; i < N_BUCKETS; i++) {
+        if (buckets[i] == 0)
+            continue;
+        accumulated += buckets[i];
+        out << getBucketValue(i) << "," << buckets[i] << "," << 100.0 * double(accumulated) / double(count) << endl;
+    }
+}
+
+
+int FrameRecorder::getBucket(unsigned int microseconds) {
+    // Number of low bits to drop so that SUB_BITS remain:
+    int shift = 0;
+    while ((microseconds >> shift) >= (1u << SUB_BITS))
+        shift++;
+    return shift * HALF + int(microseconds >> shift);
+}
+
+
+double FrameRecorder::getBucketValue(int bucket) {
+    int shift = bucket < 2 * HALF? 0 : bucket / HALF - 1;
+    double first = double((unsigned long long) (bucket - shift * HALF) << shift);
+    double width = double(1ULL << shift);
+    return (first + (width - 1.0) / 2.0) / 1000.0;
+}
@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+
+#include <iosfwd>
+#include <vector>
+
+/**
+ * Records the distribution of frame times, for benchmarking. Frame times go
+ * into a log-linear histogram of fixed size (in the style of HdrHistogram),
+ * with a resolution of 1 microsecond or 0.4%, whichever is bigger, up to
+ * more than an hour; so recording never allocates, and runs of any length
+ * cost the same memory. Optionally, the first frames are also kept one by
+ * one, for dumping the whole series.
+ *
+ * Unlike counting frames per second, this shows stutter: a single 100ms
+ * hitch among 60fps frames is invisible in the FPS counts of its second,
+ * but shows in the 99th percentile and in the 1% low.
+ */
+class FrameRecorder {
+    public:
+        struct Stats {
+            long long count;
+            double mean, min, max; // In milliseconds
+            double p50, p90, p95, p99, p999; // In milliseconds
+            double averageFPS;
+            double low1FPS, low01FPS; // 1% and 0.1% lows (see 'getLowFPS')
+        };
+
+        /**
+         * Up to 'logSize' frame times are also kept in order, for
+         * 'writeCSV'.
+         */
+        FrameRecorder(int logSize=0);
+
+        /**
+         * Adds a frame that took 'milliseconds' (negative values are taken
+         * as zero).
+         */
+        void record(double milliseconds);
+        void reset();
+
+        long long getCount() const { return count; }
+
+        /**
+         * Mean, minimum and maximum are exact; percentiles are accurate up
+         * to the precision of the histogram.
+         */
+        double getMean() const;
+        double getMin() const;
+        double getMax() const;
+
+        /**
+         * Frame time below which 'percentile' percent of the frames are.
+         */
+        double getPercentile(double percentile) const;
+
+        /**
+         * Frames per second counting all the frames.
+         */
+        double getAverageFPS() const;
+
+        /**
+         * Frames per second counting only the slowest 'fraction' of the
+         * frames (the usual "1% low" for 0.01).
+         */
+        double getLowFPS(double fraction) const;
+
+        Stats getStats() const;
+
+        /**
+         * Writes a summary of the statistics, one per line.
+         */
+        void print(std::ostream &out) const;
+
+        /**
+         * Write, as CSV with a header line, the logged frames (frame index
+         * and time), or the non-empty buckets of the histogram (bucket time,
+         * frames in it and percentile reached).
+         */
+        void writeCSV(std::ostream &out) const;
+        void writeHistogramCSV(std::ostream &out) const;
+
+    private:
+        /**
+         * Times are stored in microseconds. Values under 2^SUB_BITS go
+         * into their own bucket; bigger ones keep their SUB_BITS most
+         * significant bits.
+         */
+        static const int SUB_BITS = 8;
+        static const int HALF = 1 << (SUB_BITS - 1);
+        static const int N_BUCKETS = (32 - SUB_BITS + 2) * HALF;
+
+        static int getBucket(unsigned int microseconds);
+        static double getBucketValue(int bucket); // In milliseconds
+
+        unsigned int buckets[N_BUCKETS];
+        long long count;
+        double sum;
+        double minimum, maximum;
+
+        std::vector<float> log;
+        int logSize;
+};
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "ImageDiff.h"
+#include "PixelFormat.h"
+using namespace std;
+
+
+/**
+ * Luma of an RGBA pixel, as seen on screen (from its sRGB bytes).
+ */
+static float luma(const float *rgba, unsigned char srgb[3]) {
+    for (int c = 0; c < 3; c++)
+        srgb[c] = PixelFormat::linearToSrgb(rgba[c]);
+    return (0.2126f * srgb[0] + 0.7152f * srgb[1] + 0.0722f * srgb[2]) / 255.0f;
+}
+
+
+/**
+ * Mean SSIM over windows of 8x8 pixels, spaced 4 pixels apart.
+ */
+static float ssim(const vector<float> &x, const vector<float> &y, int width, int height) {
+    const int WINDOW = 8, STRIDE = 4;
+    const double C1 = 0.01 * 0.01, C2 = 0.03 * 0.03; // For a dynamic range of 1.0
+    int windowWidth = min(WINDOW, width), windowHeight = min(WINDOW, height);
+
+    double total = 0.0;
+    int nWindows = 0;
+    for (int y0 = 0; y0 + windowHeight <= height; y0 += STRIDE) {
+        for (int x0 = 0; x0 + windowWidth <= width; x0 += STRIDE) {
+            double sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0, sxy = 0.0;
+            for (int j = y0; j < y0 + windowHeight; j++) {
+                for (int i = x0; i < x0 + windowWidth; i++) {
+                    double a = x[j * width + i], b = y[j * width + i];
+                    sx += a; sy += b;
+                    sxx += a * a; syy += b * b; sxy += a * b;
+                }
+            }
+            double n = double(windowWidth * windowHeight);
+            double mx = sx / n, my = sy / n;
+            double vx = sxx / n - mx * mx, vy = syy / n - my * my, cxy = sxy / n - mx * my;
+            total += ((2.0 * mx * my + C1) * (2.0 * cxy + C2)) /
+                     ((mx * mx + my * my + C1) * (vx + vy + C2));
+            nWindows++;
+        }
+    }
+    return nWindows > 0? float(total / nWindows) : 1.0f;
+}
+
+
+ImageDiff::Result ImageDiff::compare(const float *a, const float *b, int width, int height) {
+    const int n = width * height;
+    vector<float> lumaA(n), lumaB(n);
+
+    Result result;
+    result.maxError = 0.0f;
+    result.nVisible = 0;
+    result.nPixels = n;
+
+    double squares = 0.0;
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < 3; c++) {
+            float d = abs(a[4 * i + c] - b[4 * i + c]);
+            if (!(d < numeric_limits<float>::max())) // Infinities and NaNs
+                d = numeric_limits<float>::infinity();
+            result.maxError = max(result.maxError, d);
+            squares += double(d) * double(d);
+        }
+
+        unsigned char srgbA[3], srgbB[3];
+        lumaA[i] = luma(&a[4 * i], srgbA);
+        lumaB[i] = luma(&b[4 * i], srgbB);
+        for (int c = 0; c < 3; c++) {
+            if (abs(int(srgbA[c]) - int(srgbB[c])) > 1) {
+                result.nVisible++;
+                break;
+            }
+        }
+    }
+    result.rmsError = n > 0? float(sqrt(squares / (3.0 * n))) : 0.0f;
+    result.ssim = ssim(lumaA, lumaB, width, height);
+    return result;
+}
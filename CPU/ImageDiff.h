@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef IMAGEDIFF_H
+#define IMAGEDIFF_H
+
+/**
+ * Compares two RGBA float images (linear color, as processed by
+ * 'SeparableSSSCPU'), for checking optimized implementations against a
+ * reference. Only the RGB channels are compared.
+ *
+ * Besides the absolute errors, the images are compared the way they would be
+ * seen: each channel is encoded to sRGB bytes (see 'PixelFormat'), pixels
+ * whose bytes differ by more than one code are counted as visible
+ * differences, and the structural similarity (SSIM, [Wang04]) of their
+ * luma is calculated over 8x8 windows.
+ *
+ * [Wang04] Image Quality Assessment: From Error Visibility to Structural
+ *          Similarity.
+ *          Zhou Wang, Alan Bovik, Hamid Sheikh and Eero Simoncelli.
+ */
+class ImageDiff {
+    public:
+        struct Result {
+            float maxError; // Maximum absolute difference of a channel
+            float rmsError; // Root mean square of the differences of all channels
+            float ssim; // Mean SSIM, 1.0 for identical images
+            int nVisible; // Pixels that differ by more than one sRGB code
+            int nPixels;
+        };
+
+        /**
+         * Both images must be 'width * height' RGBA pixels. Non-finite
+         * values are treated as an infinite error.
+         */
+        static Result compare(const float *a, const float *b, int width, int height);
+};
+
+#endif
@@ -0,0 +1,452 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "Kernel.h"
+#include "KernelGenerator.h"
+#include "Profile.h"
+using namespace std;
+
+
+/**
+ * The profile tabulated over [0, range], along with the integrals, from zero,
+ * of each channel and of its first moment. They are extended to negative
+ * distances by symmetry, and linearly interpolated in between.
+ */
+class ProfileTable {
+    public:
+        ProfileTable(const Profile &profile) {
+            range = max(profile.getRange(), 1e-6f);
+
+            // Fine enough for the narrowest gaussian (with an upper bound on
+            // the size of the table):
+            double sd = profile.getNarrowest();
+            n = sd > 0.0? int(min(double(1 << 20), max(4096.0, ceil(8.0 * range / sd)))) : 4096;
+            h = range / n;
+
+            for (int c = 0; c < 4; c++) {
+                integral[c].resize(n + 1);
+                moment[c].resize(n + 1);
+            }
+
+            vector<Vector3> values(n + 1);
+            for (int i = 0; i <= n; i++)
+                values[i] = profile.evaluate(float(i * h));
+
+            for (int c = 0; c < 3; c++)
+                accumulate(c, values);
+
+            // The normalized maximum of the three channels, for
+            // 'PLACEMENT_CDF_MAX':
+            vector<Vector3> maximum(n + 1);
+            for (int i = 0; i <= n; i++) {
+                float m = 0.0f;
+                for (int c = 0; c < 3; c++)
+                    m = max(m, float(values[i][c] / integral[c][n]));
+                maximum[i] = Vector3(m, 0.0f, 0.0f);
+            }
+            accumulate(3, maximum, 0);
+        }
+
+        double getRange() const { return range; }
+
+        /**
+         * Integral of channel 'c' (3 for the maximum) over [0, r], and of its
+         * first moment.
+         */
+        double getIntegral(int c, double r) const { return r < 0.0? -interpolate(integral[c], -r) : interpolate(integral[c], r); }
+        double getMoment(int c, double r) const { return interpolate(moment[c], abs(r)); }
+
+        /**
+         * Inverse of 'getIntegral', for non-negative values.
+         */
+        double invert(int c, double v) const {
+            const vector<double> &t = integral[c];
+            if (v >= t[n])
+                return range;
+            int i = int(upper_bound(t.begin(), t.end(), v) - t.begin()) - 1;
+            double d = t[i + 1] - t[i];
+            double f = d > 0.0? (v - t[i]) / d : 0.0;
+            return (i + f) * h;
+        }
+
+    private:
+        void accumulate(int c, const vector<Vector3> &values, int channel=-1) {
+            if (channel < 0)
+                channel = c;
+            integral[c][0] = moment[c][0] = 0.0;
+            for (int i = 1; i <= n; i++) {
+                double p0 = values[i - 1][channel], p1 = values[i][channel];
+                integral[c][i] = integral[c][i - 1] + 0.5 * h * (p0 + p1);
+                moment[c][i] = moment[c][i - 1] + 0.5 * h * ((i - 1) * h * p0 + i * h * p1);
+            }
+        }
+
+        double interpolate(const vector<double> &t, double r) const {
+            double x = min(r / h, double(n));
+            int i = min(int(x), n - 1);
+            return t[i] + (x - i) * (t[i + 1] - t[i]);
+        }
+
+        double range, h;
+        int n;
+        vector<double> integral[4], moment[4];
+};
+
+
+Vector3 Kernel::gaussian(float variance, float r, const Vector3 &falloff) {
+    return Vector3(float(KernelGenerator::gaussian(variance, r, falloff.x)),
+                   float(KernelGenerator::gaussian(variance, r, falloff.y)),
+                   float(KernelGenerator::gaussian(variance, r, falloff.z)));
+}
+
+
+Vector3 Kernel::profile(float r, const Vector3 &falloff) {
+    return Vector3(float(KernelGenerator::profile(r, falloff.x)),
+                   float(KernelGenerator::profile(r, falloff.y)),
+                   float(KernelGenerator::profile(r, falloff.z)));
+}
+
+
+float Kernel::getProfileRange(const Vector3 &falloff) {
+    float widest = max(falloff.x, max(falloff.y, falloff.z));
+    return 6.0f * sqrt(7.41f) * (0.001f + widest);
+}
+
+
+const char *Kernel::getName(Placement placement) {
+    switch (placement) {
+        case PLACEMENT_POWER:     return "Power";
+        case PLACEMENT_CDF_RED:   return "CDF red";
+        case PLACEMENT_CDF_GREEN: return "CDF green";
+        case PLACEMENT_CDF_BLUE:  return "CDF blue";
+        case PLACEMENT_CDF_MAX:   return "CDF max";
+        default:                  return "Unknown";
+    }
+}
+
+
+void Kernel::calculate(vector<KernelSample> &kernel,
+                       int nSamples,
+                       const Vector3 &strength,
+                       const Vector3 &falloff,
+                       Placement placement) {
+    if (placement != PLACEMENT_POWER) {
+        calculate(kernel, nSamples, strength, Profile::fromFalloff(falloff), placement);
+        return;
+    }
+
+    #if KERNEL_CONSTEXPR
+    // The presets were calculated at compile time:
+    const KernelSample *preset = KernelPresets::find(nSamples, strength, falloff);
+    if (preset != NULL) {
+        kernel.assign(preset, preset + nSamples);
+        return;
+    }
+    #endif
+
+    const double sum[] = { KernelGenerator::sum(nSamples, falloff.x),
+                           KernelGenerator::sum(nSamples, falloff.y),
+                           KernelGenerator::sum(nSamples, falloff.z) };
+    kernel.resize(nSamples);
+    for (int i = 0; i < nSamples; i++) {
+        kernel[i].r = float(KernelGenerator::weight(nSamples, i, strength.x, falloff.x, sum[0]));
+        kernel[i].g = float(KernelGenerator::weight(nSamples, i, strength.y, falloff.y, sum[1]));
+        kernel[i].b = float(KernelGenerator::weight(nSamples, i, strength.z, falloff.z, sum[2]));
+        kernel[i].offset = KernelGenerator::offset(nSamples, i);
+    }
+}
+
+
+void Kernel::calculate(vector<KernelSample> &kernel,
+                       int nSamples,
+                       const Vector3 &strength,
+                       const Profile &profile,
+                       Placement placement) {
+    kernel.resize(nSamples);
+
+    if (placement == PLACEMENT_POWER) {
+        // Same offsets and areas as 'KernelGenerator', which are already in
+        // their final order:
+        for (int i = 0; i < nSamples; i++) {
+            kernel[i].offset = KernelGenerator::offset(nSamples, i);
+            Vector3 t = KernelGenerator::area(nSamples, i) * profile.evaluate(kernel[i].offset);
+            kernel[i].r = t.x;
+            kernel[i].g = t.y;
+            kernel[i].b = t.z;
+        }
+    } else {
+        importance(kernel, profile, placement);
+
+        // We want the offset 0.0 to come first:
+        KernelSample t = kernel[nSamples / 2];
+        for (int i = nSamples / 2; i > 0; i--)
+            kernel[i] = kernel[i - 1];
+        kernel[0] = t;
+    }
+
+    // Calculate the sum of the weights, we will need to normalize them below:
+    Vector3 sum;
+    for (int i = 0; i < nSamples; i++)
+        sum += Vector3(kernel[i].r, kernel[i].g, kernel[i].b);
+
+    // Normalize the weights:
+    for (int i = 0; i < nSamples; i++) {
+        kernel[i].r /= sum.x;
+        kernel[i].g /= sum.y;
+        kernel[i].b /= sum.z;
+    }
+
+    // Tweak them using the desired strength. The first one is:
+    //     lerp(1.0, kernel[0].rgb, strength)
+    kernel[0].r = (1.0f - strength.x) * 1.0f + strength.x * kernel[0].r;
+    kernel[0].g = (1.0f - strength.y) * 1.0f + strength.y * kernel[0].g;
+    kernel[0].b = (1.0f - strength.z) * 1.0f + strength.z * kernel[0].b;
+
+    // The others:
+    //     lerp(0.0, kernel[0].rgb, strength)
+    for (int i = 1; i < nSamples; i++) {
+        kernel[i].r *= strength.x;
+        kernel[i].g *= strength.y;
+        kernel[i].b *= strength.z;
+    }
+}
+
+
+void Kernel::importance(vector<KernelSample> &kernel,
+                        const Profile &profile,
+                        Placement placement) {
+    const int nSamples = int(kernel.size());
+    const int channel = placement - PLACEMENT_CDF_RED; // 3 for the maximum
+
+    ProfileTable table(profile);
+    const double total = table.getIntegral(channel, table.getRange());
+
+    // Inverse of the CDF of the (symmetric) profile over [-range, range]:
+    vector<double> edges(nSamples + 1), offsets(nSamples);
+    for (int i = 0; i <= 2 * nSamples; i++) {
+        double u = double(i) / double(2 * nSamples);
+        double r = table.invert(channel, abs(2.0 * u - 1.0) * total);
+        r = u < 0.5? -r : r;
+
+        // Even points are the edges of the intervals, odd ones their medians:
+        if (i % 2 == 0)
+            edges[i / 2] = r;
+        else
+            offsets[i / 2] = r;
+    }
+
+    // Weight each sample by the integral of the profile over its interval:
+    for (int i = 0; i < nSamples; i++) {
+        kernel[i].offset = float(offsets[i]);
+        kernel[i].r = float(table.getIntegral(0, edges[i + 1]) - table.getIntegral(0, edges[i]));
+        kernel[i].g = float(table.getIntegral(1, edges[i + 1]) - table.getIntegral(1, edges[i]));
+        kernel[i].b = float(table.getIntegral(2, edges[i + 1]) - table.getIntegral(2, edges[i]));
+    }
+}
+
+
+KernelError Kernel::measure(const vector<KernelSample> &kernel,
+                            const Vector3 &strength,
+                            const Vector3 &falloff,
+                            float pixelsPerUnit) {
+    return measure(kernel, strength, Profile::fromFalloff(falloff), pixelsPerUnit);
+}
+
+
+KernelError Kernel::measure(const vector<KernelSample> &kernel,
+                            const Vector3 &strength,
+                            const Profile &profile,
+                            float pixelsPerUnit) {
+    /**
+     * Bilinear filtering turns the step edge (zero for negative pixels, one
+     * for the others) and the impulse (one at pixel zero) into piecewise
+     * linear functions of 'u', the position in pixels:
+     *     step(u) = clamp(u + 1, 0, 1)
+     *     impulse(u) = max(1 - |u|, 0)
+     * At pixel 'j', the convolution reads them at 'u = j + t * pixelsPerUnit'
+     * so each linear piece can be integrated exactly using the integral of
+     * the profile and of its first moment.
+     */
+    ProfileTable table(profile);
+    const double range = table.getRange();
+    const double ppu = pixelsPerUnit;
+
+    // Integral over [a, b] of the profile of channel 'c' times
+    // 'alpha + beta * t':
+    auto segment = [&](int c, double a, double b, double alpha, double beta) {
+        a = max(a, -range);
+        b = min(b, range);
+        if (a >= b)
+            return 0.0;
+        return alpha * (table.getIntegral(c, b) - table.getIntegral(c, a)) +
+               beta * (table.getMoment(c, b) - table.getMoment(c, a));
+    };
+
+    float reach = float(range);
+    for (size_t k = 0; k < kernel.size(); k++)
+        reach = max(reach, abs(kernel[k].offset));
+    const int J = int(ceil(reach * ppu)) + 2;
+
+    KernelError error;
+    for (int c = 0; c < 3; c++) {
+        const double total = 2.0 * table.getIntegral(c, range);
+        double sum = 0.0, maximum = 0.0;
+        for (int j = -J; j <= J; j++) {
+            // The kinks of both functions, in kernel offset units:
+            double t0 = (-1.0 - j) / ppu, t1 = -double(j) / ppu, t2 = (1.0 - j) / ppu;
+
+            double step = segment(c, t0, t1, j + 1.0, ppu) + segment(c, t1, range, 1.0, 0.0);
+            double impulse = segment(c, t0, t1, j + 1.0, ppu) + segment(c, t1, t2, 1.0 - j, -ppu);
+            step = (1.0 - strength[c]) * (j >= 0? 1.0 : 0.0) + strength[c] * step / total;
+            impulse = (1.0 - strength[c]) * (j == 0? 1.0 : 0.0) + strength[c] * impulse / total;
+
+            double stepK = 0.0, impulseK = 0.0;
+            for (size_t k = 0; k < kernel.size(); k++) {
+                double w = c == 0? kernel[k].r : (c == 1? kernel[k].g : kernel[k].b);
+                double u = j + kernel[k].offset * ppu;
+                stepK += w * min(max(u + 1.0, 0.0), 1.0);
+                impulseK += w * max(1.0 - abs(u), 0.0);
+            }
+
+            double e0 = abs(stepK - step), e1 = abs(impulseK - impulse);
+            sum += e0 * e0 + e1 * e1;
+            maximum = max(maximum, max(e0, e1));
+        }
+        error.rms[c] = float(sqrt(sum / (2 * (2 * J + 1))));
+        error.max[c] = float(maximum);
+    }
+    return error;
+}
+
+
+int Kernel::findSampleCount(const Vector3 &strength,
+                            const Vector3 &falloff,
+                            float pixelsPerUnit,
+                            float maxError,
+                            float rmsError,
+                            Placement placement,
+                            int maxSamples) {
+    // The error is not monotonic in the number of samples (the power
+    // placement widens its range past 20 samples), so every count is tried:
+    for (int nSamples = 3; nSamples <= maxSamples; nSamples += 2) {
+        vector<KernelSample> kernel;
+        calculate(kernel, nSamples, strength, falloff, placement);
+        KernelError error = measure(kernel, strength, falloff, pixelsPerUnit);
+
+        bool fits = true;
+        for (int c = 0; c < 3; c++)
+            fits = fits && error.max[c] <= maxError && error.rms[c] <= rmsError;
+        if (fits)
+            return nSamples;
+    }
+    return -1;
+}
+
+
+float Kernel::merge(const vector<KernelSample> &kernel,
+                    vector<KernelSample> &merged,
+                    float maxError,
+                    float maxGap) {
+    float largestGap = 0.0f;
+    merged.assign(kernel.begin(), kernel.begin() + min(kernel.size(), size_t(1)));
+
+    // Split the taps into both sides of the center, sorted from the
+    // center outwards:
+    vector<pair<float, int> > sides[2];
+    for (size_t k = 1; k < kernel.size(); k++) {
+        float o = kernel[k].offset;
+        sides[o < 0.0f? 0 : 1].push_back(make_pair(abs(o), int(k)));
+    }
+
+    for (int side = 0; side < 2; side++) {
+        vector<pair<float, int> > &taps = sides[side];
+        sort(taps.begin(), taps.end());
+
+        vector<KernelSample> out;
+        size_t t = 0;
+        while (t < taps.size()) {
+            const KernelSample &a = kernel[taps[t].second];
+            if (t + 1 == taps.size()) {
+                out.push_back(a);
+                break;
+            }
+            const KernelSample &b = kernel[taps[t + 1].second];
+            const float gap = abs(b.offset - a.offset);
+
+            // Share of 'b' in the sum of the weights of both taps:
+            float wa[3] = { a.r, a.g, a.b }, wb[3] = { b.r, b.g, b.b };
+            float sumA = 0.0f, sumB = 0.0f;
+            bool fits = gap <= maxGap;
+            for (int c = 0; c < 3; c++) {
+                fits = fits && wa[c] >= 0.0f && wb[c] >= 0.0f;
+                sumA += wa[c];
+                sumB += wb[c];
+            }
+            fits = fits && sumA + sumB > 0.0f;
+            float share = fits? sumB / (sumA + sumB) : 0.0f;
+
+            // The weight of each channel that ends up at the wrong side of
+            // the merged tap:
+            for (int c = 0; c < 3 && fits; c++)
+                fits = abs(wb[c] - share * (wa[c] + wb[c])) <= maxError;
+
+            if (!fits) {
+                out.push_back(a);
+                t++;
+                continue;
+            }
+
+            KernelSample s;
+            s.r = a.r + b.r;
+            s.g = a.g + b.g;
+            s.b = a.b + b.b;
+            s.offset = a.offset + share * (b.offset - a.offset);
+            out.push_back(s);
+            largestGap = max(largestGap, gap);
+            t += 2;
+        }
+
+        // The negative side goes first, from the outermost tap inwards:
+        if (side == 0)
+            merged.insert(merged.end(), out.rbegin(), out.rend());
+        else
+            merged.insert(merged.end(), out.begin(), out.end());
+    }
+    return largestGap;
+}
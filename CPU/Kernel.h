@@ -0,0 +1,214 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+class Profile;
+
+/**
+ * Plain three-component vector, laid out as D3DXVECTOR3 so that both can be
+ * converted by a simple copy.
+ */
+struct Vector3 {
+    float x, y, z;
+
+    Vector3() : x(0.0f), y(0.0f), z(0.0f) {}
+    Vector3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+    float operator[](int i) const { return (&x)[i]; }
+    float &operator[](int i) { return (&x)[i]; }
+
+    Vector3 operator+(const Vector3 &v) const { return Vector3(x + v.x, y + v.y, z + v.z); }
+    Vector3 &operator+=(const Vector3 &v) { x += v.x; y += v.y; z += v.z; return *this; }
+    friend Vector3 operator*(float s, const Vector3 &v) { return Vector3(s * v.x, s * v.y, s * v.z); }
+};
+
+/**
+ * One tap of the filter kernel. The layout is the same as the one expected by
+ * 'SSSSBlurPS' in 'SeparableSSS.h':
+ *   - Weights in the RGB channels.
+ *   - Offsets in the A channel.
+ */
+struct KernelSample {
+    float r, g, b;
+    float offset;
+};
+
+/**
+ * Difference between a kernel and the continuous convolution it stands for
+ * (see 'Kernel::measure'), per channel.
+ */
+struct KernelError {
+    Vector3 rms;
+    Vector3 max;
+};
+
+/**
+ * Portable kernel calculation, used both by 'SeparableSSS::calculateKernel'
+ * in the demo and by 'SeparableSSSCPU'. Samples come with the offset 0.0
+ * first.
+ */
+class Kernel {
+    public:
+        /**
+         * How the offsets of the samples are chosen:
+         *   - PLACEMENT_POWER: the original placement of the demo, which
+         *     spreads them over [-RANGE, RANGE] following a quadratic curve,
+         *     with RANGE being 2 (or 3 for more than 20 samples). It's
+         *     calculated by 'KernelGenerator', and the presets of
+         *     'KernelPresets' are returned directly.
+         *   - PLACEMENT_CDF_*: importance sampling of the profile. Its range
+         *     (see 'Profile::getRange') is split into 'nSamples' intervals of
+         *     equal probability, by inverting the CDF of the specified
+         *     channel (or of the maximum of the three, normalized), and a
+         *     sample is placed at the median of each one, weighted by the
+         *     integral of the profile over it. This way, samples are packed
+         *     where the profile carries most of its energy, and no energy is
+         *     lost beyond a fixed range.
+         */
+        enum Placement { PLACEMENT_POWER = 0,
+                         PLACEMENT_CDF_RED = 1,
+                         PLACEMENT_CDF_GREEN = 2,
+                         PLACEMENT_CDF_BLUE = 3,
+                         PLACEMENT_CDF_MAX = 4 };
+
+        static Vector3 gaussian(float variance, float r, const Vector3 &falloff);
+        static Vector3 profile(float r, const Vector3 &falloff);
+
+        /**
+         * Distance beyond which the profile is negligible (six standard
+         * deviations of its widest gaussian, for the widest falloff).
+         */
+        static float getProfileRange(const Vector3 &falloff);
+
+        /**
+         * nSamples: number of samples of the kernel convolution.
+         *
+         * strength, falloff: see @STRENGTH in 'SeparableSSS.h'.
+         */
+        static void calculate(std::vector<KernelSample> &kernel,
+                              int nSamples,
+                              const Vector3 &strength,
+                              const Vector3 &falloff,
+                              Placement placement=PLACEMENT_POWER);
+
+        /**
+         * Same as above, for an arbitrary profile (for example, one fitted
+         * to measured data, see 'ProfileFitter').
+         */
+        static void calculate(std::vector<KernelSample> &kernel,
+                              int nSamples,
+                              const Vector3 &strength,
+                              const Profile &profile,
+                              Placement placement=PLACEMENT_POWER);
+
+        /**
+         * Compares 'kernel' against the continuous convolution with the
+         * profile (mixed with the identity by 'strength', and normalized over
+         * its range), when applied, as 'SSSSBlurPS' does, with bilinear
+         * filtering over a step edge and an impulse sampled with
+         * 'pixelsPerUnit' pixels per unit of kernel offset (that is, the
+         * final step of the shader, in pixels). The error is measured at
+         * every pixel the convolution reaches.
+         */
+        static KernelError measure(const std::vector<KernelSample> &kernel,
+                                   const Vector3 &strength,
+                                   const Vector3 &falloff,
+                                   float pixelsPerUnit);
+        static KernelError measure(const std::vector<KernelSample> &kernel,
+                                   const Vector3 &strength,
+                                   const Profile &profile,
+                                   float pixelsPerUnit);
+
+        /**
+         * Cheapest kernel that meets an error budget: returns the smallest
+         * odd number of samples, from 3 to 'maxSamples', for which the
+         * largest 'measure' error of every channel is below 'maxError', and
+         * the RMS one below 'rmsError'. Returns -1 if none does.
+         *
+         * 'pixelsPerUnit' should be the largest final step expected, in
+         * pixels (usually the one of the skin closest to the camera), as
+         * errors grow with it.
+         */
+        static int findSampleCount(const Vector3 &strength,
+                                   const Vector3 &falloff,
+                                   float pixelsPerUnit,
+                                   float maxError,
+                                   float rmsError,
+                                   Placement placement=PLACEMENT_POWER,
+                                   int maxSamples=33);
+
+        /**
+         * Linear sampling: as every tap is a bilinear fetch, two neighboring
+         * taps at the same side of the center can be replaced by a single
+         * one, placed in between so that it gets the same share of each of
+         * them, with the sum of their weights. The share is the same for the
+         * three channels (the one of the sum of the weights), so a pair is
+         * only merged if, for every channel, the weight that it moves from
+         * one tap to the other is at most 'maxError'. As the weights of each
+         * channel sum up to one, it's the fraction of the channel that gets
+         * displaced, by at most the distance between the taps. Taps are
+         * paired from the center outwards, and the result has the usual
+         * layout (the center tap comes first).
+         *
+         * The merged tap is exact where both taps fall between the same two
+         * pixels, and an approximation when they are further apart: the
+         * error isn't bounded by 'maxError' then, as it grows with the
+         * distance between the taps on screen (see 'measure'). So pairs
+         * whose offsets are more than 'maxGap' apart are left alone; for
+         * taps at most one pixel apart, it should be one over the largest
+         * step the kernel will be used with, in pixels per unit of offset.
+         * Returns the largest gap actually merged (zero if none).
+         */
+        static float merge(const std::vector<KernelSample> &kernel,
+                           std::vector<KernelSample> &merged,
+                           float maxError=0.002f,
+                           float maxGap=std::numeric_limits<float>::infinity());
+
+        static const char *getName(Placement placement);
+
+    private:
+        static void importance(std::vector<KernelSample> &kernel,
+                               const Profile &profile,
+                               Placement placement);
+};
+
+#endif
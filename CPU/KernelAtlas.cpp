@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include "KernelAtlas.h"
+#include "KernelCache.h"
+#include "Profile.h"
+using namespace std;
+
+
+KernelAtlas::KernelAtlas() {
+    clear();
+}
+
+
+void KernelAtlas::setProfile(int id,
+                             int nSamples,
+                             const Vector3 &strength,
+                             const Vector3 &falloff,
+                             Kernel::Placement placement) {
+    vector<KernelSample> kernel;
+    KernelCache::getShared().calculate(kernel, nSamples, strength, falloff, placement);
+    setKernel(id, kernel);
+}
+
+
+void KernelAtlas::setProfile(int id,
+                             int nSamples,
+                             const Vector3 &strength,
+                             const Profile &profile,
+                             Kernel::Placement placement) {
+    vector<KernelSample> kernel;
+    Kernel::calculate(kernel, nSamples, strength, profile, placement);
+    setKernel(id, kernel);
+}
+
+
+void KernelAtlas::setKernel(int id, const vector<KernelSample> &kernel) {
+    removeProfile(id);
+    if (kernel.empty())
+        return;
+
+    // New kernels go to the end of the array:
+    offsets[id] = int(samples.size());
+    counts[id] = int(kernel.size());
+    samples.insert(samples.end(), kernel.begin(), kernel.end());
+    profileCount++;
+}
+
+
+void KernelAtlas::removeProfile(int id) {
+    if (counts[id] == 0)
+        return;
+
+    // Close the gap, and move the kernels that came after it:
+    int offset = offsets[id], count = counts[id];
+    samples.erase(samples.begin() + offset, samples.begin() + offset + count);
+    for (int i = 0; i < MAX_PROFILES; i++) {
+        if (offsets[i] > offset)
+            offsets[i] -= count;
+    }
+    offsets[id] = 0;
+    counts[id] = 0;
+    profileCount--;
+}
+
+
+void KernelAtlas::clear() {
+    samples.clear();
+    for (int i = 0; i < MAX_PROFILES; i++) {
+        offsets[i] = 0;
+        counts[i] = 0;
+    }
+    profileCount = 0;
+}
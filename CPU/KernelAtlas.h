@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef KERNELATLAS_H
+#define KERNELATLAS_H
+
+#include <vector>
+#include "Kernel.h"
+
+/**
+ * Set of kernels for frames that mix materials (skin tones, marble, wax...),
+ * each one selected per pixel by a material ID (see 'SeparableSSSCPU::go').
+ * Profiles are indexed by the ID, and can have different numbers of samples.
+ *
+ * All the kernels are packed one after another in a single array, so that
+ * they can also be uploaded at once as a constant buffer.
+ */
+class KernelAtlas {
+    public:
+        static const int MAX_PROFILES = 256; // One byte per pixel
+
+        KernelAtlas();
+
+        /**
+         * Sets profile 'id' to the kernel with the specified parameters (see
+         * 'Kernel::calculate'), which is taken from 'KernelCache::getShared'.
+         */
+        void setProfile(int id,
+                        int nSamples,
+                        const Vector3 &strength,
+                        const Vector3 &falloff,
+                        Kernel::Placement placement=Kernel::PLACEMENT_POWER);
+
+        /**
+         * Same as above, for an arbitrary profile (which is not cached).
+         */
+        void setProfile(int id,
+                        int nSamples,
+                        const Vector3 &strength,
+                        const Profile &profile,
+                        Kernel::Placement placement=Kernel::PLACEMENT_POWER);
+
+        /**
+         * Sets a custom kernel, with the offset 0.0 first.
+         */
+        void setKernel(int id, const std::vector<KernelSample> &kernel);
+
+        void removeProfile(int id);
+        void clear();
+
+        /**
+         * Pixels whose material has no profile are not processed.
+         */
+        bool hasProfile(int id) const { return counts[id] > 0; }
+        int getProfileCount() const { return profileCount; }
+
+        const KernelSample *getKernel(int id) const { return counts[id] > 0? &samples[offsets[id]] : NULL; }
+        int getSampleCount(int id) const { return counts[id]; }
+
+        /**
+         * The packed kernels: the samples of profile 'id' start at
+         * 'getOffset(id)'.
+         */
+        const std::vector<KernelSample> &getSamples() const { return samples; }
+        int getOffset(int id) const { return offsets[id]; }
+
+    private:
+        std::vector<KernelSample> samples;
+        int offsets[MAX_PROFILES];
+        int counts[MAX_PROFILES];
+        int profileCount;
+};
+
+#endif
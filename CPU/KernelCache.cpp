@@ -0,0 +1,170 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include "KernelCache.h"
+#include "Mutex.h"
+using namespace std;
+
+
+bool KernelCache::Key::operator==(const Key &key) const {
+    if (nSamples != key.nSamples || placement != key.placement)
+        return false;
+    for (int i = 0; i < 6; i++) {
+        if (params[i] != key.params[i])
+            return false;
+    }
+    return true;
+}
+
+
+size_t KernelCache::KeyHash::operator()(const Key &key) const {
+    // FNV-1a over the fields:
+    unsigned long long h = 14695981039346656037ull;
+    const unsigned long long fields[] = { (unsigned long long) key.nSamples,
+                                          (unsigned long long) key.placement,
+                                          (unsigned long long) key.params[0],
+                                          (unsigned long long) key.params[1],
+                                          (unsigned long long) key.params[2],
+                                          (unsigned long long) key.params[3],
+                                          (unsigned long long) key.params[4],
+                                          (unsigned long long) key.params[5] };
+    for (int i = 0; i < 8; i++) {
+        h ^= fields[i];
+        h *= 1099511628211ull;
+    }
+    return size_t(h ^ (h >> 32));
+}
+
+
+KernelCache::KernelCache(int capacity, float quantum) :
+        capacity(max(capacity, 1)),
+        quantum(quantum),
+        mutex(new Mutex()),
+        hits(0),
+        misses(0) {}
+
+
+KernelCache::~KernelCache() {
+    delete mutex;
+}
+
+
+KernelCache &KernelCache::getShared() {
+    static KernelCache cache;
+    return cache;
+}
+
+
+KernelCache::Key KernelCache::makeKey(int nSamples,
+                                      const Vector3 &strength,
+                                      const Vector3 &falloff,
+                                      Kernel::Placement placement) const {
+    Key key;
+    key.nSamples = nSamples;
+    key.placement = int(placement);
+    for (int i = 0; i < 6; i++) {
+        float v = i < 3? strength[i] : falloff[i - 3];
+        double q = floor(double(v) / quantum + 0.5);
+        key.params[i] = (long long) max(-1e15, min(1e15, q)); // Also catches NaNs
+    }
+    return key;
+}
+
+
+void KernelCache::calculate(vector<KernelSample> &kernel,
+                            int nSamples,
+                            const Vector3 &strength,
+                            const Vector3 &falloff,
+                            Kernel::Placement placement) {
+    Key key = makeKey(nSamples, strength, falloff, placement);
+
+    {
+        ScopedLock lock(*mutex);
+        unordered_map<Key, list<Entry>::iterator, KeyHash>::iterator i = index.find(key);
+        if (i != index.end()) {
+            entries.splice(entries.begin(), entries, i->second);
+            kernel = i->second->second;
+            hits++;
+            return;
+        }
+        misses++;
+    }
+
+    // Other threads can use the cache in the meantime:
+    Kernel::calculate(kernel, nSamples, strength, falloff, placement);
+
+    ScopedLock lock(*mutex);
+    unordered_map<Key, list<Entry>::iterator, KeyHash>::iterator i = index.find(key);
+    if (i != index.end()) {
+        // Another thread got here first:
+        entries.splice(entries.begin(), entries, i->second);
+        return;
+    }
+    entries.push_front(Entry(key, kernel));
+    index[key] = entries.begin();
+    if (int(entries.size()) > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+
+void KernelCache::clear() {
+    ScopedLock lock(*mutex);
+    entries.clear();
+    index.clear();
+    hits = misses = 0;
+}
+
+
+int KernelCache::getSize() const {
+    ScopedLock lock(*mutex);
+    return int(entries.size());
+}
+
+
+long long KernelCache::getHits() const {
+    ScopedLock lock(*mutex);
+    return hits;
+}
+
+
+long long KernelCache::getMisses() const {
+    ScopedLock lock(*mutex);
+    return misses;
+}
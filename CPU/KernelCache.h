@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef KERNELCACHE_H
+#define KERNELCACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "Kernel.h"
+
+class Mutex;
+
+/**
+ * Thread-safe cache of kernels, keyed by the parameters of
+ * 'Kernel::calculate', with least recently used eviction. Editors calculate
+ * the same kernels over and over while scrubbing the parameters, or when
+ * switching between characters that share them.
+ *
+ * Strength and falloff are quantized to multiples of 'quantum' for building
+ * the keys, so values that only differ by rounding noise share their kernel
+ * (the one calculated for the first of them).
+ */
+class KernelCache {
+    public:
+        KernelCache(int capacity=64, float quantum=1.0f / 4096.0f);
+        ~KernelCache();
+
+        /**
+         * Same as 'Kernel::calculate', but returns a copy of the cached
+         * kernel if there is one. Otherwise the kernel is calculated (outside
+         * of the lock) and stored, evicting the least recently used one if
+         * the cache is full.
+         */
+        void calculate(std::vector<KernelSample> &kernel,
+                       int nSamples,
+                       const Vector3 &strength,
+                       const Vector3 &falloff,
+                       Kernel::Placement placement=Kernel::PLACEMENT_POWER);
+
+        void clear();
+
+        int getCapacity() const { return capacity; }
+        int getSize() const;
+        long long getHits() const;
+        long long getMisses() const;
+
+        /**
+         * Cache shared by all the 'SeparableSSS' and 'SeparableSSSCPU'
+         * instances.
+         */
+        static KernelCache &getShared();
+
+    private:
+        struct Key {
+            int nSamples;
+            int placement;
+            long long params[6];
+
+            bool operator==(const Key &key) const;
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+
+        typedef std::pair<Key, std::vector<KernelSample> > Entry;
+
+        Key makeKey(int nSamples, const Vector3 &strength, const Vector3 &falloff, Kernel::Placement placement) const;
+
+        int capacity;
+        float quantum;
+
+        Mutex *mutex;
+        std::list<Entry> entries; // Most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        long long hits, misses;
+
+        KernelCache(const KernelCache &);
+        KernelCache &operator=(const KernelCache &);
+};
+
+#endif
@@ -0,0 +1,272 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef KERNELGENERATOR_H
+#define KERNELGENERATOR_H
+
+#include "Kernel.h"
+
+/**
+ * KERNEL_CONSTEXPR tells if the compiler supports constexpr (and variadic
+ * templates), which are needed for calculating kernels at compile time.
+ * Visual Studio 2010, used by the demo, does not; in that case the functions
+ * below are plain inline functions and 'KernelPresets' is not available.
+ */
+#ifndef KERNEL_CONSTEXPR
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define KERNEL_CONSTEXPR 0
+#else
+#define KERNEL_CONSTEXPR 1
+#endif
+#endif
+
+#if KERNEL_CONSTEXPR
+#define KERNEL_CONSTEXPR_FUNCTION constexpr
+#else
+#define KERNEL_CONSTEXPR_FUNCTION inline
+#endif
+
+/**
+ * Header-only kernel math of the power placement of 'Kernel::calculate'
+ * (used by 'SeparableSSS::calculateKernel'), with no dependencies. Every
+ * function is a single expression, so that the same code calculates kernels
+ * both at run time and at compile time (see 'KernelPresets').
+ *
+ * Samples are indexed as they are laid out in the final kernel, with the
+ * offset 0.0 coming first. Offsets are calculated in single precision, as in
+ * the original code, but weights are calculated in double precision.
+ */
+class KernelGenerator {
+    public:
+        /**
+         * Exponential function, for non-positive values.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION double exp(double x) {
+            return x < -745.0? 0.0 : // Underflows anyway
+                   x < -0.5? square(exp(0.5 * x)) : series(x, 1.0, 1.0, 1);
+        }
+
+        static KERNEL_CONSTEXPR_FUNCTION double gaussian(double variance, double r, double falloff) {
+            /**
+             * We use a falloff to modulate the shape of the profile. Big
+             * falloffs spreads the shape making it wider, while small falloffs
+             * make it narrower.
+             */
+            return exp(-square(r / (0.001f + falloff)) / (2.0f * variance)) / (2.0f * 3.14f * variance);
+        }
+
+        static KERNEL_CONSTEXPR_FUNCTION double profile(double r, double falloff) {
+            /**
+             * We used the red channel of the original skin profile defined in
+             * [d'Eon07] for all three channels. We noticed it can be used for
+             * green and blue channels (scaled using the falloff parameter)
+             * without introducing noticeable differences and allowing for
+             * total control over the profile. For example, it allows to create
+             * blue SSS gradients, which could be useful in case of rendering
+             * blue creatures.
+             */
+            return  // 0.233f * gaussian(0.0064f, r, falloff) + /* We consider this one to be directly bounced light, accounted by the strength parameter (see @STRENGTH) */
+                       0.100f * gaussian(0.0484f, r, falloff) +
+                       0.118f * gaussian( 0.187f, r, falloff) +
+                       0.113f * gaussian( 0.567f, r, falloff) +
+                       0.358f * gaussian(  1.99f, r, falloff) +
+                       0.078f * gaussian(  7.41f, r, falloff);
+        }
+
+        /**
+         * Offset of sample 'i' of a kernel of 'nSamples' samples.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION float offset(int nSamples, int i) {
+            return sortedOffset(nSamples, sortedIndex(nSamples, i));
+        }
+
+        /**
+         * Sum of the unnormalized weights of a channel of the kernel, with
+         * 'falloff' being the falloff of that channel.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION double sum(int nSamples, double falloff, int i=0) {
+            return i < nSamples? sortedWeight(nSamples, i, falloff) + sum(nSamples, falloff, i + 1) : 0.0;
+        }
+
+        /**
+         * Final weight of a channel of sample 'i', normalized by 'total'
+         * (which should be the result of 'sum') and tweaked using the
+         * 'strength' of that channel.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION double weight(int nSamples, int i, double strength, double falloff, double total) {
+            return i == 0? (1.0 - strength) * 1.0 + strength * sortedWeight(nSamples, sortedIndex(nSamples, i), falloff) / total :
+                           strength * sortedWeight(nSamples, sortedIndex(nSamples, i), falloff) / total;
+        }
+
+        /**
+         * Distance covered by sample 'i', which multiplies its weight.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION float area(int nSamples, int i) {
+            return sortedArea(nSamples, sortedIndex(nSamples, i));
+        }
+
+        #if KERNEL_CONSTEXPR
+        /**
+         * Sample 'i' of the kernel, all at once.
+         */
+        static constexpr KernelSample sample(int nSamples, int i,
+                                             float strengthR, float strengthG, float strengthB,
+                                             float falloffR, float falloffG, float falloffB) {
+            return KernelSample{ float(weight(nSamples, i, strengthR, falloffR, sum(nSamples, falloffR))),
+                                 float(weight(nSamples, i, strengthG, falloffG, sum(nSamples, falloffG))),
+                                 float(weight(nSamples, i, strengthB, falloffB, sum(nSamples, falloffB))),
+                                 offset(nSamples, i) };
+        }
+        #endif
+
+    private:
+        static KERNEL_CONSTEXPR_FUNCTION double square(double x) { return x * x; }
+        static KERNEL_CONSTEXPR_FUNCTION float abs(float x) { return x < 0.0f? -x : x; }
+
+        /**
+         * Taylor series of 'exp', good enough for |x| <= 0.5.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION double series(double x, double term, double sum, int k) {
+            return k > 20? sum : series(x, term * x / k, sum + term * x / k, k + 1);
+        }
+
+        /**
+         * Samples are first calculated sorted by offset, and then the middle
+         * one is moved to the front. This returns the sorted index of sample
+         * 'i'.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION int sortedIndex(int nSamples, int i) {
+            return i == 0? nSamples / 2 : (i <= nSamples / 2? i - 1 : i);
+        }
+
+        static KERNEL_CONSTEXPR_FUNCTION float range(int nSamples) {
+            return nSamples > 20? 3.0f : 2.0f;
+        }
+
+        /**
+         * The offsets follow a power curve with exponent 2:
+         *     RANGE * sign(o) * o^2 / RANGE^2
+         */
+        static KERNEL_CONSTEXPR_FUNCTION float sortedOffset(int nSamples, int i) {
+            return power(range(nSamples), -range(nSamples) + float(i) * (2.0f * range(nSamples) / (nSamples - 1)));
+        }
+
+        static KERNEL_CONSTEXPR_FUNCTION float power(float range, float o) {
+            return range * (o < 0.0f? -1.0f : 1.0f) * abs(o * o) / (range * range);
+        }
+
+        /**
+         * Each sample is weighted by the profile times the area it covers.
+         */
+        static KERNEL_CONSTEXPR_FUNCTION double sortedWeight(int nSamples, int i, double falloff) {
+            return sortedArea(nSamples, i) * profile(sortedOffset(nSamples, i), falloff);
+        }
+
+        static KERNEL_CONSTEXPR_FUNCTION float sortedArea(int nSamples, int i) {
+            return ((i > 0? abs(sortedOffset(nSamples, i) - sortedOffset(nSamples, i - 1)) : 0.0f) +
+                    (i < nSamples - 1? abs(sortedOffset(nSamples, i) - sortedOffset(nSamples, i + 1)) : 0.0f)) / 2.0f;
+        }
+};
+
+
+#if KERNEL_CONSTEXPR
+template <int... I> struct KernelIndices {};
+template <int N, int... I> struct MakeKernelIndices : MakeKernelIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeKernelIndices<0, I...> { typedef KernelIndices<I...> Type; };
+
+/**
+ * Kernel of 'N' samples for the default strength and falloff of the demo
+ * (see 'KernelPresets'), calculated at compile time.
+ */
+template <int N, typename Indices=typename MakeKernelIndices<N>::Type>
+struct KernelPreset;
+
+template <int N, int... I>
+struct KernelPreset<N, KernelIndices<I...> > {
+    static constexpr KernelSample samples[N] = {
+        KernelGenerator::sample(N, I, 0.48f, 0.41f, 0.28f, 1.0f, 0.37f, 0.3f)...
+    };
+};
+
+template <int N, int... I>
+constexpr KernelSample KernelPreset<N, KernelIndices<I...> >::samples[N];
+
+
+/**
+ * The kernels of the SSSS_QUALITY presets of 'SeparableSSS.h', for the
+ * default strength (0.48, 0.41, 0.28) and falloff (1.0, 0.37, 0.3) of the
+ * demo. They are calculated at compile time by the same code that calculates
+ * the other kernels at run time, so they never drift from it; the tables of
+ * 'SeparableSSS.h' can be checked against them with the 'KernelCode' tool.
+ */
+class KernelPresets {
+    public:
+        static const int N_QUALITIES = 3;
+
+        /**
+         * Number of samples of each quality (0 to 2, see SSSS_QUALITY).
+         */
+        static int getSampleCount(int quality) {
+            static const int counts[N_QUALITIES] = { 11, 17, 25 };
+            return counts[quality];
+        }
+
+        static const KernelSample *get(int quality) {
+            switch (quality) {
+                case 0:  return KernelPreset<11>::samples;
+                case 1:  return KernelPreset<17>::samples;
+                default: return KernelPreset<25>::samples;
+            }
+        }
+
+        /**
+         * Returns the preset for the specified parameters, or NULL if there
+         * is none.
+         */
+        static const KernelSample *find(int nSamples, const Vector3 &strength, const Vector3 &falloff) {
+            if (strength.x != 0.48f || strength.y != 0.41f || strength.z != 0.28f ||
+                falloff.x != 1.0f || falloff.y != 0.37f || falloff.z != 0.3f)
+                return NULL;
+            for (int quality = 0; quality < N_QUALITIES; quality++) {
+                if (getSampleCount(quality) == nSamples)
+                    return get(quality);
+            }
+            return NULL;
+        }
+};
+#endif
+
+#endif
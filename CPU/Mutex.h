@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+/**
+ * Visual Studio 2010, used by the demo, has no <mutex>, so this wraps a
+ * critical section there, and 'std::mutex' elsewhere.
+ */
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include <windows.h>
+
+class Mutex {
+    public:
+        Mutex() { InitializeCriticalSection(&section); }
+        ~Mutex() { DeleteCriticalSection(&section); }
+        void lock() { EnterCriticalSection(&section); }
+        void unlock() { LeaveCriticalSection(&section); }
+
+    private:
+        CRITICAL_SECTION section;
+
+        Mutex(const Mutex &);
+        Mutex &operator=(const Mutex &);
+};
+#else
+#include <mutex>
+
+class Mutex : public std::mutex {};
+#endif
+
+
+/**
+ * Scoped lock, that works with both.
+ */
+class ScopedLock {
+    public:
+        ScopedLock(Mutex &mutex) : mutex(mutex) { mutex.lock(); }
+        ~ScopedLock() { mutex.unlock(); }
+
+    private:
+        Mutex &mutex;
+
+        ScopedLock(const ScopedLock &);
+        ScopedLock &operator=(const ScopedLock &);
+};
+
+#endif
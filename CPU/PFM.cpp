@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cstring>
+#include <fstream>
+#include "PFM.h"
+using namespace std;
+
+
+static bool isLittleEndian() {
+    unsigned int one = 1;
+    unsigned char c;
+    memcpy(&c, &one, 1);
+    return c == 1;
+}
+
+
+static void swapBytes(float *data, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char *b = (unsigned char *) &data[i];
+        unsigned char t;
+        t = b[0]; b[0] = b[3]; b[3] = t;
+        t = b[1]; b[1] = b[2]; b[2] = t;
+    }
+}
+
+
+bool PFM::load(const string &path,
+               int &width, int &height, int &channels,
+               vector<float> &pixels) {
+    ifstream file(path.c_str(), ios::binary);
+    if (!file)
+        return false;
+
+    string type;
+    double scale;
+    file >> type >> width >> height >> scale;
+    if (!file || width <= 0 || height <= 0 || scale == 0.0)
+        return false;
+    if (type == "PF")
+        channels = 3;
+    else if (type == "Pf")
+        channels = 1;
+    else
+        return false;
+
+    // A single whitespace character separates the header from the data:
+    file.get();
+
+    const size_t rowSize = size_t(width) * channels;
+    pixels.resize(rowSize * height);
+    for (int y = height - 1; y >= 0; y--)
+        file.read((char *) &pixels[y * rowSize], rowSize * sizeof(float));
+    if (!file)
+        return false;
+
+    // Negative scales mean little endian data:
+    if ((scale < 0.0) != isLittleEndian())
+        swapBytes(&pixels.front(), pixels.size());
+    return true;
+}
+
+
+bool PFM::save(const string &path,
+               int width, int height, int channels,
+               const float *pixels) {
+    if (channels != 1 && channels != 3)
+        return false;
+
+    ofstream file(path.c_str(), ios::binary);
+    if (!file)
+        return false;
+
+    file << (channels == 3? "PF" : "Pf") << "\n" << width << " " << height << "\n" << "-1.0\n";
+
+    const size_t rowSize = size_t(width) * channels;
+    vector<float> row(rowSize);
+    for (int y = height - 1; y >= 0; y--) {
+        memcpy(&row.front(), pixels + y * rowSize, rowSize * sizeof(float));
+        if (!isLittleEndian())
+            swapBytes(&row.front(), rowSize);
+        file.write((const char *) &row.front(), rowSize * sizeof(float));
+    }
+    return !file.fail();
+}
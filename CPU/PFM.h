@@ -0,0 +1,71 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef PFM_H
+#define PFM_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Reads and writes Portable Float Map images ('.pfm'): uncompressed 32-bit
+ * floats, with one (grayscale) or three (RGB) channels per pixel. They are
+ * exported by most HDR tools (HDRShop, Photoshop, ImageMagick, pfstools), and
+ * are trivial to parse, which makes them handy for storing captured inputs
+ * and reference outputs of the CPU engine.
+ *
+ * Pixels are interleaved, row-major, with the top row first (the file
+ * itself stores the bottom row first, which is taken care of here).
+ */
+class PFM {
+    public:
+        /**
+         * Returns false if the file cannot be opened or is not a valid PFM.
+         */
+        static bool load(const std::string &path,
+                         int &width, int &height, int &channels,
+                         std::vector<float> &pixels);
+
+        /**
+         * 'channels' must be 1 or 3. Files are always written in little
+         * endian.
+         */
+        static bool save(const std::string &path,
+                         int width, int height, int channels,
+                         const float *pixels);
+};
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <limits>
+#include "PixelFormat.h"
+using namespace std;
+
+
+/**
+ * Exact sRGB curves, in double precision. They are only used to build the
+ * tables.
+ */
+static double srgbDecode(double c) {
+    return c <= 0.04045? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+}
+
+
+static double srgbEncode(double v) {
+    return v <= 0.0031308? 12.92 * v : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+}
+
+
+static int srgbCode(float v) {
+    return int(floor(255.0 * srgbEncode(v) + 0.5));
+}
+
+
+PixelFormat::PixelFormat() {
+    for (int c = 0; c < 256; c++) {
+        srgbTable[c] = float(srgbDecode(c / 255.0));
+        unormTable[c] = float(c) / 255.0f;
+    }
+
+    // Search the bit patterns of the floats in [0, 1] (which are ordered as
+    // the floats themselves) for the first one encoded as 'k + 1':
+    unsigned int one;
+    float oneF = 1.0f;
+    memcpy(&one, &oneF, 4);
+    for (int k = 0; k < 255; k++) {
+        unsigned int lo = 0, hi = one;
+        while (lo < hi) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            float v;
+            memcpy(&v, &mid, 4);
+            if (srgbCode(v) >= k + 1)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        memcpy(&srgbThresholds[k], &lo, 4);
+    }
+    srgbThresholds[255] = numeric_limits<float>::infinity();
+
+    for (int i = 0; i < SRGB_BINS; i++)
+        srgbStart[i] = (unsigned char) srgbCode(float(i) / float(SRGB_BINS));
+}
+
+
+const PixelFormat &PixelFormat::get() {
+    static PixelFormat format;
+    return format;
+}
+
+
+int PixelFormat::getSize(Format format) {
+    switch (format) {
+        case FORMAT_RGBA16F:    return 8;
+        case FORMAT_RGBA8_SRGB: return 4;
+        default:                return 16;
+    }
+}
+
+
+const char *PixelFormat::getName(Format format) {
+    switch (format) {
+        case FORMAT_RGBA32F:    return "RGBA32F";
+        case FORMAT_RGBA16F:    return "RGBA16F";
+        case FORMAT_RGBA8_SRGB: return "RGBA8_SRGB";
+        default:                return "Unknown";
+    }
+}
+
+
+void PixelFormat::store(Format format, void *data, int i, const float rgba[4]) {
+    switch (format) {
+        case FORMAT_RGBA16F: {
+            unsigned short *p = (unsigned short *) data + 4 * i;
+            p[0] = floatToHalf(rgba[0]);
+            p[1] = floatToHalf(rgba[1]);
+            p[2] = floatToHalf(rgba[2]);
+            p[3] = floatToHalf(rgba[3]);
+            break;
+        }
+        case FORMAT_RGBA8_SRGB: {
+            unsigned char *p = (unsigned char *) data + 4 * i;
+            p[0] = linearToSrgb(rgba[0]);
+            p[1] = linearToSrgb(rgba[1]);
+            p[2] = linearToSrgb(rgba[2]);
+            p[3] = floatToUnorm(rgba[3]);
+            break;
+        }
+        default: {
+            float *p = (float *) data + 4 * i;
+            p[0] = rgba[0];
+            p[1] = rgba[1];
+            p[2] = rgba[2];
+            p[3] = rgba[3];
+            break;
+        }
+    }
+}
+
+
+unsigned short PixelFormat::floatToHalf(float f) {
+    unsigned int u;
+    memcpy(&u, &f, 4);
+    unsigned short sign = (unsigned short) ((u >> 16) & 0x8000u);
+    unsigned int a = u & 0x7fffffffu;
+
+    // Infinities and NaNs (which are kept quiet):
+    if (a >= 0x7f800000u)
+        return sign | 0x7c00 | (a > 0x7f800000u? 0x200 | ((a >> 13) & 0x3ff) : 0);
+
+    // Values that round to 65520 or more overflow:
+    if (a >= 0x477ff000u)
+        return sign | 0x7c00;
+
+    unsigned int q, rem, half;
+    if (a >= 0x38800000u) {
+        // Normal: rebias the exponent and drop 13 bits of mantissa:
+        a -= 0x38000000u;
+        q = a >> 13;
+        rem = a & 0x1fffu;
+        half = 0x1000u;
+    } else if (a > 0x33000000u) {
+        // Denormal: shift the mantissa (with its implicit bit) into place:
+        unsigned int m = (a & 0x7fffffu) | 0x800000u;
+        int shift = 126 - int(a >> 23);
+        q = m >> shift;
+        rem = m & ((1u << shift) - 1);
+        half = 1u << (shift - 1);
+    } else {
+        // Too small, rounds to zero:
+        return sign;
+    }
+
+    // Round to nearest even (a carry into the exponent is still correct):
+    if (rem > half || (rem == half && (q & 1)))
+        q++;
+    return sign | (unsigned short) q;
+}
+
+
+unsigned char PixelFormat::linearToSrgb(float v) {
+    if (!(v > 0.0f)) // Also catches NaNs
+        return 0;
+    if (v >= 1.0f)
+        return 255;
+    const PixelFormat &f = get();
+    int code = f.srgbStart[int(v * float(SRGB_BINS))];
+    return (unsigned char) (v >= f.srgbThresholds[code]? code + 1 : code);
+}
+
+
+unsigned char PixelFormat::floatToUnorm(float v) {
+    if (!(v > 0.0f)) // Also catches NaNs
+        return 0;
+    if (v >= 1.0f)
+        return 255;
+    return (unsigned char) int(v * 255.0f + 0.5f);
+}
@@ -0,0 +1,186 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef PIXELFORMAT_H
+#define PIXELFORMAT_H
+
+#include <cstring>
+
+/**
+ * Storage formats for the RGBA images read and written by the passes,
+ * mirroring the choices for 'tmpRT' in 'SeparableSSS' (see its 'format'
+ * parameter):
+ *   - FORMAT_RGBA32F: four floats per pixel (16 bytes).
+ *   - FORMAT_RGBA16F: four halfs per pixel (8 bytes), like
+ *     DXGI_FORMAT_R16G16B16A16_FLOAT.
+ *   - FORMAT_RGBA8_SRGB: four bytes per pixel, like
+ *     DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: RGB are sRGB encoded and alpha is
+ *     linear.
+ *
+ * Pixels are always decoded into floats before filtering, as the texture
+ * units do, so the accumulation is done at full precision whatever the
+ * storage is. Encoding rounds to the nearest representable value, and zero
+ * is stored as all bits zero in every format.
+ */
+class PixelFormat {
+    public:
+        enum Format { FORMAT_RGBA32F = 0,
+                      FORMAT_RGBA16F = 1,
+                      FORMAT_RGBA8_SRGB = 2 };
+
+        /**
+         * Size of a pixel, in bytes.
+         */
+        static int getSize(Format format);
+        static const char *getName(Format format);
+
+        /**
+         * Decodes (or encodes) pixel 'i' of 'data'.
+         */
+        static inline void load(Format format, const void *data, int i, float rgba[4]);
+        static inline float loadAlpha(Format format, const void *data, int i);
+        static void store(Format format, void *data, int i, const float rgba[4]);
+
+        /**
+         * IEEE half conversions, rounding to nearest even (same results as
+         * the F16C instructions).
+         */
+        static inline float halfToFloat(unsigned short h);
+        static unsigned short floatToHalf(float f);
+
+        /**
+         * sRGB and UNORM conversions of one channel. Decoding goes through
+         * 256-entry tables; encoding returns the byte whose value is the
+         * closest to 'v' in the encoded space, that is, the same as rounding
+         * the exact sRGB curve.
+         */
+        static float srgbToLinear(unsigned char c) { return get().srgbTable[c]; }
+        static float unormToFloat(unsigned char c) { return get().unormTable[c]; }
+        static unsigned char linearToSrgb(float v);
+        static unsigned char floatToUnorm(float v);
+
+        /**
+         * Decoding tables, for the SIMD backends.
+         */
+        static const float *getSRGBTable() { return get().srgbTable; }
+        static const float *getUNormTable() { return get().unormTable; }
+
+    private:
+        PixelFormat();
+        static const PixelFormat &get();
+
+        float srgbTable[256];
+        float unormTable[256];
+
+        /**
+         * 'srgbThresholds[k]' is the smallest value encoded as 'k + 1'.
+         * 'srgbStart[i]' is the code of 'i / SRGB_BINS'; as the curve never
+         * rises more than one code per bin, the code of any value in the bin
+         * is either that one or the next.
+         */
+        static const int SRGB_BINS = 4096;
+        float srgbThresholds[256];
+        unsigned char srgbStart[SRGB_BINS];
+};
+
+
+inline float PixelFormat::halfToFloat(unsigned short h) {
+    // Shift exponent and mantissa into place and rebias the exponent by
+    // multiplying by 2^112 (which also takes care of the denormals).
+    // Infinities and NaNs get their exponent fixed afterwards (and NaNs are
+    // made quiet):
+    unsigned int em = (h & 0x7fffu) << 13;
+    unsigned int magic = 0x77800000u;
+    float f, scale;
+    memcpy(&f, &em, 4);
+    memcpy(&scale, &magic, 4);
+    f *= scale;
+
+    unsigned int u;
+    memcpy(&u, &f, 4);
+    if (em >= 0x0f800000u)
+        u |= 0x7f800000u;
+    if (em > 0x0f800000u)
+        u |= 0x00400000u;
+    u |= (h & 0x8000u) << 16;
+    memcpy(&f, &u, 4);
+    return f;
+}
+
+
+inline void PixelFormat::load(Format format, const void *data, int i, float rgba[4]) {
+    switch (format) {
+        case FORMAT_RGBA16F: {
+            const unsigned short *p = (const unsigned short *) data + 4 * i;
+            rgba[0] = halfToFloat(p[0]);
+            rgba[1] = halfToFloat(p[1]);
+            rgba[2] = halfToFloat(p[2]);
+            rgba[3] = halfToFloat(p[3]);
+            break;
+        }
+        case FORMAT_RGBA8_SRGB: {
+            const unsigned char *p = (const unsigned char *) data + 4 * i;
+            const PixelFormat &f = get();
+            rgba[0] = f.srgbTable[p[0]];
+            rgba[1] = f.srgbTable[p[1]];
+            rgba[2] = f.srgbTable[p[2]];
+            rgba[3] = f.unormTable[p[3]];
+            break;
+        }
+        default: {
+            const float *p = (const float *) data + 4 * i;
+            rgba[0] = p[0];
+            rgba[1] = p[1];
+            rgba[2] = p[2];
+            rgba[3] = p[3];
+            break;
+        }
+    }
+}
+
+
+inline float PixelFormat::loadAlpha(Format format, const void *data, int i) {
+    switch (format) {
+        case FORMAT_RGBA16F:
+            return halfToFloat(((const unsigned short *) data)[4 * i + 3]);
+        case FORMAT_RGBA8_SRGB:
+            return unormToFloat(((const unsigned char *) data)[4 * i + 3]);
+        default:
+            return ((const float *) data)[4 * i + 3];
+    }
+}
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include "Profile.h"
+using namespace std;
+
+
+Profile Profile::fromFalloff(const Vector3 &falloff) {
+    const float weights[] = { 0.100f, 0.118f, 0.113f, 0.358f, 0.078f };
+    const float variances[] = { 0.0484f, 0.187f, 0.567f, 1.99f, 7.41f };
+
+    // Scaling the distance by '1 / (0.001 + falloff)' scales the variances by
+    // its square. Weights are scaled the same, to keep the normalization of
+    // each gaussian as it was:
+    Profile profile;
+    for (int k = 0; k < 5; k++) {
+        Vector3 weight, variance;
+        for (int c = 0; c < 3; c++) {
+            float s = (0.001f + falloff[c]) * (0.001f + falloff[c]);
+            weight[c] = weights[k] * s;
+            variance[c] = variances[k] * s;
+        }
+        profile.addTerm(weight, variance);
+    }
+    return profile;
+}
+
+
+Profile Profile::skin() {
+    const Vector3 weights[] = { Vector3(0.233f, 0.455f, 0.649f),
+                                Vector3(0.1f,   0.336f, 0.344f),
+                                Vector3(0.118f, 0.198f, 0.0f),
+                                Vector3(0.113f, 0.007f, 0.007f),
+                                Vector3(0.358f, 0.004f, 0.0f),
+                                Vector3(0.078f, 0.0f,   0.0f) };
+    const float variances[] = { 0.0064f, 0.0484f, 0.187f, 0.567f, 1.99f, 7.41f };
+
+    Profile profile;
+    for (int k = 0; k < 6; k++)
+        profile.addTerm(weights[k], Vector3(variances[k], variances[k], variances[k]));
+    return profile;
+}
+
+
+void Profile::addTerm(const Vector3 &weight, const Vector3 &variance) {
+    Term term = { weight, variance };
+    terms.push_back(term);
+}
+
+
+Vector3 Profile::evaluate(float r) const {
+    const double PI = 3.14159265358979323846;
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    for (size_t k = 0; k < terms.size(); k++) {
+        for (int c = 0; c < 3; c++) {
+            double v = terms[k].variance[c];
+            if (v > 0.0)
+                sum[c] += terms[k].weight[c] * exp(-double(r) * r / (2.0 * v)) / (2.0 * PI * v);
+        }
+    }
+    return Vector3(float(sum[0]), float(sum[1]), float(sum[2]));
+}
+
+
+Vector3 Profile::getTransmittance(float d) const {
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    for (size_t k = 0; k < terms.size(); k++) {
+        for (int c = 0; c < 3; c++) {
+            double v = terms[k].variance[c];
+            if (v > 0.0)
+                sum[c] += terms[k].weight[c] * exp(-double(d) * d / v);
+        }
+    }
+    return Vector3(float(sum[0]), float(sum[1]), float(sum[2]));
+}
+
+
+float Profile::getRange() const {
+    float widest = 0.0f;
+    for (size_t k = 0; k < terms.size(); k++) {
+        for (int c = 0; c < 3; c++)
+            widest = max(widest, terms[k].variance[c]);
+    }
+    return 6.0f * sqrt(widest);
+}
+
+
+float Profile::getNarrowest() const {
+    float narrowest = 0.0f;
+    for (size_t k = 0; k < terms.size(); k++) {
+        for (int c = 0; c < 3; c++) {
+            float v = terms[k].variance[c];
+            if (v > 0.0f && (narrowest == 0.0f || v < narrowest))
+                narrowest = v;
+        }
+    }
+    return sqrt(narrowest);
+}
+
+
+string Profile::getTransmittanceCode() const {
+    stringstream s;
+    s << "#define SSSS_TRANSMITTANCE_PROFILE(dd) ( \\" << "\r\n";
+    for (size_t k = 0; k < terms.size(); k++) {
+        const Term &t = terms[k];
+        s << "    float3(" << t.weight.x << ", " << t.weight.y << ", " << t.weight.z << ") * "
+          << "exp(dd / float3(" << t.variance.x << ", " << t.variance.y << ", " << t.variance.z << "))"
+          << (k + 1 < terms.size()? " + \\" : ")") << "\r\n";
+    }
+    if (terms.empty())
+        s << "    float3(0.0, 0.0, 0.0))" << "\r\n";
+    return s.str();
+}
@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <string>
+#include <vector>
+#include "Kernel.h"
+
+/**
+ * Radial diffusion profile, expressed as a sum of gaussians, as in
+ * [d'Eon07]:
+ *     R(r) = sum_k weight_k * G(variance_k, r)
+ *     G(v, r) = exp(-r^2 / (2 v)) / (2 pi v)
+ * with per-channel weights and variances.
+ *
+ * The transmittance through a slab of thickness 'd' is then calculated as in
+ * 'SSSSTransmittance':
+ *     T(d) = sum_k weight_k * exp(-d^2 / variance_k)
+ *
+ * Profiles can be built from the falloff parameter (see @STRENGTH in
+ * 'SeparableSSS.h'), or fitted to measured data (see 'ProfileFitter').
+ */
+class Profile {
+    public:
+        struct Term {
+            Vector3 weight;
+            Vector3 variance;
+        };
+
+        Profile() {}
+
+        /**
+         * The profile used by 'Kernel::profile' for the specified falloff:
+         * the d'Eon07 skin profile, without its narrowest gaussian (see
+         * 'KernelGenerator::profile'), widened by the falloff.
+         */
+        static Profile fromFalloff(const Vector3 &falloff);
+
+        /**
+         * The full d'Eon07 skin profile (six gaussians with per-channel
+         * weights), which is the one used by 'SSSSTransmittance'.
+         */
+        static Profile skin();
+
+        void addTerm(const Vector3 &weight, const Vector3 &variance);
+        const std::vector<Term> &getTerms() const { return terms; }
+        int getTermCount() const { return int(terms.size()); }
+
+        Vector3 evaluate(float r) const;
+        Vector3 getTransmittance(float d) const;
+
+        /**
+         * Distance beyond which the profile is negligible (six standard
+         * deviations of its widest gaussian), and standard deviation of the
+         * narrowest one, which sets the resolution needed for tabulating it.
+         */
+        float getRange() const;
+        float getNarrowest() const;
+
+        /**
+         * Returns the profile as a SSSS_TRANSMITTANCE_PROFILE define, to be
+         * used by 'SSSSTransmittance' instead of the skin one.
+         */
+        std::string getTransmittanceCode() const;
+
+    private:
+        std::vector<Term> terms;
+};
+
+#endif
@@ -0,0 +1,423 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include "ProfileFitter.h"
+using namespace std;
+
+
+/**
+ * Solves the K x K system 'a x = b' by gaussian elimination with partial
+ * pivoting ('a' and 'b' are destroyed). Returns false if it's singular.
+ */
+static bool solve(vector<double> &a, vector<double> &b, vector<double> &x, int K) {
+    for (int i = 0; i < K; i++) {
+        int pivot = i;
+        for (int j = i + 1; j < K; j++) {
+            if (abs(a[j * K + i]) > abs(a[pivot * K + i]))
+                pivot = j;
+        }
+        if (!(abs(a[pivot * K + i]) > 0.0))
+            return false;
+        if (pivot != i) {
+            for (int k = 0; k < K; k++)
+                swap(a[i * K + k], a[pivot * K + k]);
+            swap(b[i], b[pivot]);
+        }
+        for (int j = i + 1; j < K; j++) {
+            double f = a[j * K + i] / a[i * K + i];
+            for (int k = i; k < K; k++)
+                a[j * K + k] -= f * a[i * K + k];
+            b[j] -= f * b[i];
+        }
+    }
+    x.resize(K);
+    for (int i = K - 1; i >= 0; i--) {
+        double s = b[i];
+        for (int k = i + 1; k < K; k++)
+            s -= a[i * K + k] * x[k];
+        x[i] = s / a[i * K + i];
+    }
+    return true;
+}
+
+
+/**
+ * Non-negative least squares (Lawson-Hanson), given the normal equations
+ * 'm w = b' of the problem.
+ */
+static void nnls(const vector<double> &m, const vector<double> &b, vector<double> &w, int K) {
+    w.assign(K, 0.0);
+    vector<bool> passive(K, false);
+
+    // A tiny ridge keeps nearly equal gaussians solvable:
+    double ridge = 0.0;
+    for (int k = 0; k < K; k++)
+        ridge += m[k * K + k];
+    ridge *= 1e-12 / K;
+
+    for (int iteration = 0; iteration < 3 * K; iteration++) {
+        // Add the variable that would reduce the error the most:
+        int best = -1;
+        double bestGradient = 0.0;
+        for (int k = 0; k < K; k++) {
+            double g = b[k];
+            for (int j = 0; j < K; j++)
+                g -= m[k * K + j] * w[j];
+            if (!passive[k] && g > bestGradient)
+                best = k, bestGradient = g;
+        }
+        if (best < 0 || bestGradient <= 1e-14 * (abs(b[best]) + 1e-300))
+            break;
+        passive[best] = true;
+
+        // Solve over the passive set, stepping back while that makes any
+        // weight negative:
+        for (int inner = 0; inner < 3 * K; inner++) {
+            vector<int> p;
+            for (int k = 0; k < K; k++) {
+                if (passive[k])
+                    p.push_back(k);
+            }
+            const int P = int(p.size());
+            vector<double> a(P * P), rhs(P), z;
+            for (int i = 0; i < P; i++) {
+                for (int j = 0; j < P; j++)
+                    a[i * P + j] = m[p[i] * K + p[j]] + (i == j? ridge : 0.0);
+                rhs[i] = b[p[i]];
+            }
+            if (!solve(a, rhs, z, P)) {
+                passive[best] = false;
+                break;
+            }
+
+            double alpha = 1.0;
+            for (int i = 0; i < P; i++) {
+                if (z[i] <= 0.0)
+                    alpha = min(alpha, w[p[i]] / (w[p[i]] - z[i]));
+            }
+            for (int i = 0; i < P; i++)
+                w[p[i]] += alpha * (z[i] - w[p[i]]);
+            if (alpha >= 1.0)
+                break;
+            for (int i = 0; i < P; i++) {
+                if (w[p[i]] <= 0.0) {
+                    w[p[i]] = 0.0;
+                    passive[p[i]] = false;
+                }
+            }
+        }
+    }
+}
+
+
+static double gaussian(double variance, double r) {
+    const double PI = 3.14159265358979323846;
+    return exp(-r * r / (2.0 * variance)) / (2.0 * PI * variance);
+}
+
+
+ProfileFitter::ProfileFitter(int nTerms, int nStarts) :
+        nTerms(max(nTerms, 1)),
+        nStarts(max(nStarts, 1)),
+        pool(NULL) {}
+
+
+ProfileFitter::Channel ProfileFitter::setupChannel(const MeasuredProfile &measured, int c) const {
+    const int n = int(min(measured.radii.size(), measured.values.size()));
+
+    Channel channel;
+    channel.peak = 0.0;
+    double maxRadius = 0.0;
+    for (int i = 0; i < n; i++) {
+        double r = abs(measured.radii[i]);
+        channel.radii.push_back(r);
+        channel.values.push_back(measured.values[i][c]);
+        channel.peak = max(channel.peak, abs(double(measured.values[i][c])));
+        maxRadius = max(maxRadius, r);
+    }
+
+    double spacing = n > 1? maxRadius / (n - 1) : 1.0;
+    if (!(spacing > 0.0))
+        spacing = 1.0;
+    for (int i = 0; i < n; i++)
+        channel.scales.push_back(sqrt(channel.radii[i] + spacing));
+
+    // From half the spacing of the samples to the full range covered by them:
+    channel.minVariance = 0.25 * spacing * spacing;
+    channel.maxVariance = max(maxRadius * maxRadius, 4.0 * channel.minVariance);
+    return channel;
+}
+
+
+double ProfileFitter::solveWeights(const Channel &channel,
+                                   const vector<double> &variances,
+                                   vector<double> &weights,
+                                   vector<double> *residuals) const {
+    const int n = int(channel.radii.size());
+    const int K = nTerms;
+
+    // Basis, with the scales of the residuals applied:
+    vector<double> basis(n * K);
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < K; k++)
+            basis[i * K + k] = channel.scales[i] * gaussian(variances[k], channel.radii[i]);
+    }
+
+    // Normal equations:
+    vector<double> m(K * K, 0.0), b(K, 0.0);
+    for (int i = 0; i < n; i++) {
+        const double *row = &basis[i * K];
+        double y = channel.scales[i] * channel.values[i];
+        for (int k = 0; k < K; k++) {
+            b[k] += row[k] * y;
+            for (int j = 0; j < K; j++)
+                m[k * K + j] += row[k] * row[j];
+        }
+    }
+    nnls(m, b, weights, K);
+
+    // Calculate the residuals explicitly, as the normal equations lose too
+    // much precision for small errors:
+    double error = 0.0;
+    if (residuals != NULL)
+        residuals->resize(n);
+    for (int i = 0; i < n; i++) {
+        double e = channel.scales[i] * channel.values[i];
+        for (int k = 0; k < K; k++)
+            e -= basis[i * K + k] * weights[k];
+        error += e * e;
+        if (residuals != NULL)
+            (*residuals)[i] = e;
+    }
+    return error;
+}
+
+
+ProfileFitter::Solution ProfileFitter::fitChannel(const Channel &channel, int start) const {
+    const int n = int(channel.radii.size());
+    const int K = nTerms;
+    const double lo = log(channel.minVariance), hi = log(channel.maxVariance);
+
+    // Log-spaced starting variances, jittered by up to half of their spacing
+    // (but for the first start):
+    unsigned int state = 1234567u + 7919u * unsigned(start);
+    vector<double> theta(K);
+    for (int k = 0; k < K; k++) {
+        state = state * 1664525u + 1013904223u;
+        double jitter = start == 0? 0.0 : float(state >> 8) / float(1 << 24) - 0.5;
+        theta[k] = lo + (hi - lo) * (k + 0.5 + jitter) / K;
+    }
+
+    Solution solution;
+    vector<double> variances(K), residuals, trial, weights;
+    for (int k = 0; k < K; k++)
+        variances[k] = exp(theta[k]);
+    double error = solveWeights(channel, variances, weights, &residuals);
+
+    // Levenberg-Marquardt over the logarithms of the variances, with a
+    // forward differences jacobian:
+    const double h = 1e-5;
+    double lambda = 1e-3;
+    vector<double> jacobian(n * K), jtj(K * K), jte(K), delta;
+    for (int iteration = 0; iteration < 100 && error > 0.0; iteration++) {
+        for (int k = 0; k < K; k++) {
+            vector<double> v = variances, w;
+            v[k] = exp(theta[k] + h);
+            solveWeights(channel, v, w, &trial);
+            for (int i = 0; i < n; i++)
+                jacobian[i * K + k] = (trial[i] - residuals[i]) / h;
+        }
+        for (int k = 0; k < K; k++) {
+            jte[k] = 0.0;
+            for (int j = 0; j < K; j++)
+                jtj[k * K + j] = 0.0;
+        }
+        for (int i = 0; i < n; i++) {
+            const double *row = &jacobian[i * K];
+            for (int k = 0; k < K; k++) {
+                jte[k] += row[k] * residuals[i];
+                for (int j = 0; j < K; j++)
+                    jtj[k * K + j] += row[k] * row[j];
+            }
+        }
+
+        bool improved = false;
+        double previous = error;
+        while (lambda < 1e12) {
+            vector<double> a = jtj, b(K);
+            for (int k = 0; k < K; k++) {
+                a[k * K + k] += lambda * jtj[k * K + k] + 1e-15;
+                b[k] = -jte[k];
+            }
+            if (solve(a, b, delta, K)) {
+                vector<double> t(K), v(K), w;
+                for (int k = 0; k < K; k++) {
+                    t[k] = min(hi, max(lo, theta[k] + delta[k]));
+                    v[k] = exp(t[k]);
+                }
+                double e = solveWeights(channel, v, w, &trial);
+                if (e < error) {
+                    theta = t;
+                    variances = v;
+                    weights = w;
+                    residuals = trial;
+                    error = e;
+                    lambda = max(lambda * 0.3, 1e-12);
+                    improved = true;
+                    break;
+                }
+            }
+            lambda *= 4.0;
+        }
+        if (!improved || previous - error <= 1e-10 * previous)
+            break;
+    }
+
+    solution.variances = variances;
+    solution.weights = weights;
+    solution.error = error;
+    return solution;
+}
+
+
+ProfileFitter::Solution ProfileFitter::fitChannel(const Channel &channel) const {
+    Solution best = fitChannel(channel, 0);
+    for (int s = 1; s < nStarts; s++) {
+        Solution solution = fitChannel(channel, s);
+        if (solution.error < best.error)
+            best = solution;
+    }
+    return best;
+}
+
+
+Profile ProfileFitter::assemble(const Solution solutions[3], const Channel channels[3], Vector3 *error) const {
+    // Sort the gaussians of each channel by variance, so that the terms
+    // of the profile go from the narrowest to the widest:
+    vector<pair<double, double> > terms[3];
+    for (int c = 0; c < 3; c++) {
+        for (int k = 0; k < nTerms; k++)
+            terms[c].push_back(make_pair(solutions[c].variances[k], solutions[c].weights[k]));
+        sort(terms[c].begin(), terms[c].end());
+    }
+
+    Profile profile;
+    for (int k = 0; k < nTerms; k++) {
+        profile.addTerm(Vector3(float(terms[0][k].second), float(terms[1][k].second), float(terms[2][k].second)),
+                        Vector3(float(terms[0][k].first), float(terms[1][k].first), float(terms[2][k].first)));
+    }
+
+    if (error != NULL) {
+        for (int c = 0; c < 3; c++) {
+            const Channel &channel = channels[c];
+            const int n = int(channel.radii.size());
+            double sum = 0.0;
+            for (int i = 0; i < n; i++) {
+                double e = channel.values[i];
+                for (int k = 0; k < nTerms; k++)
+                    e -= terms[c][k].second * gaussian(terms[c][k].first, channel.radii[i]);
+                sum += e * e;
+            }
+            (*error)[c] = n > 0 && channel.peak > 0.0? float(sqrt(sum / n) / channel.peak) : 0.0f;
+        }
+    }
+    return profile;
+}
+
+
+Profile ProfileFitter::fit(const MeasuredProfile &measured, Vector3 *error) const {
+    Channel channels[3];
+    for (int c = 0; c < 3; c++)
+        channels[c] = setupChannel(measured, c);
+
+    Solution best[3];
+    if (pool == NULL) {
+        for (int c = 0; c < 3; c++)
+            best[c] = fitChannel(channels[c]);
+    } else {
+        // Every starting point of every channel runs in parallel:
+        vector<Solution> solutions(3 * nStarts);
+        for (int c = 0; c < 3; c++) {
+            for (int s = 0; s < nStarts; s++) {
+                Solution *solution = &solutions[c * nStarts + s];
+                const Channel *channel = &channels[c];
+                pool->submit([this, solution, channel, s] { *solution = fitChannel(*channel, s); });
+            }
+        }
+        pool->wait();
+
+        for (int c = 0; c < 3; c++) {
+            best[c] = solutions[c * nStarts];
+            for (int s = 1; s < nStarts; s++) {
+                if (solutions[c * nStarts + s].error < best[c].error)
+                    best[c] = solutions[c * nStarts + s];
+            }
+        }
+    }
+    return assemble(best, channels, error);
+}
+
+
+void ProfileFitter::fit(const vector<MeasuredProfile> &measured,
+                        vector<Profile> &profiles,
+                        vector<Vector3> *errors) const {
+    const int n = int(measured.size());
+    vector<Channel> channels(3 * n);
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < 3; c++)
+            channels[3 * i + c] = setupChannel(measured[i], c);
+    }
+
+    // Channels run in parallel, each one going through all its starting
+    // points:
+    vector<Solution> solutions(3 * n);
+    for (int i = 0; i < 3 * n; i++) {
+        if (pool != NULL)
+            pool->submit([this, &solutions, &channels, i] { solutions[i] = fitChannel(channels[i]); });
+        else
+            solutions[i] = fitChannel(channels[i]);
+    }
+    if (pool != NULL)
+        pool->wait();
+
+    profiles.resize(n);
+    if (errors != NULL)
+        errors->resize(n);
+    for (int i = 0; i < n; i++)
+        profiles[i] = assemble(&solutions[3 * i], &channels[3 * i], errors != NULL? &(*errors)[i] : NULL);
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef PROFILEFITTER_H
+#define PROFILEFITTER_H
+
+#include <vector>
+#include "Profile.h"
+#include "ThreadPool.h"
+
+/**
+ * Radial diffusion profile R(r), measured or tabulated at arbitrary radii
+ * (in the same units as the offsets of the kernel), per channel.
+ */
+struct MeasuredProfile {
+    std::vector<float> radii;
+    std::vector<Vector3> values;
+};
+
+
+/**
+ * Fits sums of gaussians (see 'Profile') to measured profiles, by non-linear
+ * least squares: each channel gets 'nTerms' gaussians of its own.
+ *
+ * The variances are found by Levenberg-Marquardt, starting from 'nStarts'
+ * different sets of log-spaced variances (the first one evenly spaced, the
+ * others jittered), and for each set of variances, the best non-negative
+ * weights are solved exactly (variable projection). The residuals are
+ * weighted by the radius (plus the mean spacing, so that the center still
+ * counts), as the energy of each ring grows with it.
+ *
+ * If a thread pool is set, starting points (or whole profiles, when fitting
+ * many) run in parallel. It must not be used concurrently.
+ */
+class ProfileFitter {
+    public:
+        ProfileFitter(int nTerms=4, int nStarts=16);
+
+        void setThreadPool(ThreadPool *pool) { this->pool = pool; }
+        ThreadPool *getThreadPool() const { return pool; }
+
+        /**
+         * Fits a single profile. If 'error' is not NULL, it gets the RMS
+         * error of each channel, relative to its peak value.
+         */
+        Profile fit(const MeasuredProfile &measured, Vector3 *error=NULL) const;
+
+        /**
+         * Fits a library of profiles.
+         */
+        void fit(const std::vector<MeasuredProfile> &measured,
+                 std::vector<Profile> &profiles,
+                 std::vector<Vector3> *errors=NULL) const;
+
+    private:
+        /**
+         * Samples of one channel, along with the scale applied to each
+         * residual (the square root of its weight), and the range the
+         * variances are searched in.
+         */
+        struct Channel {
+            std::vector<double> radii, values, scales;
+            double minVariance, maxVariance;
+            double peak;
+        };
+
+        struct Solution {
+            std::vector<double> variances, weights;
+            double error; // Weighted sum of squared residuals
+        };
+
+        Channel setupChannel(const MeasuredProfile &measured, int c) const;
+        Solution fitChannel(const Channel &channel, int start) const;
+        Solution fitChannel(const Channel &channel) const;
+        double solveWeights(const Channel &channel, const std::vector<double> &variances, std::vector<double> &weights, std::vector<double> *residuals) const;
+        Profile assemble(const Solution solutions[3], const Channel channels[3], Vector3 *error) const;
+
+        int nTerms, nStarts;
+        ThreadPool *pool;
+};
+
+#endif
@@ -0,0 +1,396 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include "Profiler.h"
+#include "Mutex.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+using namespace std;
+
+/**
+ * Counters shared by the thread that owns a buffer and the one collecting
+ * it. Visual Studio 2010, used by the demo, has no <atomic>; there, aligned
+ * 32-bit volatile accesses are atomic, and have acquire and release
+ * semantics.
+ */
+#if defined(_MSC_VER) && _MSC_VER < 1700
+class Profiler::Counter {
+    public:
+        Counter() : value(0) {}
+        unsigned int load() const { return value; }
+        void store(unsigned int value) { this->value = value; }
+
+    private:
+        volatile unsigned int value;
+};
+#else
+#include <atomic>
+
+class Profiler::Counter {
+    public:
+        Counter() : value(0) {}
+        unsigned int load() const { return value.load(memory_order_acquire); }
+        void store(unsigned int value) { this->value.store(value, memory_order_release); }
+
+    private:
+        atomic<unsigned int> value;
+};
+#endif
+
+#if defined(_MSC_VER)
+#define SSSS_THREAD_LOCAL __declspec(thread)
+#else
+#define SSSS_THREAD_LOCAL __thread
+#endif
+
+
+/**
+ * Ring buffer of the zones closed by a thread, along with the zones it has
+ * open. Only the owner thread writes the events and 'head', and only the
+ * collecting one writes 'tail'.
+ */
+class Profiler::Buffer {
+    public:
+        Buffer(int size, const void *thread, int index) :
+            events(size), mask(size - 1), thread(thread), index(index), depth(0) {}
+
+        vector<Event> events;
+        unsigned int mask;
+        Counter head, tail;
+
+        const void *thread;
+        int index;
+
+        int depth;
+        int open[MAX_DEPTH];
+        long long starts[MAX_DEPTH];
+};
+
+
+/**
+ * The address of 'threadKey' identifies the calling thread. The buffer of
+ * the last profiler it used is cached.
+ */
+static SSSS_THREAD_LOCAL char threadKey;
+static SSSS_THREAD_LOCAL void *cachedBuffer = NULL;
+static SSSS_THREAD_LOCAL int cachedProfiler = -1;
+
+static Mutex idMutex;
+static int nextId = 0;
+
+
+Profiler &Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+
+Profiler::Profiler(int window, int bufferSize) :
+        window(window > 0? window : 1),
+        enabled(new Counter()),
+        mutex(new Mutex()),
+        tracing(false),
+        maxTraceEvents(0),
+        traceStart(0) {
+    // Round the buffers up to a power of two:
+    this->bufferSize = 1;
+    while (this->bufferSize < bufferSize)
+        this->bufferSize *= 2;
+
+    ScopedLock lock(idMutex);
+    id = nextId++;
+}
+
+
+Profiler::~Profiler() {
+    for (size_t i = 0; i < buffers.size(); i++)
+        delete buffers[i];
+    delete mutex;
+    delete enabled;
+}
+
+
+void Profiler::setEnabled(bool enabled) {
+    this->enabled->store(enabled? 1 : 0);
+}
+
+
+bool Profiler::isEnabled() const {
+    return enabled->load() != 0;
+}
+
+
+int Profiler::getZone(const string &name) {
+    ScopedLock lock(*mutex);
+    for (size_t i = 0; i < zones.size(); i++) {
+        if (zones[i].name == name)
+            return int(i);
+    }
+
+    Zone zone;
+    zone.name = name;
+    zone.count = 0;
+    zones.push_back(zone);
+    return int(zones.size()) - 1;
+}
+
+
+int Profiler::getZoneCount() const {
+    ScopedLock lock(*mutex);
+    return int(zones.size());
+}
+
+
+string Profiler::getZoneName(int zone) const {
+    ScopedLock lock(*mutex);
+    return zones[zone].name;
+}
+
+
+Profiler::Buffer *Profiler::getBuffer() {
+    if (cachedProfiler == id)
+        return (Buffer *) cachedBuffer;
+
+    ScopedLock lock(*mutex);
+    Buffer *buffer = NULL;
+    for (size_t i = 0; i < buffers.size() && buffer == NULL; i++) {
+        if (buffers[i]->thread == &threadKey)
+            buffer = buffers[i];
+    }
+    if (buffer == NULL) {
+        buffer = new Buffer(bufferSize, &threadKey, int(buffers.size()));
+        buffers.push_back(buffer);
+    }
+
+    cachedProfiler = id;
+    cachedBuffer = buffer;
+    return buffer;
+}
+
+
+void Profiler::begin(int zone) {
+    if (enabled->load() == 0)
+        return;
+
+    Buffer *buffer = getBuffer();
+    if (buffer->depth < MAX_DEPTH) {
+        buffer->open[buffer->depth] = zone;
+        buffer->starts[buffer->depth] = now();
+    }
+    buffer->depth++;
+}
+
+
+void Profiler::end() {
+    if (enabled->load() == 0)
+        return;
+
+    long long t = now();
+    Buffer *buffer = getBuffer();
+    if (buffer->depth == 0)
+        return;
+    buffer->depth--;
+    if (buffer->depth >= MAX_DEPTH)
+        return;
+
+    // Drop the zone if the buffer is full:
+    unsigned int head = buffer->head.load();
+    if (head - buffer->tail.load() > buffer->mask)
+        return;
+
+    Event &event = buffer->events[head & buffer->mask];
+    event.begin = buffer->starts[buffer->depth];
+    event.end = t;
+    event.zone = buffer->open[buffer->depth];
+    event.depth = buffer->depth;
+    buffer->head.store(head + 1);
+}
+
+
+void Profiler::collect() {
+    ScopedLock lock(*mutex);
+    for (size_t b = 0; b < buffers.size(); b++) {
+        Buffer *buffer = buffers[b];
+        unsigned int head = buffer->head.load();
+        for (unsigned int i = buffer->tail.load(); i != head; i++) {
+            const Event &event = buffer->events[i & buffer->mask];
+
+            if (event.zone >= 0 && event.zone < int(zones.size())) {
+                Zone &zone = zones[event.zone];
+                if (zone.samples.empty())
+                    zone.samples.resize(window);
+                zone.samples[zone.count % window] = event.end - event.begin;
+                zone.count++;
+            }
+
+            if (tracing && int(trace.size()) < maxTraceEvents) {
+                TraceEvent traceEvent = { event, buffer->index };
+                trace.push_back(traceEvent);
+            }
+        }
+        buffer->tail.store(head);
+    }
+}
+
+
+Profiler::Stats Profiler::getStats(int zone) const {
+    vector<long long> samples;
+    {
+        ScopedLock lock(*mutex);
+        const Zone &z = zones[zone];
+        samples.assign(z.samples.begin(), z.samples.begin() + (z.count < window? int(z.count) : window));
+    }
+    sort(samples.begin(), samples.end());
+
+    Stats stats = { int(samples.size()), 0.0, 0.0, 0.0, 0.0, 0.0 };
+    if (samples.empty())
+        return stats;
+
+    // Nearest rank percentiles:
+    const double ms = 1000.0 * getTickPeriod();
+    const int n = int(samples.size());
+    double sum = 0.0;
+    for (int i = 0; i < n; i++)
+        sum += double(samples[i]);
+    stats.mean = ms * sum / n;
+    stats.p50 = ms * samples[(50 * n + 99) / 100 - 1];
+    stats.p95 = ms * samples[(95 * n + 99) / 100 - 1];
+    stats.p99 = ms * samples[(99 * n + 99) / 100 - 1];
+    stats.max = ms * samples[n - 1];
+    return stats;
+}
+
+
+void Profiler::reset() {
+    ScopedLock lock(*mutex);
+    for (size_t i = 0; i < zones.size(); i++) {
+        zones[i].samples.clear();
+        zones[i].count = 0;
+    }
+}
+
+
+void Profiler::print(ostream &out) const {
+    out << setprecision(2) << fixed;
+    for (int i = 0; i < getZoneCount(); i++) {
+        Stats stats = getStats(i);
+        if (stats.count == 0)
+            continue;
+        out << getZoneName(i) << " : " << stats.mean << "ms : p50 " << stats.p50
+            << "ms : p95 " << stats.p95 << "ms : p99 " << stats.p99 << "ms" << endl;
+    }
+}
+
+
+void Profiler::startTrace(int maxEvents) {
+    ScopedLock lock(*mutex);
+    tracing = true;
+    maxTraceEvents = maxEvents;
+    traceStart = now();
+    trace.clear();
+}
+
+
+void Profiler::stopTrace() {
+    ScopedLock lock(*mutex);
+    tracing = false;
+}
+
+
+/**
+ * Writes 's' as a JSON string.
+ */
+static void writeString(ostream &out, const string &s) {
+    out << '"';
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = (unsigned char) s[i];
+        if (c == '"' || c == '\\')
+            out << '\\' << s[i];
+        else if (c < 0x20)
+            out << "\\u" << hex << setw(4) << setfill('0') << int(c) << dec << setfill(' ');
+        else
+            out << s[i];
+    }
+    out << '"';
+}
+
+
+void Profiler::writeTrace(ostream &out) const {
+    ScopedLock lock(*mutex);
+    const double us = 1000000.0 * getTickPeriod();
+
+    out << "{\"traceEvents\":[" << endl;
+    out << setprecision(3) << fixed;
+    for (size_t i = 0; i < trace.size(); i++) {
+        const Event &event = trace[i].event;
+        out << "{\"name\":";
+        writeString(out, zones[event.zone].name);
+        out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << trace[i].thread
+            << ",\"ts\":" << us * double(event.begin - traceStart)
+            << ",\"dur\":" << us * double(event.end - event.begin)
+            << "}" << (i + 1 < trace.size()? "," : "") << endl;
+    }
+    out << "]}" << endl;
+}
+
+
+long long Profiler::now() {
+    #if defined(_WIN32)
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+    #else
+    return chrono::steady_clock::now().time_since_epoch().count();
+    #endif
+}
+
+
+double Profiler::getTickPeriod() {
+    #if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return 1.0 / double(frequency.QuadPart);
+    #else
+    return double(chrono::steady_clock::period::num) / double(chrono::steady_clock::period::den);
+    #endif
+}
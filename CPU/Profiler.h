@@ -0,0 +1,208 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class Mutex;
+
+/**
+ * Portable, low overhead CPU profiler with nested zones:
+ *
+ *     void renderScene() {
+ *         SSSS_PROFILE("Skin");
+ *         ...
+ *     }
+ *
+ * Zones are registered by name once (see 'getZone'), and then referred to by
+ * their ID, so that opening and closing them involves no lookups nor
+ * allocations. Each thread writes its closed zones into its own ring buffer,
+ * without locks; 'collect' (usually called once per frame) drains them into
+ * the statistics of each zone, and into the trace if one is being recorded.
+ * Zones closed while the buffer of their thread is full (that is, when
+ * 'collect' is not called often enough) are lost.
+ *
+ * It's disabled by default, in which case zones cost a single check.
+ */
+class Profiler {
+    public:
+        struct Stats {
+            int count; // Number of samples the statistics are calculated from
+            double mean, p50, p95, p99, max; // In milliseconds
+        };
+
+        /**
+         * The profiler used by the SSSS_PROFILE macro.
+         */
+        static Profiler &get();
+
+        /**
+         * Statistics are calculated from the last 'window' samples of each
+         * zone, and each thread can buffer up to 'bufferSize' zones between
+         * 'collect' calls.
+         */
+        Profiler(int window=256, int bufferSize=16384);
+        ~Profiler();
+
+        /**
+         * Should be changed while no zone is open.
+         */
+        void setEnabled(bool enabled);
+        bool isEnabled() const;
+
+        /**
+         * Returns the ID of the zone called 'name', registering it if it's
+         * new. This one takes a lock, so it should be called once per zone.
+         */
+        int getZone(const std::string &name);
+        int getZoneCount() const;
+        std::string getZoneName(int zone) const;
+
+        /**
+         * Opens and closes zones in the calling thread. Zones must be closed
+         * in reverse order (see 'ProfilerScope'), and can be nested up to
+         * MAX_DEPTH levels.
+         */
+        void begin(int zone);
+        void end();
+
+        /**
+         * Drains the buffers of all threads.
+         */
+        void collect();
+
+        Stats getStats(int zone) const;
+        void reset();
+
+        /**
+         * Writes the statistics of all zones, one per line.
+         */
+        void print(std::ostream &out) const;
+
+        /**
+         * Records all the zones collected between these two calls (up to
+         * 'maxEvents'), for writing them in the Chrome trace event format
+         * (which can be opened in chrome://tracing or Perfetto).
+         */
+        void startTrace(int maxEvents=1 << 20);
+        void stopTrace();
+        void writeTrace(std::ostream &out) const;
+
+        /**
+         * Monotonic clock used for the zones, and length of its ticks in
+         * seconds.
+         */
+        static long long now();
+        static double getTickPeriod();
+
+        static const int MAX_DEPTH = 64;
+
+    private:
+        class Counter;
+        class Buffer;
+
+        struct Event {
+            long long begin, end;
+            int zone;
+            int depth;
+        };
+
+        struct TraceEvent {
+            Event event;
+            int thread;
+        };
+
+        /**
+         * Durations of the last 'window' samples of a zone, in ticks.
+         */
+        struct Zone {
+            std::string name;
+            std::vector<long long> samples;
+            long long count;
+        };
+
+        Buffer *getBuffer();
+
+        int window, bufferSize;
+        Counter *enabled;
+        int id; // Tells apart the buffers of different profilers
+
+        Mutex *mutex;
+        std::vector<Buffer *> buffers;
+        std::vector<Zone> zones;
+
+        bool tracing;
+        int maxTraceEvents;
+        long long traceStart;
+        std::vector<TraceEvent> trace;
+
+        Profiler(const Profiler &);
+        Profiler &operator=(const Profiler &);
+};
+
+
+/**
+ * Keeps a zone open while in scope.
+ */
+class ProfilerScope {
+    public:
+        ProfilerScope(int zone, Profiler &profiler=Profiler::get()) : profiler(profiler) { profiler.begin(zone); }
+        ~ProfilerScope() { profiler.end(); }
+
+    private:
+        Profiler &profiler;
+
+        ProfilerScope(const ProfilerScope &);
+        ProfilerScope &operator=(const ProfilerScope &);
+};
+
+
+#define SSSS_PROFILE_CONCAT2(a, b) a##b
+#define SSSS_PROFILE_CONCAT(a, b) SSSS_PROFILE_CONCAT2(a, b)
+
+/**
+ * Profiles the rest of the enclosing block as zone 'name', with the shared
+ * profiler. The zone is registered the first time it's reached.
+ */
+#define SSSS_PROFILE(name) \
+    static const int SSSS_PROFILE_CONCAT(profilerZone, __LINE__) = Profiler::get().getZone(name); \
+    ProfilerScope SSSS_PROFILE_CONCAT(profilerScope, __LINE__)(SSSS_PROFILE_CONCAT(profilerZone, __LINE__))
+
+#endif
@@ -0,0 +1,356 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "Pyramid.h"
+using namespace std;
+
+
+/**
+ * Rows are processed in bands whose height is a multiple of the size of a
+ * block of the coarsest level, so that different bands never write to the
+ * same coarse pixels.
+ */
+static const int BAND_HEIGHT = 64;
+
+
+template <class F>
+void Pyramid::forRows(int height, ThreadPool *pool, const F &f) {
+    const int nBands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    for (int band = 0; band < nBands; band++) {
+        int y0 = band * BAND_HEIGHT, y1 = min(y0 + BAND_HEIGHT, height);
+        if (pool != NULL)
+            pool->submit([&f, y0, y1, band] { f(y0, y1, band); });
+        else
+            f(y0, y1, band);
+    }
+    if (pool != NULL)
+        pool->wait();
+}
+
+
+void Pyramid::build(const BlurPass &pass, int nLevels, float maxTapSpacing, ThreadPool *pool) {
+    width = pass.width;
+    height = pass.height;
+    this->nLevels = max(0, min(nLevels, int(MAX_LEVELS)));
+    surfaceScale = 300.0f * pass.distanceToProjectionWindow * pass.sssWidth;
+    srcColor = (const float *) pass.src;
+    srcDepth = pass.depth;
+    srcStrength = pass.strength;
+
+    // The biggest offset, and the biggest gap between consecutive taps:
+    vector<float> offsets(pass.nSamples);
+    for (int k = 0; k < pass.nSamples; k++)
+        offsets[k] = pass.kernel[k].offset;
+    sort(offsets.begin(), offsets.end());
+    maxOffset = max(abs(offsets.front()), abs(offsets.back()));
+    maxGap = 0.0f;
+    for (int k = 1; k < pass.nSamples; k++)
+        maxGap = max(maxGap, offsets[k] - offsets[k - 1]);
+
+    for (int l = 0; l <= this->nLevels; l++) {
+        Level &level = levels[l];
+        level.width = l == 0? width : (levels[l - 1].width + 1) / 2;
+        level.height = l == 0? height : (levels[l - 1].height + 1) / 2;
+        const int n = level.width * level.height;
+        level.skin.resize(n);
+        level.blurStencil.assign(n, 0);
+        level.reachStencil.resize(n);
+        if (l > 0) {
+            level.color.resize(4 * n);
+            level.depth.resize(n);
+            level.strength.resize(n);
+            level.tmp.resize(4 * n);
+            level.result.resize(4 * n);
+        }
+    }
+    routing.resize(width * height);
+
+    // Route the pixels, keeping how far the vertical taps of each level
+    // reach:
+    const int nBands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    vector<int> reaches(nBands * (MAX_LEVELS + 1), 0), counts(nBands * (MAX_LEVELS + 1), 0);
+    forRows(height, pool, [&](int y0, int y1, int band) {
+        route(pass, maxTapSpacing, y0, y1, &reaches[band * (MAX_LEVELS + 1)], &counts[band * (MAX_LEVELS + 1)]);
+    });
+
+    for (int l = 1; l <= this->nLevels; l++) {
+        forRows(levels[l].height, pool, [&](int y0, int y1, int) { downsample(l, y0, y1); });
+    }
+
+    for (int l = 0; l <= this->nLevels; l++) {
+        int reach = 0;
+        levels[l].pixelCount = 0;
+        for (int band = 0; band < nBands; band++) {
+            reach = max(reach, reaches[band * (MAX_LEVELS + 1) + l]);
+            levels[l].pixelCount += counts[band * (MAX_LEVELS + 1) + l];
+        }
+        markStencils(l, reach);
+    }
+}
+
+
+void Pyramid::route(const BlurPass &pass, float maxTapSpacing, int y0, int y1, int *reach, int *counts) {
+    const float size = float(max(width, height));
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < width; x++) {
+            const int i = y * width + x;
+            float s = srcStrength != NULL? srcStrength[i] : srcColor[4 * i + 3];
+
+            // Same stencil test as 'BlurPass::run':
+            bool skin;
+            if (pass.initStencil != NULL) {
+                skin = s != 0.0f;
+                pass.initStencil[i] = skin? (unsigned char) pass.id : 0;
+            } else {
+                skin = pass.stencil == NULL || pass.stencil[i] == pass.id;
+            }
+            levels[0].skin[i] = skin? 1 : 0;
+            if (!skin) {
+                routing[i] = NO_LEVEL;
+                continue;
+            }
+
+            // Step between taps, in texcoord units per unit of offset (see
+            // 'Footprint'), and the biggest gap between taps, in pixels:
+            float step = pass.footprint != NULL? abs(pass.footprint[i]) :
+                         abs(pass.sssWidth * pass.distanceToProjectionWindow / srcDepth[i] * s * (1.0f / 3.0f));
+            int l = 0;
+            if (!(step < numeric_limits<float>::max())) { // Infinities and NaNs
+                l = nLevels;
+            } else {
+                float gap = step * size * maxGap;
+                while (l < nLevels && gap > maxTapSpacing)
+                    gap *= 0.5f, l++;
+            }
+            routing[i] = (unsigned char) l;
+            counts[l]++;
+            levels[l].blurStencil[(y >> l) * levels[l].width + (x >> l)] = 1;
+
+            // Coarser pixels are a bit off their full resolution pixels, so
+            // they get one more pixel of margin:
+            const int n = levels[l].height;
+            float r = maxOffset * step * float(n);
+            reach[l] = max(reach[l], r < float(n)? int(ceil(r)) + 1 + (l > 0? 1 : 0) : n);
+        }
+    }
+}
+
+
+void Pyramid::downsample(int l, int y0, int y1) {
+    Level &level = levels[l];
+    const Level &fine = levels[l - 1];
+    const bool full = l == 1; // The inputs of level 0 are not copied
+
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < level.width; x++) {
+            // The 2x2 block, clamped for odd sizes:
+            int children[4];
+            for (int k = 0; k < 4; k++) {
+                int cx = min(2 * x + (k & 1), fine.width - 1);
+                int cy = min(2 * y + (k >> 1), fine.height - 1);
+                children[k] = cy * fine.width + cx;
+            }
+
+            // Average the skin pixels on the nearest surface, if any, or
+            // else all of them:
+            float nearest = numeric_limits<float>::max();
+            bool skin = false;
+            for (int k = 0; k < 4; k++) {
+                int c = children[k];
+                if (fine.skin[c]) {
+                    skin = true;
+                    nearest = min(nearest, full? srcDepth[c] : fine.depth[c]);
+                }
+            }
+
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float depth = 0.0f, strength = 0.0f, n = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                int c = children[k];
+                float d = full? srcDepth[c] : fine.depth[c];
+                if (skin && (!fine.skin[c] || surfaceScale * abs(d - nearest) >= 1.0f))
+                    continue;
+                const float *rgba = full? &srcColor[4 * c] : &fine.color[4 * c];
+                for (int j = 0; j < 4; j++)
+                    sum[j] += rgba[j];
+                depth += d;
+                strength += full? (srcStrength != NULL? srcStrength[c] : rgba[3]) : fine.strength[c];
+                n += 1.0f;
+            }
+
+            const int i = y * level.width + x;
+            for (int j = 0; j < 4; j++)
+                level.color[4 * i + j] = sum[j] / n;
+            level.depth[i] = depth / n;
+            level.strength[i] = strength / n;
+            level.skin[i] = skin? 1 : 0;
+        }
+    }
+}
+
+
+void Pyramid::markStencils(int l, int reach) {
+    Level &level = levels[l];
+    const int w = level.width, h = level.height;
+
+    fill(level.reachStencil.begin(), level.reachStencil.end(), (unsigned char) 0);
+    if (level.pixelCount == 0) {
+        fill(level.blurStencil.begin(), level.blurStencil.end(), (unsigned char) 0);
+        return;
+    }
+
+    // The bilinear upsampling of coarser levels also reads the neighbours of
+    // the pixels routed to them:
+    if (l > 0) {
+        scratch = level.blurStencil;
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                const int i = y * w + x;
+                if (!level.skin[i])
+                    continue;
+                bool marked = false;
+                for (int dy = max(y - 1, 0); dy <= min(y + 1, h - 1) && !marked; dy++)
+                    for (int dx = max(x - 1, 0); dx <= min(x + 1, w - 1) && !marked; dx++)
+                        marked = scratch[dy * w + dx] != 0;
+                level.blurStencil[i] = marked? 1 : 0;
+            }
+        }
+    }
+
+    // The horizontal pass is needed where the vertical taps reach, which
+    // is found from the distance to the closest pixel marked above and below
+    // in each column (sweeping whole rows, to walk the memory in order):
+    vector<int> last(w, -reach - 1);
+    for (int y = 0; y < h; y++) {
+        const unsigned char *blur = &level.blurStencil[y * w], *skin = &level.skin[y * w];
+        unsigned char *marked = &level.reachStencil[y * w];
+        for (int x = 0; x < w; x++) {
+            if (blur[x])
+                last[x] = y;
+            marked[x] = y - last[x] <= reach && skin[x];
+        }
+    }
+    fill(last.begin(), last.end(), h + reach);
+    for (int y = h - 1; y >= 0; y--) {
+        const unsigned char *blur = &level.blurStencil[y * w], *skin = &level.skin[y * w];
+        unsigned char *marked = &level.reachStencil[y * w];
+        for (int x = 0; x < w; x++) {
+            if (blur[x])
+                last[x] = y;
+            marked[x] |= last[x] - y <= reach && skin[x];
+        }
+    }
+}
+
+
+void Pyramid::upsample(float *color, const KernelSample &center, ThreadPool *pool) const {
+    if (nLevels == 0)
+        return;
+    forRows(height, pool, [&](int y0, int y1, int) { upsampleRows(color, center, y0, y1); });
+}
+
+
+void Pyramid::upsampleRows(float *color, const KernelSample &center, int y0, int y1) const {
+    // Vertical bilinear weights of each level, for the current row:
+    int rows[MAX_LEVELS + 1][2];
+    float wy[MAX_LEVELS + 1][2];
+    float scales[MAX_LEVELS + 1];
+    for (int l = 0; l <= MAX_LEVELS; l++)
+        scales[l] = 1.0f / float(1 << l);
+
+    for (int y = y0; y < y1; y++) {
+        for (int l = 1; l <= nLevels; l++) {
+            float v = (float(y) + 0.5f) / float(1 << l) - 0.5f, fv = floor(v);
+            rows[l][0] = max(int(fv), 0) * levels[l].width;
+            rows[l][1] = min(int(fv) + 1, levels[l].height - 1) * levels[l].width;
+            wy[l][0] = 1.0f - (v - fv);
+            wy[l][1] = v - fv;
+        }
+
+        for (int x = 0; x < width; x++) {
+            const int i = y * width + x;
+            const int l = routing[i];
+            if (l == 0 || l == NO_LEVEL)
+                continue;
+
+            // Bilinear neighbours of the pixel in its level, weighted by
+            // how close they are to its surface:
+            const Level &level = levels[l];
+            const unsigned char *stencil = &level.blurStencil.front();
+            const float *depth = &level.depth.front(), *result = &level.result.front(), *coarseColor = &level.color.front();
+            float u = (float(x) + 0.5f) * scales[l] - 0.5f;
+            int iu = int(u + 1.0f) - 1; // Rounds down, as u >= -0.5
+            float fu = float(iu);
+            int xs[2] = { max(iu, 0), min(iu + 1, level.width - 1) };
+            float wx[2] = { 1.0f - (u - fu), u - fu };
+            const float depthM = srcDepth[i];
+
+            float blurred[3] = { 0.0f, 0.0f, 0.0f }, coarse[3] = { 0.0f, 0.0f, 0.0f };
+            float total = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                int j = rows[l][k >> 1] + xs[k & 1];
+                if (!stencil[j])
+                    continue;
+                float w = wx[k & 1] * wy[l][k >> 1] * max(0.0f, 1.0f - surfaceScale * abs(depth[j] - depthM));
+                for (int c = 0; c < 3; c++) {
+                    blurred[c] += w * result[4 * j + c];
+                    coarse[c] += w * coarseColor[4 * j + c];
+                }
+                total += w;
+            }
+
+            // If no neighbour is on the same surface, fall back to the pixel
+            // that contains this one:
+            if (total < 1e-4f) {
+                int j = (y >> l) * level.width + (x >> l);
+                for (int c = 0; c < 3; c++) {
+                    blurred[c] = result[4 * j + c];
+                    coarse[c] = coarseColor[4 * j + c];
+                }
+                total = 1.0f;
+            }
+
+            // The center tap sees the full resolution pixel instead of the
+            // coarse one:
+            const float weights[3] = { center.r, center.g, center.b };
+            for (int c = 0; c < 3; c++)
+                color[4 * i + c] = (blurred[c] + weights[c] * (color[4 * i + c] * total - coarse[c])) / total;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <vector>
+#include "BlurPass.h"
+#include "ThreadPool.h"
+
+/**
+ * Depth-aware half and quarter resolution copies of the inputs of the blur,
+ * for wide kernels (see 'SeparableSSSCPU::setPyramid').
+ *
+ * The taps of a kernel are spaced proportionally to its footprint on screen,
+ * so for wide profiles (close-ups, wax, marble) they end up many pixels
+ * apart: at full resolution, most of the bandwidth goes into fetching pixels
+ * that are then undersampled anyway. Instead, each pixel is routed to the
+ * finest level where the largest gap between its taps is at most
+ * 'maxTapSpacing' pixels of that level (or to the coarsest one, if there is
+ * none), and the kernel, whose offsets are in texcoord units, is run over
+ * that level. As each level has a quarter of the pixels of the previous one,
+ * the cost of a pixel stops growing with its footprint.
+ *
+ * Note that the largest gap is the one between the outermost taps, which for
+ * the power placement is about a quarter of the range of the kernel: even
+ * small footprints leave full resolution (see 'Benchmark::pyramid').
+ *
+ * Levels are built by averaging 2x2 blocks; when a block holds skin, only
+ * the skin pixels on the nearest surface are averaged (using the same depth
+ * test as follow-surface), so that silhouettes do not bleed into the skin.
+ * The results are brought back with a bilinear upsampling weighted by depth,
+ * and the detail lost by the downsampling is added back through the center
+ * tap of the kernel.
+ */
+class Pyramid {
+    public:
+        static const int MAX_LEVELS = 2;
+
+        /**
+         * A level of the pyramid. Level 0 is the full resolution one, whose
+         * inputs are not copied (only its stencils are used).
+         *
+         * blurStencil marks the pixels whose blurred result is needed (the
+         * ones routed to this level, and their bilinear neighbours), and
+         * reachStencil the ones whose horizontal pass is needed, that is,
+         * the skin pixels the vertical taps of the former can reach.
+         */
+        struct Level {
+            int width, height;
+            std::vector<float> color; // RGBA
+            std::vector<float> depth;
+            std::vector<float> strength;
+            std::vector<unsigned char> skin;
+            std::vector<unsigned char> blurStencil, reachStencil;
+            std::vector<float> tmp, result; // RGBA, for the passes
+            int pixelCount; // Full resolution pixels routed to this level
+        };
+
+        Pyramid() : nLevels(0) {}
+
+        /**
+         * Builds 'nLevels' coarser levels from the inputs of 'pass' (its
+         * color, depth, strength, stencil and width parameters), and routes
+         * each pixel to its level. If 'pass.initStencil' is not NULL it gets
+         * initialized as the passes would do. 'pass.src' must be stored
+         * as RGBA32F.
+         */
+        void build(const BlurPass &pass, int nLevels, float maxTapSpacing, ThreadPool *pool=NULL);
+
+        /**
+         * Writes the results of the coarser levels (their 'result' buffers)
+         * into the full resolution pixels routed to them, in 'color' (the
+         * unblurred input). 'center' is the center sample of the kernel.
+         */
+        void upsample(float *color, const KernelSample &center, ThreadPool *pool=NULL) const;
+
+        int getLevelCount() const { return nLevels + 1; }
+        Level &getLevel(int level) { return levels[level]; }
+        const Level &getLevel(int level) const { return levels[level]; }
+
+        /**
+         * Level of each full resolution pixel, or NO_LEVEL for the ones that
+         * are not processed.
+         */
+        static const unsigned char NO_LEVEL = 255;
+        const unsigned char *getRouting() const { return &routing.front(); }
+
+    private:
+        void route(const BlurPass &pass, float maxTapSpacing, int y0, int y1, int *reach, int *counts);
+        void downsample(int level, int y0, int y1);
+        void markStencils(int level, int reach);
+        void upsampleRows(float *color, const KernelSample &center, int y0, int y1) const;
+        template <class F> static void forRows(int height, ThreadPool *pool, const F &f);
+
+        int width, height;
+        int nLevels;
+        float surfaceScale; // Depth differences are scaled by this in the follow-surface test
+        float maxOffset, maxGap; // Of the kernel
+        const float *srcColor, *srcDepth, *srcStrength;
+        Level levels[MAX_LEVELS + 1];
+        std::vector<unsigned char> routing;
+        std::vector<unsigned char> scratch;
+};
+
+#endif
@@ -0,0 +1,605 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "SeparableSSSCPU.h"
+#include "Checkerboard.h"
+#include "KernelAtlas.h"
+#include "KernelCache.h"
+#include "Profiler.h"
+#include "TileScheduler.h"
+#include "Transpose.h"
+using namespace std;
+
+
+SeparableSSSCPU::SeparableSSSCPU(int width,
+                                 int height,
+                                 float fovy,
+                                 float sssWidth,
+                                 int nSamples,
+                                 bool stencilInitialized,
+                                 bool followSurface,
+                                 bool separateStrengthSource,
+                                 PixelFormat::Format format) : width(width),
+                                 height(height),
+                                 sssWidth(sssWidth),
+                                 nSamples(nSamples),
+                                 stencilInitialized(stencilInitialized),
+                                 followSurface(followSurface),
+                                 separateStrengthSource(separateStrengthSource),
+                                 format(format),
+                                 strength(Vector3(0.48f, 0.41f, 0.28f)),
+                                 falloff(Vector3(1.0f, 0.37f, 0.3f)),
+                                 customProfile(false),
+                                 placement(Kernel::PLACEMENT_POWER),
+                                 backend(BlurPass::resolve(BlurPass::BACKEND_AUTO)),
+                                 pool(NULL),
+                                 tileWidth(64),
+                                 tileHeight(64),
+                                 sparse(false),
+                                 streaming(false),
+                                 transposed(false),
+                                 footprintPrepass(false),
+                                 atlas(NULL),
+                                 pyramidLevels(0),
+                                 maxTapSpacing(2.0f),
+                                 checkerboard(false),
+                                 checkerboardParity(0),
+                                 checkerboardThreshold(0.01f),
+                                 checkerboardFullCount(0),
+                                 adaptiveSampling(false),
+                                 adaptiveTapSpacing(1.0f),
+                                 tapMerging(false),
+                                 tapMergingError(0.002f),
+                                 tmpClean(true),
+                                 streamer(NULL) {
+    // Same as in 'SSSSBlurPS' (1.0 for a unit plane sitting on the
+    // projection window):
+    distanceToProjectionWindow = 1.0f / tan(0.5f * fovy * 3.14159265f / 180.0f);
+
+    // The temporal render target is created on first use, as it's not needed
+    // when streaming:
+    if (!stencilInitialized)
+        mask.resize(width * height);
+
+    // And finally, calculate the sample positions and weights:
+    calculateKernel();
+}
+
+
+void SeparableSSSCPU::setKernel(const vector<KernelSample> &kernel) {
+    this->kernel = kernel;
+    nSamples = int(kernel.size());
+
+    // There's no way to calculate smaller versions of a custom kernel:
+    smallerKernels.clear();
+    buildKernelSet();
+}
+
+
+void SeparableSSSCPU::setTapMerging(bool enabled, float maxError) {
+    tapMerging = enabled;
+    tapMergingError = maxError;
+    buildKernelSet();
+}
+
+
+void SeparableSSSCPU::setAdaptiveSampling(bool enabled, float maxTapSpacing) {
+    adaptiveSampling = enabled;
+    adaptiveTapSpacing = maxTapSpacing;
+    calculateKernel();
+}
+
+
+void SeparableSSSCPU::setStreaming(bool streaming) {
+    this->streaming = streaming;
+    if (streaming)
+        vector<unsigned char>().swap(tmp);
+}
+
+
+void SeparableSSSCPU::calculateKernel() {
+    if (customProfile)
+        Kernel::calculate(kernel, nSamples, strength, profile, placement);
+    else
+        KernelCache::getShared().calculate(kernel, nSamples, strength, falloff, placement);
+
+    // The smaller kernels for adaptive sampling, with the same parameters:
+    smallerKernels.clear();
+    if (adaptiveSampling) {
+        vector<int> counts;
+        TileClassifier::getSampleCounts(nSamples, placement, counts);
+        smallerKernels.resize(counts.size() - 1);
+        for (size_t i = 0; i < smallerKernels.size(); i++) {
+            if (customProfile)
+                Kernel::calculate(smallerKernels[i], counts[i], strength, profile, placement);
+            else
+                KernelCache::getShared().calculate(smallerKernels[i], counts[i], strength, falloff, placement);
+        }
+    }
+    buildKernelSet();
+}
+
+
+void SeparableSSSCPU::buildKernelSet() {
+    kernelSet.clear();
+    kernelSteps.clear();
+    if (smallerKernels.empty() && !tapMerging)
+        return;
+
+    // Every kernel, along with the largest step (in pixels per unit of
+    // offset) it can be used with; the full one can be used everywhere:
+    vector<vector<KernelSample> > candidates(smallerKernels);
+    candidates.push_back(kernel);
+    vector<float> steps;
+    for (size_t i = 0; i < smallerKernels.size(); i++)
+        steps.push_back(TileClassifier::getMaxStep(smallerKernels[i], adaptiveTapSpacing));
+    steps.push_back(numeric_limits<float>::infinity());
+
+    // And their merged versions, which can only be used where the merged
+    // taps are at most one pixel apart. Each gap between neighbouring taps
+    // is tried as the limit:
+    if (tapMerging) {
+        const size_t n = candidates.size();
+        vector<KernelSample> merged;
+        for (size_t i = 0; i < n; i++) {
+            vector<float> offsets;
+            for (size_t k = 0; k < candidates[i].size(); k++)
+                offsets.push_back(candidates[i][k].offset);
+            sort(offsets.begin(), offsets.end());
+
+            for (size_t k = 1; k < offsets.size(); k++) {
+                float gap = Kernel::merge(candidates[i], merged, tapMergingError, offsets[k] - offsets[k - 1]);
+                if (gap > 0.0f) {
+                    candidates.push_back(merged);
+                    steps.push_back(min(steps[i], 1.0f / gap));
+                }
+            }
+        }
+    }
+
+    // The classifier takes the first kernel that fits, so they are sorted
+    // by cost, and those that can't be used with larger steps than a
+    // cheaper one are dropped, as they would never be picked:
+    vector<int> order(candidates.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = int(i);
+    sort(order.begin(), order.end(), [&candidates, &steps](int a, int b) {
+        if (candidates[a].size() != candidates[b].size())
+            return candidates[a].size() < candidates[b].size();
+        return steps[a] > steps[b];
+    });
+    for (size_t i = 0; i < order.size(); i++) {
+        if (kernelSteps.empty() || steps[order[i]] > kernelSteps.back()) {
+            kernelSet.push_back(candidates[order[i]]);
+            kernelSteps.push_back(steps[order[i]]);
+        }
+    }
+}
+
+
+BlurPass SeparableSSSCPU::setupPass(BlurPass::Direction dir,
+                                    const float *depth,
+                                    const float *strength,
+                                    int id) const {
+    BlurPass pass;
+    pass.depth = depth;
+    pass.strength = separateStrengthSource? strength : NULL;
+    pass.id = id;
+    pass.width = width;
+    pass.height = height;
+    pass.dir = dir;
+    pass.followSurface = followSurface;
+    pass.sssWidth = sssWidth;
+    pass.distanceToProjectionWindow = distanceToProjectionWindow;
+    pass.kernel = &kernel.front();
+    pass.nSamples = nSamples;
+    return pass;
+}
+
+
+void SeparableSSSCPU::go(float *color,
+                         const float *depth,
+                         unsigned char *stencil,
+                         const float *strength,
+                         int id,
+                         const unsigned char *material,
+                         const float *velocity) {
+    SSSS_PROFILE("SSS CPU");
+
+    bool externalStencil = stencil != NULL;
+    if (!stencilInitialized && stencil == NULL)
+        stencil = &mask.front();
+
+    // Many materials are always processed in sparse mode:
+    if (atlas == NULL)
+        material = NULL;
+    bool useSparse = material != NULL || (sparse && !streaming && (externalStencil || !stencilInitialized));
+    bool usePyramid = pyramidLevels > 0 && material == NULL;
+    bool useTemporal = temporal.getPhaseCount() > 1 && material == NULL;
+    bool useCheckerboard = checkerboard && !useSparse && !usePyramid;
+    bool useAdaptive = !kernelSet.empty() && !useTemporal && !useSparse && !useCheckerboard;
+
+    if ((!streaming || useSparse || usePyramid || useCheckerboard || useAdaptive) && tmp.empty()) {
+        tmp.resize(PixelFormat::getSize(format) * width * height);
+        tmpClean = true;
+    }
+
+    // Setup the horizontal pass:
+    BlurPass x = setupPass(BlurPass::HORIZONTAL, depth, strength, id);
+    x.src = color;
+    x.dst = tmp.empty()? NULL : &tmp.front();
+    x.dstFormat = format;
+    if (stencilInitialized)
+        x.stencil = stencil;
+    else
+        x.initStencil = stencil;
+
+    // And the vertical one:
+    BlurPass y = setupPass(BlurPass::VERTICAL, depth, strength, id);
+    y.src = x.dst;
+    y.srcFormat = format;
+    y.dst = color;
+    y.stencil = stencil;
+
+    // With temporal amortization, both passes only run a subset of the taps:
+    if (useTemporal) {
+        TemporalFilter::subset(x.kernel, x.nSamples, temporal.getPhaseCount(), temporal.getPhase(), phaseKernel);
+        x.kernel = y.kernel = &phaseKernel.front();
+        x.nSamples = y.nSamples = int(phaseKernel.size());
+    }
+
+    if (usePyramid) {
+        goPyramid(x, y, color);
+    } else {
+        if (footprintPrepass && !useAdaptive) {
+            SSSS_PROFILE("Footprint");
+            footprint.build(x, tileWidth, tileHeight, pool);
+            x.footprint = footprint.getData();
+            y.footprint = footprint.getData();
+        }
+
+        if (useSparse)
+            goSparse(x, y, color, stencil, externalStencil && !stencilInitialized, material);
+        else if (useCheckerboard)
+            goCheckerboard(x, y, stencil);
+        else if (useAdaptive)
+            goAdaptive(x, y, stencil);
+        else if (streaming)
+            streamer.run(x, y, backend);
+        else
+            goDense(x, y, stencil);
+    }
+
+    if (useTemporal) {
+        SSSS_PROFILE("Temporal");
+        temporal.resolve(x, color, velocity, pool);
+    }
+}
+
+
+void SeparableSSSCPU::goCheckerboard(BlurPass &x, BlurPass &y, unsigned char *stencil) {
+    tmpClean = false;
+
+    // The vertical pass reads the whole output of the horizontal one, so the
+    // temporal render target must be cleared as usual:
+    fill(tmp.begin(), tmp.end(), (unsigned char) 0);
+    if (!stencilInitialized)
+        fill(stencil, stencil + width * height, (unsigned char) 0);
+
+    checkerboardFullCount = Checkerboard::run(x, checkerboardParity, checkerboardThreshold, backend, pool);
+    checkerboardFullCount += Checkerboard::run(y, checkerboardParity, checkerboardThreshold, backend, pool);
+
+    // Alternate the evaluated pixels every frame:
+    checkerboardParity ^= 1;
+}
+
+
+void SeparableSSSCPU::goAdaptive(BlurPass &x, BlurPass &y, unsigned char *stencil) {
+    tmpClean = false;
+
+    {
+        SSSS_PROFILE("Classification");
+        footprint.build(x, TileClassifier::TILE_SIZE, TileClassifier::TILE_SIZE, pool);
+        classifier.classify(footprint, kernelSet, kernelSteps, width, height);
+    }
+    x.footprint = footprint.getData();
+    y.footprint = footprint.getData();
+
+    fill(tmp.begin(), tmp.end(), (unsigned char) 0);
+    if (!stencilInitialized)
+        fill(stencil, stencil + width * height, (unsigned char) 0);
+
+    classifier.run(x, kernelSet, backend, pool);
+    classifier.run(y, kernelSet, backend, pool);
+}
+
+
+void SeparableSSSCPU::goDense(BlurPass &x, BlurPass &y, unsigned char *stencil) {
+    tmpClean = false;
+
+    if (transposed) {
+        x.dstTransposed = true;
+        y = transposePass(y);
+    }
+
+    if (pool != NULL) {
+        // The scheduler takes care of clearing the buffers tile by tile:
+        TileScheduler scheduler(pool, tileWidth, tileHeight);
+        scheduler.setFootprint(footprintPrepass? &footprint : NULL);
+        scheduler.run(x, y, backend);
+    } else {
+        // Clear the temporal render target:
+        fill(tmp.begin(), tmp.end(), (unsigned char) 0);
+
+        // Clear the stencil buffer if it was not available, and thus one must
+        // be initialized on the fly:
+        if (!stencilInitialized)
+            fill(stencil, stencil + width * height, (unsigned char) 0);
+
+        x.run(0, 0, width, height, backend);
+        y.run(0, 0, y.width, y.height, backend);
+    }
+}
+
+
+BlurPass SeparableSSSCPU::transposePass(const BlurPass &pass) {
+    BlurPass t = pass;
+    t.dir = BlurPass::HORIZONTAL;
+    t.width = height;
+    t.height = width;
+    t.dstTransposed = true;
+
+    transpose(pass.depth, depthT);
+    t.depth = &depthT.front();
+
+    if (pass.footprint != NULL) {
+        transpose(pass.footprint, footprintT);
+        t.footprint = &footprintT.front();
+    }
+
+    if (pass.strength != NULL) {
+        transpose(pass.strength, strengthT);
+        t.strength = &strengthT.front();
+    }
+
+    if (stencilInitialized) {
+        if (pass.stencil != NULL) {
+            transpose(pass.stencil, stencilT);
+            t.stencil = &stencilT.front();
+        }
+    } else {
+        // The stencil is not known until the horizontal pass has run. But it
+        // only marks the pixels with non-zero strength, so it can be built
+        // again by the vertical pass itself, in a scratch buffer:
+        stencilT.resize(width * height);
+        t.stencil = NULL;
+        t.initStencil = &stencilT.front();
+    }
+    return t;
+}
+
+
+template <class T>
+void SeparableSSSCPU::transpose(const T *src, vector<T> &dst, int channels) {
+    dst.resize(channels * width * height);
+    T *d = &dst.front();
+    if (pool == NULL) {
+        Transpose::run(src, d, width, height, channels, 0, 0, width, height);
+        return;
+    }
+
+    // Split in strips of columns, which go to separate rows of 'dst':
+    for (int x0 = 0; x0 < width; x0 += tileWidth) {
+        int x1 = min(x0 + tileWidth, width);
+        pool->submit([this, src, d, channels, x0, x1] {
+            Transpose::run(src, d, width, height, channels, x0, 0, x1, height);
+        });
+    }
+    pool->wait();
+}
+
+
+void SeparableSSSCPU::goSparse(BlurPass &x, BlurPass &y,
+                               const float *color,
+                               unsigned char *stencil,
+                               bool clearStencil,
+                               const unsigned char *material) {
+    // Build the list of pixels to process:
+    if (stencilInitialized) {
+        if (stencil != NULL)
+            spans.build(stencil, x.id, width, height);
+        else
+            spans.build(width, height);
+    } else {
+        if (x.strength != NULL)
+            spans.build(x.strength, 1, width, height);
+        else
+            spans.build(color + 3, 4, width, height);
+    }
+
+    // Each list of runs gets its own kernel. When there are many materials,
+    // the runs are binned by material, dropping the ones with no profile:
+    vector<const SpanList *> lists;
+    vector<BlurPass> xs, ys;
+    if (material != NULL) {
+        SpanList::split(spans, material, width, bins);
+        for (int m = 0; m < KernelAtlas::MAX_PROFILES; m++) {
+            if (!atlas->hasProfile(m) || bins[m].isEmpty())
+                continue;
+            lists.push_back(&bins[m]);
+            xs.push_back(x);
+            ys.push_back(y);
+            xs.back().kernel = ys.back().kernel = atlas->getKernel(m);
+            xs.back().nSamples = ys.back().nSamples = atlas->getSampleCount(m);
+        }
+    } else {
+        lists.push_back(&spans);
+        xs.push_back(x);
+        ys.push_back(y);
+    }
+
+    // Initialize the stencil, in case the caller wants it:
+    if (clearStencil) {
+        fill(stencil, stencil + width * height, (unsigned char) 0);
+        for (size_t l = 0; l < lists.size(); l++) {
+            const vector<SpanList::Span> &s = lists[l]->getSpans();
+            for (size_t i = 0; i < s.size(); i++)
+                fill(stencil + s[i].y * width + s[i].x0,
+                     stencil + s[i].y * width + s[i].x1, (unsigned char) x.id);
+        }
+    }
+
+    // The vertical pass expects zeros outside of the processed pixels. This
+    // only needs to be done if the buffer was used in dense mode:
+    if (!tmpClean) {
+        fill(tmp.begin(), tmp.end(), (unsigned char) 0);
+        tmpClean = true;
+    }
+
+    // The lists already take care of the stencil test. All the horizontal
+    // runs must be finished before the vertical ones start:
+    for (size_t l = 0; l < lists.size(); l++) {
+        xs[l].stencil = NULL;
+        xs[l].initStencil = NULL;
+        submitSpans(xs[l], *lists[l]);
+    }
+    if (pool != NULL)
+        pool->wait();
+    for (size_t l = 0; l < lists.size(); l++) {
+        ys[l].stencil = NULL;
+        submitSpans(ys[l], *lists[l]);
+    }
+    if (pool != NULL)
+        pool->wait();
+
+    // Leave the temporal buffer clean for the next frame:
+    const int size = PixelFormat::getSize(format);
+    for (size_t l = 0; l < lists.size(); l++) {
+        const vector<SpanList::Span> &s = lists[l]->getSpans();
+        for (size_t i = 0; i < s.size(); i++)
+            fill(tmp.begin() + size * (s[i].y * width + s[i].x0),
+                 tmp.begin() + size * (s[i].y * width + s[i].x1), (unsigned char) 0);
+    }
+}
+
+
+void SeparableSSSCPU::submitSpans(const BlurPass &pass, const SpanList &list) {
+    const vector<SpanList::Span> &s = list.getSpans();
+    if (pool == NULL) {
+        for (size_t i = 0; i < s.size(); i++)
+            pass.run(s[i].x0, s[i].y, s[i].x1, s[i].y + 1, backend);
+        return;
+    }
+
+    // Split the list in chunks of roughly the same number of pixels, a few
+    // per thread so that work stealing can balance them:
+    int chunkPixels = max(1024, list.getPixelCount() / (4 * pool->getThreadCount()));
+    size_t begin = 0;
+    while (begin < s.size()) {
+        size_t end = begin;
+        int pixels = 0;
+        while (end < s.size() && pixels < chunkPixels)
+            pixels += s[end].x1 - s[end].x0, end++;
+
+        const BlurPass *p = &pass;
+        BlurPass::Backend b = backend;
+        pool->submit([p, &s, begin, end, b] {
+            for (size_t i = begin; i < end; i++)
+                p->run(s[i].x0, s[i].y, s[i].x1, s[i].y + 1, b);
+        });
+        begin = end;
+    }
+}
+
+
+void SeparableSSSCPU::goPyramid(BlurPass &x, BlurPass &y, float *color) {
+    {
+        SSSS_PROFILE("Pyramid");
+        pyramid.build(x, pyramidLevels, maxTapSpacing, pool);
+    }
+
+    // The vertical pass expects zeros outside of the processed pixels:
+    if (!tmpClean) {
+        fill(tmp.begin(), tmp.end(), (unsigned char) 0);
+        tmpClean = true;
+    }
+
+    // Run both passes over each level, only where needed. The full
+    // resolution one writes into the final buffer directly:
+    for (int l = 0; l < pyramid.getLevelCount(); l++) {
+        Pyramid::Level &level = pyramid.getLevel(l);
+        BlurPass xl = x, yl = y;
+        xl.stencil = yl.stencil = NULL;
+        xl.initStencil = NULL;
+        if (l > 0) {
+            fill(level.tmp.begin(), level.tmp.end(), 0.0f);
+            xl.width = yl.width = level.width;
+            xl.height = yl.height = level.height;
+            xl.src = &level.color.front();
+            xl.dst = &level.tmp.front();
+            xl.dstFormat = PixelFormat::FORMAT_RGBA32F;
+            yl.src = xl.dst;
+            yl.srcFormat = PixelFormat::FORMAT_RGBA32F;
+            yl.dst = &level.result.front();
+            xl.depth = yl.depth = &level.depth.front();
+            if (separateStrengthSource)
+                xl.strength = yl.strength = &level.strength.front();
+        }
+
+        pyramidSpans[0].build(&level.reachStencil.front(), 1, level.width, level.height);
+        pyramidSpans[1].build(&level.blurStencil.front(), 1, level.width, level.height);
+        submitSpans(xl, pyramidSpans[0]);
+        if (pool != NULL)
+            pool->wait();
+        submitSpans(yl, pyramidSpans[1]);
+        if (pool != NULL)
+            pool->wait();
+
+        // Leave the temporal buffer clean for the next frame:
+        if (l == 0) {
+            const int size = PixelFormat::getSize(format);
+            const vector<SpanList::Span> &s = pyramidSpans[0].getSpans();
+            for (size_t i = 0; i < s.size(); i++)
+                fill(tmp.begin() + size * (s[i].y * width + s[i].x0),
+                     tmp.begin() + size * (s[i].y * width + s[i].x1), (unsigned char) 0);
+        }
+    }
+
+    pyramid.upsample(color, kernel[0], pool);
+}
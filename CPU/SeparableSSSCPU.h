@@ -0,0 +1,436 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef SSS_CPU_H
+#define SSS_CPU_H
+
+#include <vector>
+#include "Kernel.h"
+#include "KernelAtlas.h"
+#include "Profile.h"
+#include "BlurPass.h"
+#include "ThreadPool.h"
+#include "SpanList.h"
+#include "StreamingScheduler.h"
+#include "Footprint.h"
+#include "Pyramid.h"
+#include "TemporalFilter.h"
+#include "TileClassifier.h"
+
+/**
+ * CPU counterpart of 'SeparableSSS'. It runs the very same two passes of
+ * 'SSSSBlurPS' over images stored in memory, so that it can be used where
+ * no GPU is available, and as a golden reference for faster implementations.
+ */
+class SeparableSSSCPU {
+    public:
+        /**
+         * See 'SeparableSSS::SeparableSSS' for a description of the
+         * parameters; they have the same meaning over here. The 'format' of
+         * the temporal buffer defaults to full floats, instead of sRGB8, so
+         * that the results can be used as a reference. Smaller formats
+         * reduce the memory traffic of the vertical pass, which reads it (see
+         * 'PixelFormat').
+         */
+        SeparableSSSCPU(int width, int height,
+                        float fovy,
+                        float sssWidth,
+                        int nSamples=17,
+                        bool stencilInitialized=true,
+                        bool followSurface=true,
+                        bool separateStrengthSource=false,
+                        PixelFormat::Format format=PixelFormat::FORMAT_RGBA32F);
+
+        /**
+         * All buffers are row-major, 'width * height' pixels, with the top
+         * row first.
+         *
+         * color: RGBA linear color of the final rendered image. The filter
+         *     works in place. The SSS intensity should be stored in the alpha
+         *     channel.
+         *
+         * depth: linear depth of the scene, one float per pixel.
+         *
+         * stencil: one byte per pixel, with the same meaning as 'depthDSV'
+         *     in 'SeparableSSS::go':
+         *     a) if 'stencilInitialized' was set to 'true', then only the
+         *        pixels marked with the value 'id' will be processed. If it is
+         *        NULL, all the pixels are processed.
+         *     b) if 'stencilInitialized' was set to 'false', it gets cleared
+         *        and initialized on the fly. It can be NULL, in which case an
+         *        internal buffer is used.
+         *
+         * strength: if 'separateStrengthSource' was set to 'true' when
+         *     creating this object, the SSS strength will be fetched from this
+         *     buffer (one float per pixel) instead of from the alpha channel
+         *     of the color buffer.
+         *
+         * id: stencil value used to mark the pixels we must apply subsurface
+         *     scattering on.
+         *
+         * material: if not NULL, and a kernel atlas is set, one byte per
+         *     pixel with its material ID. Each pixel is then filtered with
+         *     the kernel of its profile in the atlas, and the ones with no
+         *     profile are not processed (see 'setKernelAtlas').
+         *
+         * velocity: if temporal amortization is enabled, two floats per
+         *     pixel with the motion from the previous frame, as stored in
+         *     'velocityRT' by the demo (see 'TemporalFilter::resolve'). NULL
+         *     stands for a static view.
+         */
+        void go(float *color,
+                const float *depth,
+                unsigned char *stencil,
+                const float *strength=NULL,
+                int id=1,
+                const unsigned char *material=NULL,
+                const float *velocity=NULL);
+
+        int getFrameWidth() const { return width; }
+        int getFrameHeight() const { return height; }
+        int getSampleCount() const { return nSamples; }
+        bool isFollowSurfaceEnabled() const { return followSurface; }
+        PixelFormat::Format getFormat() const { return format; }
+
+        void setWidth(float width) { this->sssWidth = width; }
+        float getWidth() const { return sssWidth; }
+
+        /**
+         * See @STRENGTH in 'SeparableSSS.h'.
+         */
+        void setStrength(const Vector3 &strength) { this->strength = strength; calculateKernel(); }
+        Vector3 getStrength() const { return strength; }
+
+        void setFalloff(const Vector3 &falloff) { this->falloff = falloff; customProfile = false; calculateKernel(); }
+        Vector3 getFalloff() const { return falloff; }
+
+        /**
+         * Uses an arbitrary profile (for example, one fitted to measured data
+         * by 'ProfileFitter') instead of the falloff one, until the next
+         * 'setFalloff' call.
+         */
+        void setProfile(const Profile &profile) { this->profile = profile; customProfile = true; calculateKernel(); }
+        bool hasCustomProfile() const { return customProfile; }
+        const Profile &getProfile() const { return profile; }
+
+        /**
+         * How the samples of the kernel are placed (see 'Kernel::Placement').
+         */
+        void setKernelPlacement(Kernel::Placement placement) { this->placement = placement; calculateKernel(); }
+        Kernel::Placement getKernelPlacement() const { return placement; }
+
+        /**
+         * Allows to use a custom kernel, with the same layout as the
+         * 'kernel' array of 'SeparableSSS.h' (the offset 0.0 must come
+         * first). It will be overwritten by the next 'setStrength' or
+         * 'setFalloff' call.
+         */
+        void setKernel(const std::vector<KernelSample> &kernel);
+        const std::vector<KernelSample> &getKernel() const { return kernel; }
+
+        /**
+         * Implementation of the inner loop. By default the fastest one
+         * supported by the running CPU is selected (see 'BlurPass::Backend').
+         */
+        void setBackend(BlurPass::Backend backend) { this->backend = BlurPass::resolve(backend); }
+        BlurPass::Backend getBackend() const { return backend; }
+
+        /**
+         * If a thread pool is set, both passes are split into tiles of the
+         * specified size and run in parallel (see 'TileScheduler'). The pool
+         * can be shared by many instances, but not used concurrently. Set it
+         * to NULL to go back to single-threaded processing.
+         */
+        void setThreadPool(ThreadPool *pool) { this->pool = pool; streamer = StreamingScheduler(pool); }
+        ThreadPool *getThreadPool() const { return pool; }
+
+        void setTileSize(int tileWidth, int tileHeight) { this->tileWidth = tileWidth; this->tileHeight = tileHeight; }
+        int getTileWidth() const { return tileWidth; }
+        int getTileHeight() const { return tileHeight; }
+
+        /**
+         * In sparse mode, a list with the runs of pixels that need processing
+         * is built first (from the stencil, or from the strength when the
+         * stencil is initialized on the fly), and then both passes only visit
+         * these runs (see 'SpanList'). The temporal buffer is also cleared
+         * only where it was written. Recommended when skin covers a small
+         * part of the frame.
+         *
+         * Sparse mode requires a stencil if 'stencilInitialized' is 'true'.
+         */
+        void setSparse(bool sparse) { this->sparse = sparse; }
+        bool isSparse() const { return sparse; }
+        const SpanList &getSpanList() const { return spans; }
+
+        /**
+         * In streaming mode, both passes are run in a single sweep over the
+         * frame, and the full size temporal render target is replaced by a
+         * ring of rows sized to the reach of the kernel (see
+         * 'StreamingScheduler'). Recommended for big resolutions, where the
+         * temporal buffer would not fit in cache. Sparse mode is ignored
+         * while streaming.
+         */
+        void setStreaming(bool streaming);
+        bool isStreaming() const { return streaming; }
+        const StreamingScheduler &getStreamingScheduler() const { return streamer; }
+
+        /**
+         * When enabled, the horizontal pass writes its output transposed, and
+         * the vertical pass is run as a horizontal one over it (and over
+         * transposed copies of the depth, strength and stencil, made at the
+         * start of each frame). This way its taps read along rows instead of
+         * jumping a full row each, which makes the vertical pass as fast as
+         * the horizontal one. The price is paid in the writes, which are
+         * scattered over the columns of the output (see
+         * 'Benchmark::passes'), so whether it pays off depends on the
+         * memory subsystem. It's not used in sparse and streaming modes.
+         */
+        void setTransposed(bool transposed) { this->transposed = transposed; }
+        bool isTransposed() const { return transposed; }
+
+        /**
+         * When enabled, the step of each pixel is calculated once
+         * per frame, in a prepass, and then shared by both passes (see
+         * 'Footprint'). The tiled scheduler also uses it to find the reach of
+         * each tile without visiting its pixels.
+         */
+        void setFootprintPrepass(bool enabled) { footprintPrepass = enabled; }
+        bool isFootprintPrepassEnabled() const { return footprintPrepass; }
+        const Footprint &getFootprint() const { return footprint; }
+
+        /**
+         * Kernels for frames that mix many materials (see 'KernelAtlas').
+         * When a material ID buffer is passed to 'go', the runs of pixels to
+         * process are binned by material, and each bin runs the inner loop
+         * with its own kernel, so there's no need to call 'go' once per
+         * material. This is always done in sparse mode (whatever the sparse,
+         * streaming and transposed settings are); if 'stencilInitialized' is
+         * 'true' but no stencil is given, all the pixels with a profile are
+         * processed.
+         *
+         * The atlas is not copied, and must be kept alive while set.
+         */
+        void setKernelAtlas(const KernelAtlas *atlas) { this->atlas = atlas; }
+        const KernelAtlas *getKernelAtlas() const { return atlas; }
+
+        /**
+         * Multi-resolution mode, for wide kernels: each pixel is blurred in
+         * the finest of the full resolution frame and 'nLevels' half and
+         * quarter resolution copies of it where the largest gap between its
+         * taps is at most 'maxTapSpacing' pixels (or in the coarsest one),
+         * and the results are upsampled taking depth into account (see
+         * 'Pyramid'). Pixels kept at full resolution get the same results as
+         * without this mode; the others lose some accuracy, but their cost
+         * stays roughly constant instead of growing with their footprint.
+         * Zero levels disables it.
+         *
+         * The largest gap is the one of the outermost taps, so most skin
+         * leaves full resolution well before its kernel is wide: at 1080p,
+         * with 17 samples and the default spacing, a head at depth one is
+         * only kept there below a width of about 0.001.
+         *
+         * Like sparse mode, only the pixels that need processing are visited.
+         * It takes precedence over the sparse, streaming and transposed
+         * modes, and it's not used with many materials.
+         */
+        void setPyramid(int nLevels, float maxTapSpacing=2.0f) { pyramidLevels = nLevels; this->maxTapSpacing = maxTapSpacing; }
+        int getPyramidLevels() const { return pyramidLevels; }
+        float getMaxTapSpacing() const { return maxTapSpacing; }
+        const Pyramid &getPyramid() const { return pyramid; }
+
+        /**
+         * Temporal amortization: the taps of the kernel are spread over
+         * 'nPhases' consecutive frames, and the results of the previous
+         * frames are reprojected with the velocities passed to 'go' and
+         * averaged with the current one (see 'TemporalFilter'). With two
+         * phases, each frame runs about half of the taps. Where the history
+         * gets rejected the result is noisier, as only the taps of the
+         * current frame are used. One phase disables it.
+         *
+         * It can be combined with the other modes, except with many
+         * materials. The history should be reset with 'resetHistory' on
+         * camera cuts, or when the parameters of the blur change.
+         */
+        void setTemporal(int nPhases, float depthTolerance=0.02f) { temporal.setPhaseCount(nPhases); temporal.setDepthTolerance(depthTolerance); }
+        int getTemporalPhases() const { return temporal.getPhaseCount(); }
+        void resetHistory() { temporal.reset(); }
+        const TemporalFilter &getTemporalFilter() const { return temporal; }
+
+        /**
+         * Checkerboard mode: each pass is evaluated on half of the pixels,
+         * and the other half is reconstructed from them taking depth and
+         * strength into account (see 'Checkerboard'). The evaluated half
+         * alternates every frame, so that a temporal filter (like SMAA T2X,
+         * or the temporal amortization above) can blend both.
+         *
+         * Pixels whose neighbours differ more than 'maxResidualDifference'
+         * (in linear color, see 'Checkerboard::run') are evaluated in full,
+         * which keeps the error of each channel within about twice that
+         * value (both passes add up). The more of them, the smaller the
+         * savings: the SIMD backends evaluate groups of neighbouring pixels
+         * at once, so scattered pixels cost almost as much as a whole half
+         * pass, and on noisy skin the mode can end up slower than the
+         * regular one (see 'Benchmark::checkerboard'). An infinite value
+         * disables the test.
+         *
+         * It's used instead of the streaming and transposed modes, but it's
+         * ignored in sparse mode, with many materials, and in multi-resolution
+         * mode.
+         */
+        void setCheckerboard(bool enabled, float maxResidualDifference=0.01f) { checkerboard = enabled; checkerboardThreshold = maxResidualDifference; }
+        bool isCheckerboardEnabled() const { return checkerboard; }
+        float getCheckerboardThreshold() const { return checkerboardThreshold; }
+
+        /**
+         * Pixels evaluated in full by the last frame in checkerboard mode,
+         * adding up both passes.
+         */
+        int getCheckerboardFullCount() const { return checkerboardFullCount; }
+
+        /**
+         * Adaptive sampling: the frame is split into tiles, which are
+         * classified by their largest footprint, and each tile is blurred
+         * with the smallest kernel of a set (calculated with the current
+         * parameters, up to 'nSamples' samples) whose taps are at most
+         * 'maxTapSpacing' pixels apart on average (see 'TileClassifier').
+         * Distant heads then take only a few taps per pixel, while close-ups
+         * still get the full kernel.
+         *
+         * It's used instead of the streaming and transposed modes, but it's
+         * ignored in sparse, checkerboard and multi-resolution modes, with
+         * many materials, with temporal amortization, and with custom
+         * kernels (see 'setKernel').
+         */
+        void setAdaptiveSampling(bool enabled, float maxTapSpacing=1.0f);
+        bool isAdaptiveSamplingEnabled() const { return adaptiveSampling; }
+        float getAdaptiveTapSpacing() const { return adaptiveTapSpacing; }
+        const TileClassifier &getTileClassifier() const { return classifier; }
+
+        /**
+         * Tap merging: neighboring taps of the kernel are merged into single
+         * bilinear fetches where the weights of the three channels allow it
+         * (see 'Kernel::merge'). A merged tap is only exact where both taps
+         * fall between the same two pixels, so the kernel is merged tile by
+         * tile, the same way as adaptive sampling picks its kernels (see
+         * 'TileClassifier'): each tile gets the version of the kernel that
+         * merges the most taps whose offsets, times the largest footprint
+         * of the tile, are at most one pixel apart. Close-ups keep the full
+         * kernel, while distant heads get a third to almost half fewer
+         * fetches with kernels of 17 samples and up (see
+         * 'Benchmark::merging').
+         *
+         * It's used in the same cases as adaptive sampling, custom kernels
+         * included, and combined with it; 'getKernel' still returns the
+         * original kernel.
+         */
+        void setTapMerging(bool enabled, float maxError=0.002f);
+        bool isTapMergingEnabled() const { return tapMerging; }
+
+        /**
+         * Kernels tiles can be classified into, by adaptive sampling and tap
+         * merging, sorted by cost; the last one is the full kernel. It's
+         * empty when neither is enabled.
+         */
+        const std::vector<std::vector<KernelSample> > &getKernelSet() const { return kernelSet; }
+
+    private:
+        void calculateKernel();
+        void buildKernelSet();
+        BlurPass setupPass(BlurPass::Direction dir,
+                           const float *depth,
+                           const float *strength,
+                           int id) const;
+        void goSparse(BlurPass &x, BlurPass &y, const float *color, unsigned char *stencil, bool clearStencil, const unsigned char *material);
+        void goPyramid(BlurPass &x, BlurPass &y, float *color);
+        void goCheckerboard(BlurPass &x, BlurPass &y, unsigned char *stencil);
+        void goAdaptive(BlurPass &x, BlurPass &y, unsigned char *stencil);
+        void goDense(BlurPass &x, BlurPass &y, unsigned char *stencil);
+        void submitSpans(const BlurPass &pass, const SpanList &list);
+        BlurPass transposePass(const BlurPass &pass);
+        template <class T> void transpose(const T *src, std::vector<T> &dst, int channels=1);
+
+        int width, height;
+        float distanceToProjectionWindow;
+        float sssWidth;
+        int nSamples;
+        bool stencilInitialized;
+        bool followSurface;
+        bool separateStrengthSource;
+        PixelFormat::Format format;
+        Vector3 strength;
+        Vector3 falloff;
+        Profile profile;
+        bool customProfile;
+        Kernel::Placement placement;
+        BlurPass::Backend backend;
+        ThreadPool *pool;
+        int tileWidth, tileHeight;
+        bool sparse;
+        bool streaming;
+        bool transposed;
+        bool footprintPrepass;
+        const KernelAtlas *atlas;
+        int pyramidLevels;
+        float maxTapSpacing;
+        bool checkerboard;
+        int checkerboardParity;
+        float checkerboardThreshold;
+        int checkerboardFullCount;
+        bool adaptiveSampling;
+        float adaptiveTapSpacing;
+        bool tapMerging;
+        float tapMergingError;
+        bool tmpClean;
+
+        std::vector<KernelSample> kernel;
+        std::vector<unsigned char> tmp;
+        std::vector<unsigned char> mask;
+        std::vector<float> depthT, strengthT, footprintT;
+        std::vector<unsigned char> stencilT;
+        SpanList spans;
+        std::vector<SpanList> bins;
+        StreamingScheduler streamer;
+        Footprint footprint;
+        Pyramid pyramid;
+        SpanList pyramidSpans[2];
+        TemporalFilter temporal;
+        std::vector<KernelSample> phaseKernel;
+        std::vector<std::vector<KernelSample> > smallerKernels, kernelSet;
+        std::vector<float> kernelSteps;
+        TileClassifier classifier;
+};
+
+#endif
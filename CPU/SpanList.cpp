@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include "SpanList.h"
+using namespace std;
+
+
+void SpanList::build(const unsigned char *stencil, int id, int width, int height) {
+    spans.clear();
+    pixelCount = 0;
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char *row = stencil + y * width;
+        int x = 0;
+        while (x < width) {
+            // Skip the pixels that are not marked:
+            while (x < width && row[x] != id) x++;
+            if (x == width) break;
+
+            // And find where the run ends:
+            Span span = { y, x, x };
+            while (x < width && row[x] == id) x++;
+            span.x1 = x;
+
+            spans.push_back(span);
+            pixelCount += span.x1 - span.x0;
+        }
+    }
+}
+
+
+void SpanList::build(const float *strength, int stride, int width, int height) {
+    spans.clear();
+    pixelCount = 0;
+
+    for (int y = 0; y < height; y++) {
+        const float *row = strength + y * width * stride;
+        int x = 0;
+        while (x < width) {
+            while (x < width && row[x * stride] == 0.0f) x++;
+            if (x == width) break;
+
+            Span span = { y, x, x };
+            while (x < width && row[x * stride] != 0.0f) x++;
+            span.x1 = x;
+
+            spans.push_back(span);
+            pixelCount += span.x1 - span.x0;
+        }
+    }
+}
+
+
+void SpanList::build(int width, int height) {
+    clear();
+    for (int y = 0; y < height; y++) {
+        Span span = { y, 0, width };
+        add(span);
+    }
+}
+
+
+void SpanList::split(const SpanList &spans,
+                     const unsigned char *material,
+                     int width,
+                     vector<SpanList> &bins) {
+    bins.resize(256);
+    for (size_t i = 0; i < bins.size(); i++)
+        bins[i].clear();
+
+    const vector<Span> &s = spans.getSpans();
+    for (size_t i = 0; i < s.size(); i++) {
+        const unsigned char *row = material + s[i].y * width;
+        int x = s[i].x0;
+        while (x < s[i].x1) {
+            // Find where the run of this material ends:
+            Span span = { s[i].y, x, x };
+            unsigned char m = row[x];
+            while (x < s[i].x1 && row[x] == m) x++;
+            span.x1 = x;
+
+            bins[m].add(span);
+        }
+    }
+}
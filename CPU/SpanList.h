@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef SPANLIST_H
+#define SPANLIST_H
+
+#include <vector>
+
+/**
+ * Compact list of the runs of pixels that need SSS processing, in row order.
+ * Skin usually covers a small fraction of the frame, so running the passes
+ * only over these runs makes their cost proportional to the number of skin
+ * pixels, instead of to the resolution.
+ */
+class SpanList {
+    public:
+        struct Span {
+            int y;
+            int x0, x1; // [x0, x1)
+        };
+
+        SpanList() : pixelCount(0) {}
+
+        /**
+         * Builds the list from the pixels marked with 'id' in 'stencil'.
+         */
+        void build(const unsigned char *stencil, int id, int width, int height);
+
+        /**
+         * Builds the list from the pixels with non-zero strength. 'stride' is
+         * the distance, in floats, between the strengths of two consecutive
+         * pixels (4 when using the alpha channel of an RGBA buffer).
+         */
+        void build(const float *strength, int stride, int width, int height);
+
+        /**
+         * Builds the list with all the pixels, one run per row.
+         */
+        void build(int width, int height);
+
+        /**
+         * Splits the runs of 'spans' by the material of their pixels, given
+         * by 'material' (one byte per pixel): 'bins[m]' gets the runs of
+         * material 'm', still in row order. 'bins' is resized to 256 lists.
+         */
+        static void split(const SpanList &spans,
+                          const unsigned char *material,
+                          int width,
+                          std::vector<SpanList> &bins);
+
+        const std::vector<Span> &getSpans() const { return spans; }
+        int getPixelCount() const { return pixelCount; }
+        bool isEmpty() const { return spans.empty(); }
+
+    private:
+        void clear() { spans.clear(); pixelCount = 0; }
+        void add(const Span &span) { spans.push_back(span); pixelCount += span.x1 - span.x0; }
+
+        std::vector<Span> spans;
+        int pixelCount;
+};
+
+#endif
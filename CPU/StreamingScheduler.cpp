@@ -0,0 +1,162 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include "StreamingScheduler.h"
+using namespace std;
+
+
+StreamingScheduler::StreamingScheduler(ThreadPool *pool) :
+        pool(pool), backend(BlurPass::BACKEND_AUTO), reach(0), ringRows(0), rowSize(0) {}
+
+
+void StreamingScheduler::run(const BlurPass &x, const BlurPass &y, BlurPass::Backend backend) {
+    this->x = x;
+    this->y = y;
+    this->backend = BlurPass::resolve(backend);
+    const int width = x.width, height = x.height;
+
+    // Find how far the vertical taps can reach. The strength of the vertical
+    // pass is the alpha written by the horizontal one, which is not available
+    // yet, so it's taken from the input of the horizontal pass instead (they
+    // are the same for all the pixels that get processed):
+    BlurPass probe = y;
+    probe.src = x.src;
+    probe.srcFormat = x.srcFormat;
+    probe.srcRows = 0;
+    probe.initStencil = x.initStencil;
+    reach = probe.reach(0, 0, width, height);
+
+    // The ring must hold the 2 * reach + 1 rows around the current one:
+    int rows = min(2 * reach + 1, height);
+    ringRows = 1;
+    while (ringRows < rows)
+        ringRows *= 2;
+
+    // Split the frame into bands, none of them shorter than the ring:
+    int nBands = 1;
+    if (pool != NULL && ringRows < height)
+        nBands = max(1, min(pool->getThreadCount(), height / rows));
+    bands.resize(nBands + 1);
+    for (int band = 0; band <= nBands; band++)
+        bands[band] = int((long long) band * height / nBands);
+
+    rowSize = PixelFormat::getSize(x.dstFormat) * size_t(width);
+    rings.resize(nBands);
+    for (int band = 0; band < nBands; band++)
+        rings[band].resize(ringRows * rowSize);
+
+    // Find the rows that are read by more than one band:
+    edgeIndex.assign(height, -1);
+    int nEdges = 0;
+    for (int band = 1; band < nBands; band++)
+        for (int j = max(0, bands[band] - reach); j < min(height, bands[band] + reach); j++)
+            if (edgeIndex[j] < 0)
+                edgeIndex[j] = nEdges++;
+    edges.resize(nEdges * rowSize);
+
+    if (nBands == 1) {
+        runBand(0);
+    } else {
+        for (int band = 0; band < nBands; band++)
+            pool->submit([this, band] { runEdges(band); });
+        pool->wait();
+        for (int band = 0; band < nBands; band++)
+            pool->submit([this, band] { runBand(band); });
+        pool->wait();
+    }
+}
+
+
+size_t StreamingScheduler::getBufferSize() const {
+    size_t size = edges.size();
+    for (size_t i = 0; i < rings.size(); i++)
+        size += rings[i].size();
+    return size;
+}
+
+
+void StreamingScheduler::horizontal(int band, int row) {
+    const int width = x.width;
+
+    BlurPass pass = x;
+    pass.dst = &rings[band].front();
+    pass.dstRows = ringRows;
+
+    // Clear the row in the ring (and in the stencil) before running the pass:
+    memset(&rings[band][(row & (ringRows - 1)) * rowSize], 0, rowSize);
+    if (pass.initStencil != NULL)
+        memset(pass.initStencil + row * width, 0, width);
+
+    pass.run(0, row, width, row + 1, backend);
+}
+
+
+void StreamingScheduler::runEdges(int band) {
+    for (int j = bands[band]; j < bands[band + 1]; j++) {
+        if (edgeIndex[j] >= 0) {
+            horizontal(band, j);
+            memcpy(&edges[edgeIndex[j] * rowSize],
+                   &rings[band][(j & (ringRows - 1)) * rowSize],
+                   rowSize);
+        }
+    }
+}
+
+
+void StreamingScheduler::runBand(int band) {
+    const int width = x.width, height = x.height;
+
+    BlurPass pass = y;
+    pass.src = &rings[band].front();
+    pass.srcRows = ringRows;
+
+    int next = max(0, bands[band] - reach);
+    for (int j = bands[band]; j < bands[band + 1]; j++) {
+        // Bring into the ring all the rows the taps of this one can reach:
+        for (int last = min(height - 1, j + reach); next <= last; next++) {
+            if (edgeIndex[next] >= 0)
+                memcpy(&rings[band][(next & (ringRows - 1)) * rowSize],
+                       &edges[edgeIndex[next] * rowSize],
+                       rowSize);
+            else
+                horizontal(band, next);
+        }
+
+        pass.run(0, j, width, j + 1, backend);
+    }
+}
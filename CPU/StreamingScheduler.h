@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef STREAMINGSCHEDULER_H
+#define STREAMINGSCHEDULER_H
+
+#include <vector>
+#include "BlurPass.h"
+#include "ThreadPool.h"
+
+/**
+ * Runs both passes in a single sweep from top to bottom, without a full size
+ * temporal render target: the horizontal pass writes into a ring buffer of
+ * rows, just big enough for the vertical taps to reach (see
+ * 'BlurPass::srcRows'), and each row of the vertical pass is run as soon as
+ * all the rows it can read from are available. Peak memory is thus
+ * O(width * kernel rows), and the rows are still in cache when read back.
+ *
+ * The size of the ring is found by first scanning the depth and strength of
+ * the whole frame for the longest vertical step (see 'BlurPass::reach').
+ *
+ * With a thread pool, the frame is split into one band of rows per thread,
+ * each one streamed with its own ring. As the vertical pass works in place,
+ * the horizontal pass of the rows near the boundaries between bands (which
+ * are needed by both neighbours) is run first for all of them, and kept
+ * aside until the bands are streamed.
+ */
+class StreamingScheduler {
+    public:
+        /**
+         * 'pool' may be NULL, to run on the calling thread.
+         */
+        StreamingScheduler(ThreadPool *pool);
+
+        /**
+         * 'x.dst' and 'y.src' are ignored, as the scheduler provides its own
+         * buffers, stored in 'x.dstFormat' (which must match 'y.srcFormat').
+         * 'y.dst' must be the buffer 'x' reads from (the filter works in
+         * place).
+         */
+        void run(const BlurPass &x, const BlurPass &y, BlurPass::Backend backend);
+
+        /**
+         * Number of rows of the last ring buffer used, per band.
+         */
+        int getRingRows() const { return ringRows; }
+
+        /**
+         * Size in bytes of the buffers used by the last run, which replace the
+         * full size temporal render target.
+         */
+        size_t getBufferSize() const;
+
+    private:
+        void runEdges(int band);
+        void runBand(int band);
+        void horizontal(int band, int row);
+
+        ThreadPool *pool;
+
+        BlurPass x, y;
+        BlurPass::Backend backend;
+        int reach;
+        int ringRows;
+        size_t rowSize;
+        std::vector<int> bands;
+        std::vector<std::vector<unsigned char> > rings;
+
+        /**
+         * Result of the horizontal pass for the rows near the boundaries
+         * between bands. 'edgeIndex' maps each row of the frame to its
+         * position in 'edges', or -1.
+         */
+        std::vector<unsigned char> edges;
+        std::vector<int> edgeIndex;
+};
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "TemporalFilter.h"
+using namespace std;
+
+
+static const int BAND_HEIGHT = 64;
+
+
+void TemporalFilter::setPhaseCount(int nPhases) {
+    this->nPhases = max(nPhases, 1);
+    history.resize(this->nPhases - 1);
+    next.resize(this->nPhases - 1);
+    reset();
+}
+
+
+void TemporalFilter::subset(const KernelSample *kernel, int nSamples,
+                            int nPhases, int phase,
+                            vector<KernelSample> &subset) {
+    subset.assign(kernel, kernel + 1);
+
+    // Sort the taps by distance to the center:
+    vector<pair<float, int> > taps;
+    for (int k = 1; k < nSamples; k++)
+        taps.push_back(make_pair(abs(kernel[k].offset), k));
+    sort(taps.begin(), taps.end());
+
+    // And take every 'nPhases'-th distance. Offsets at both sides may not
+    // be exactly opposite, as they are calculated separately, so distances
+    // that are very close are taken as the same:
+    int group = -1;
+    float last = -1.0f;
+    for (size_t t = 0; t < taps.size(); t++) {
+        if (taps[t].first - last > 1e-4f * taps[t].first) {
+            group++;
+            last = taps[t].first;
+        }
+        if (group % nPhases == phase) {
+            KernelSample s = kernel[taps[t].second];
+            s.r *= float(nPhases);
+            s.g *= float(nPhases);
+            s.b *= float(nPhases);
+            subset.push_back(s);
+        }
+    }
+}
+
+
+void TemporalFilter::resolve(const BlurPass &pass, float *color, const float *velocity, ThreadPool *pool) {
+    if (pass.width != width || pass.height != height) {
+        width = pass.width;
+        height = pass.height;
+        nHistory = 0;
+    }
+    for (int b = 0; b < nPhases - 1; b++) {
+        history[b].resize(4 * width * height);
+        next[b].resize(4 * width * height);
+    }
+    prevDepth.resize(width * height);
+
+    const int nBands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    vector<int> rejected(nBands, 0);
+    for (int band = 0; band < nBands; band++) {
+        int y0 = band * BAND_HEIGHT, y1 = min(y0 + BAND_HEIGHT, height);
+        int *r = &rejected[band];
+        if (pool != NULL)
+            pool->submit([this, &pass, color, velocity, y0, y1, r] { resolveRows(pass, color, velocity, y0, y1, r); });
+        else
+            resolveRows(pass, color, velocity, y0, y1, r);
+    }
+    if (pool != NULL)
+        pool->wait();
+
+    rejectedCount = 0;
+    for (int band = 0; band < nBands; band++)
+        rejectedCount += rejected[band];
+
+    history.swap(next);
+    nHistory = min(nHistory + 1, nPhases - 1);
+    copy(pass.depth, pass.depth + width * height, prevDepth.begin());
+    phase = (phase + 1) % nPhases;
+}
+
+
+void TemporalFilter::resolveRows(const BlurPass &pass, float *color, const float *velocity, int y0, int y1, int *rejected) {
+    const int nBuffers = nPhases - 1;
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < width; x++) {
+            const int i = y * width + x;
+            float *c = color + 4 * i;
+            float s = pass.strength != NULL? pass.strength[i] : c[3];
+
+            // Same stencil test as 'BlurPass::run':
+            bool active;
+            if (pass.initStencil != NULL)
+                active = s != 0.0f;
+            else
+                active = pass.stencil == NULL || pass.stencil[i] == pass.id;
+
+            if (!active) {
+                for (int b = 0; b < nBuffers; b++)
+                    next[b][4 * i + 3] = 0.0f;
+                continue;
+            }
+
+            // Position of the pixel in the previous frame, and the weights of
+            // the (up to) four pixels around it that are on the same surface:
+            float px = float(x), py = float(y);
+            if (velocity != NULL) {
+                px -= velocity[2 * i] * float(width);
+                py -= velocity[2 * i + 1] * float(height);
+            }
+            float fx = floor(px), fy = floor(py);
+            int ix = int(fx), iy = int(fy);
+            float wx = px - fx, wy = py - fy;
+
+            int taps[4];
+            float weights[4];
+            int nTaps = 0;
+            if (nHistory > 0) {
+                const float d = pass.depth[i];
+                for (int t = 0; t < 4; t++) {
+                    int tx = ix + (t & 1), ty = iy + (t >> 1);
+                    if (tx < 0 || tx >= width || ty < 0 || ty >= height)
+                        continue;
+                    int j = ty * width + tx;
+                    float w = ((t & 1)? wx : 1.0f - wx) * ((t >> 1)? wy : 1.0f - wy);
+                    if (w > 0.0f && abs(prevDepth[j] - d) <= depthTolerance * d) {
+                        taps[nTaps] = j;
+                        weights[nTaps] = w;
+                        nTaps++;
+                    }
+                }
+            }
+
+            // Average the current estimate with the valid history, which is
+            // kept reprojected for the next frame:
+            float r = c[0], g = c[1], bl = c[2];
+            int count = 1;
+            for (int b = 0; b < nBuffers; b++) {
+                float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                if (b < nHistory) {
+                    const float *h = &history[b].front();
+                    for (int t = 0; t < nTaps; t++) {
+                        const float *p = h + 4 * taps[t];
+                        float w = weights[t] * p[3];
+                        sum[0] += w * p[0];
+                        sum[1] += w * p[1];
+                        sum[2] += w * p[2];
+                        sum[3] += w;
+                    }
+                }
+
+                if (sum[3] > 0.0f) {
+                    float inv = 1.0f / sum[3];
+                    sum[0] *= inv;
+                    sum[1] *= inv;
+                    sum[2] *= inv;
+                    r += sum[0];
+                    g += sum[1];
+                    bl += sum[2];
+                    count++;
+                }
+
+                // The last buffer is dropped, and the current estimate goes
+                // first:
+                float *n = &next[b].front() + 4 * i;
+                if (b == 0) {
+                    n[0] = c[0];
+                    n[1] = c[1];
+                    n[2] = c[2];
+                    n[3] = 1.0f;
+                }
+                if (b + 1 < nBuffers) {
+                    float *m = &next[b + 1].front() + 4 * i;
+                    m[0] = sum[0];
+                    m[1] = sum[1];
+                    m[2] = sum[2];
+                    m[3] = sum[3] > 0.0f? 1.0f : 0.0f;
+                }
+            }
+
+            if (count == 1) {
+                (*rejected)++;
+                continue;
+            }
+            float inv = 1.0f / float(count);
+            c[0] = r * inv;
+            c[1] = g * inv;
+            c[2] = bl * inv;
+        }
+    }
+}
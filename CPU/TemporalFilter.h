@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef TEMPORALFILTER_H
+#define TEMPORALFILTER_H
+
+#include <vector>
+#include "BlurPass.h"
+#include "ThreadPool.h"
+
+/**
+ * Temporal amortization of the blur (see 'SeparableSSSCPU::setTemporal').
+ *
+ * The taps of the kernel are split into 'nPhases' subsets, by their distance
+ * to the center: the pairs of taps at the same distance on both sides stay
+ * together, so that every subset is still symmetric and the image does not
+ * shift from frame to frame. Each frame runs the center tap plus one of the
+ * subsets, with its weights multiplied by 'nPhases', and the subsets are
+ * rotated every frame. The result of each frame is thus an unbiased, but
+ * noisier, estimate of the full kernel.
+ *
+ * The estimates of the last 'nPhases - 1' frames are kept, reprojected into
+ * the current frame through the velocity buffer, and averaged with the
+ * current one. This is the same reprojection done by 'SMAAResolvePS' for
+ * SMAA T2X, using the same velocities. History is rejected where the depth
+ * of the previous frame is too different from the current one
+ * (disocclusions, silhouettes), where only the current estimate is used.
+ *
+ * For a static view the average covers every tap of the kernel once in the
+ * horizontal pass, and once in the vertical one. As both passes use the same
+ * subset, the combinations of taps of different subsets are missing, but
+ * they are close to the ones of the same subset, as the subsets interleave.
+ */
+class TemporalFilter {
+    public:
+        TemporalFilter() : nPhases(1), phase(0), depthTolerance(0.02f),
+                           width(0), height(0), nHistory(0), rejectedCount(0) {}
+
+        /**
+         * Number of frames over which the taps are spread. One disables the
+         * amortization. Changing it discards the history.
+         */
+        void setPhaseCount(int nPhases);
+        int getPhaseCount() const { return nPhases; }
+
+        /**
+         * Subset of taps to use in the current frame.
+         */
+        int getPhase() const { return phase; }
+
+        /**
+         * The history of a pixel is rejected if the depth of the previous
+         * frame, at its reprojected position, differs from its current depth
+         * more than 'depthTolerance' times the latter.
+         */
+        void setDepthTolerance(float depthTolerance) { this->depthTolerance = depthTolerance; }
+        float getDepthTolerance() const { return depthTolerance; }
+
+        /**
+         * Builds in 'subset' the kernel of 'phase' out of the full 'kernel'
+         * (the center tap comes first, as usual).
+         */
+        static void subset(const KernelSample *kernel, int nSamples,
+                           int nPhases, int phase,
+                           std::vector<KernelSample> &subset);
+
+        /**
+         * Averages the result of the current frame, in 'color', with the
+         * reprojected history, and rotates the history and the phase.
+         * 'pass' is used for telling the pixels that got processed (with
+         * the same stencil test as the passes), and for its depth.
+         *
+         * velocity: two floats per pixel, laid out as 'velocityRT' in the
+         *     demo: the motion of the pixel from the previous frame to the
+         *     current one, in texcoord units (with the y axis going down).
+         *     If NULL, the view is taken as static.
+         */
+        void resolve(const BlurPass &pass, float *color, const float *velocity, ThreadPool *pool=NULL);
+
+        /**
+         * Discards the history, for example on camera cuts or when the
+         * parameters of the blur change.
+         */
+        void reset() { nHistory = 0; phase = 0; }
+
+        /**
+         * Processed pixels of the last frame that had no valid history (all
+         * of them, on the first frame after a reset).
+         */
+        int getRejectedCount() const { return rejectedCount; }
+
+    private:
+        void resolveRows(const BlurPass &pass, float *color, const float *velocity, int y0, int y1, int *rejected);
+
+        int nPhases, phase;
+        float depthTolerance;
+        int width, height;
+        int nHistory; // Valid buffers in 'history'
+
+        /**
+         * 'history[0]' holds the estimate of the previous frame, 'history[1]'
+         * the one of the frame before, reprojected into the previous frame,
+         * and so on. They are RGBA, with the alpha channel set to one where
+         * the history is valid and to zero elsewhere. 'next' gets the new
+         * history while resolving.
+         */
+        std::vector<std::vector<float> > history, next;
+        std::vector<float> prevDepth;
+        int rejectedCount;
+};
+
+#endif
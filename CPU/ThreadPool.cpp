@@ -0,0 +1,167 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include "ThreadPool.h"
+using namespace std;
+
+
+/**
+ * Allows tasks to know which worker (and pool) they are running on.
+ */
+static thread_local ThreadPool *currentPool = NULL;
+static thread_local int currentIndex = -1;
+
+
+ThreadPool::ThreadPool(int nThreads) : queued(0), pending(0), next(0), stop(false) {
+    if (nThreads <= 0)
+        nThreads = max(1, int(thread::hardware_concurrency()));
+
+    // Queue 0 belongs to the thread calling 'wait':
+    for (int i = 0; i < nThreads; i++)
+        queues.push_back(new Queue());
+    for (int i = 1; i < nThreads; i++)
+        threads.push_back(thread(&ThreadPool::work, this, i));
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stop = true;
+    }
+    wakeUp.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    for (size_t i = 0; i < queues.size(); i++)
+        delete queues[i];
+}
+
+
+void ThreadPool::submit(const Task &task) {
+    int n = int(queues.size());
+    // The round robin counter is unsigned, so that it wraps around without
+    // ever giving a negative index:
+    int index = currentPool == this? currentIndex : int(next++ % unsigned(n));
+
+    // Counters go first, so that they never drop to zero while there is
+    // still work to do:
+    pending++;
+    queued++;
+    {
+        lock_guard<mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(task);
+    }
+
+    // Taking the lock ensures sleeping threads don't miss the new task:
+    { lock_guard<mutex> lock(sleepMutex); }
+    wakeUp.notify_one();
+    finished.notify_one();
+}
+
+
+void ThreadPool::wait() {
+    ThreadPool *previousPool = currentPool;
+    int previousIndex = currentIndex;
+    currentPool = this;
+    currentIndex = 0;
+
+    while (pending > 0) {
+        if (!runOne(0)) {
+            unique_lock<mutex> lock(sleepMutex);
+            finished.wait(lock, [this] { return pending == 0 || queued > 0; });
+        }
+    }
+
+    currentPool = previousPool;
+    currentIndex = previousIndex;
+}
+
+
+void ThreadPool::work(int index) {
+    currentPool = this;
+    currentIndex = index;
+
+    for (;;) {
+        if (runOne(index))
+            continue;
+
+        unique_lock<mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return stop || queued > 0; });
+        if (stop && queued == 0)
+            return;
+    }
+}
+
+
+bool ThreadPool::runOne(int index) {
+    int n = int(queues.size());
+    Task task;
+    bool found = false;
+
+    // First, look into our own queue (newest task first):
+    {
+        Queue *queue = queues[index];
+        lock_guard<mutex> lock(queue->mutex);
+        if (!queue->tasks.empty()) {
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // Then, try to steal from the others (oldest task first):
+    for (int i = 1; i < n && !found; i++) {
+        Queue *queue = queues[(index + i) % n];
+        lock_guard<mutex> lock(queue->mutex);
+        if (!queue->tasks.empty()) {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found)
+        return false;
+
+    queued--;
+    task();
+
+    if (--pending == 0) {
+        { lock_guard<mutex> lock(sleepMutex); }
+        finished.notify_all();
+    }
+    return true;
+}
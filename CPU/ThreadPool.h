@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A simple work-stealing thread pool. Each worker owns a queue: it pops its
+ * own tasks from the back (most recently submitted first, which are likely to
+ * find their inputs in cache) and, when it runs out of work, it steals from
+ * the front of the queues of the others.
+ *
+ * The thread that calls 'wait' joins the workers until all the submitted
+ * tasks (including the ones submitted by other tasks) are finished. A pool
+ * should only be waited on by one thread at a time.
+ */
+class ThreadPool {
+    public:
+        typedef std::function<void()> Task;
+
+        /**
+         * nThreads: total number of threads running tasks, including the one
+         * calling 'wait'. If zero, the number of hardware threads is used.
+         */
+        ThreadPool(int nThreads=0);
+        ~ThreadPool();
+
+        int getThreadCount() const { return int(queues.size()); }
+
+        /**
+         * Queues a task. When called from inside a task, the new one goes to
+         * the queue of the current worker.
+         */
+        void submit(const Task &task);
+
+        /**
+         * Runs tasks on the calling thread until all of them are finished.
+         */
+        void wait();
+
+    private:
+        class Queue {
+            public:
+                std::mutex mutex;
+                std::deque<Task> tasks;
+        };
+
+        void work(int index);
+        bool runOne(int index);
+
+        std::vector<Queue *> queues;
+        std::vector<std::thread> threads;
+
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+        std::condition_variable finished;
+        std::atomic<int> queued;
+        std::atomic<int> pending;
+        std::atomic<unsigned> next;
+        bool stop;
+};
+
+#endif
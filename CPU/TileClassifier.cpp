@@ -0,0 +1,134 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "TileClassifier.h"
+using namespace std;
+
+
+void TileClassifier::getSampleCounts(int nSamples, Kernel::Placement placement, vector<int> &counts) {
+    static const int presets[] = { 3, 5, 7, 9, 11, 13, 17, 21, 25, 33, 41, 49, 65 };
+    const bool wide = nSamples > 20;
+    counts.clear();
+    for (int i = 0; i < int(sizeof(presets) / sizeof(presets[0])); i++) {
+        if (placement == Kernel::PLACEMENT_POWER && (presets[i] > 20) != wide)
+            continue;
+        if (presets[i] < nSamples)
+            counts.push_back(presets[i]);
+    }
+    counts.push_back(nSamples);
+}
+
+
+float TileClassifier::getMaxStep(const vector<KernelSample> &kernel, float maxTapSpacing) {
+    // The average distance between the taps, in units of kernel offset:
+    float lo = 0.0f, hi = 0.0f;
+    for (size_t i = 0; i < kernel.size(); i++) {
+        lo = min(lo, kernel[i].offset);
+        hi = max(hi, kernel[i].offset);
+    }
+    float gap = kernel.size() > 1? (hi - lo) / float(kernel.size() - 1) : 0.0f;
+    return gap > 0.0f? maxTapSpacing / gap : numeric_limits<float>::infinity();
+}
+
+
+void TileClassifier::classify(const Footprint &footprint,
+                              const vector<vector<KernelSample> > &kernels,
+                              const vector<float> &maxSteps,
+                              int width, int height) {
+    tilesX = footprint.getTilesX();
+    tilesY = footprint.getTilesY();
+    classes.resize(tilesX * tilesY);
+    tileCounts.assign(kernels.size(), 0);
+
+    // Steps are converted into pixels along the longest axis, which is the
+    // worst case of both passes:
+    const float size = float(max(width, height));
+    const int full = int(kernels.size()) - 1;
+    double taps = 0.0, fullTaps = 0.0;
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            float step = footprint.getMaxStep(tx, ty) * size;
+            int c = 0;
+            if (!(step < numeric_limits<float>::max()))
+                c = full;
+            else
+                while (c < full && step > maxSteps[c])
+                    c++;
+
+            classes[ty * tilesX + tx] = (unsigned char) c;
+            tileCounts[c]++;
+            if (step > 0.0f) {
+                taps += double(kernels[c].size());
+                fullTaps += double(kernels[full].size());
+            }
+        }
+    }
+    savings = fullTaps > 0.0? float(100.0 * (1.0 - taps / fullTaps)) : 0.0f;
+}
+
+
+void TileClassifier::run(const BlurPass &pass,
+                         const vector<vector<KernelSample> > &kernels,
+                         BlurPass::Backend backend,
+                         ThreadPool *pool) const {
+    // Tiles are small, so rows of them are submitted instead:
+    for (int ty = 0; ty < tilesY; ty++) {
+        if (pool != NULL)
+            pool->submit([this, &pass, &kernels, backend, ty] { runRow(pass, kernels, backend, ty); });
+        else
+            runRow(pass, kernels, backend, ty);
+    }
+    if (pool != NULL)
+        pool->wait();
+}
+
+
+void TileClassifier::runRow(const BlurPass &pass, const vector<vector<KernelSample> > &kernels,
+                            BlurPass::Backend backend, int ty) const {
+    BlurPass p = pass;
+    const int y0 = ty * TILE_SIZE, y1 = min(y0 + TILE_SIZE, pass.height);
+    for (int tx = 0; tx < tilesX; tx++) {
+        const vector<KernelSample> &kernel = kernels[getClass(tx, ty)];
+        p.kernel = &kernel.front();
+        p.nSamples = int(kernel.size());
+
+        const int x0 = tx * TILE_SIZE, x1 = min(x0 + TILE_SIZE, pass.width);
+        p.run(x0, y0, x1, y1, backend);
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef TILECLASSIFIER_H
+#define TILECLASSIFIER_H
+
+#include <vector>
+#include "BlurPass.h"
+#include "Footprint.h"
+#include "ThreadPool.h"
+
+/**
+ * Per-tile selection of the kernel (see 'SeparableSSSCPU::setAdaptiveSampling'
+ * and 'SeparableSSSCPU::setTapMerging').
+ *
+ * The footprint of the kernel on screen, 'sssWidth * scale * strength',
+ * varies a lot across a frame: the taps of a distant head all land within a
+ * few pixels, where a handful of them give the same result, while close-ups
+ * need every one of them. So, after the footprint prepass (see 'Footprint'),
+ * each tile of TILE_SIZE x TILE_SIZE pixels is classified by its largest
+ * footprint into one of a set of kernels sorted by cost: the first one that
+ * can be used with that footprint, that is, whose taps are at most
+ * 'maxTapSpacing' pixels apart on average (see 'getMaxStep'), or whose
+ * merged taps are at most one pixel apart (see 'Kernel::merge'). Then both
+ * passes are run tile by tile, each tile with the kernel of its class.
+ *
+ * Tiles with no footprint (with no pixels to process, or with zero strength)
+ * get the smallest kernel, as all its taps fall on the pixel itself. Tiles
+ * of the last class run the full kernel, so they match the regular passes.
+ */
+class TileClassifier {
+    public:
+        static const int TILE_SIZE = 16;
+
+        TileClassifier() : tilesX(0), tilesY(0), savings(0.0f) {}
+
+        /**
+         * Sample counts of the kernel set, for a full kernel of 'nSamples'
+         * samples: the odd counts used by the quality presets and below,
+         * up to 'nSamples', which is always the last one.
+         *
+         * The power placement spreads kernels of more than 20 samples over a
+         * wider range (see 'Kernel::Placement'), so, with it, all the counts
+         * are taken from the same side of 20 as 'nSamples': otherwise the
+         * taps of neighbouring tiles of different classes would reach
+         * different distances, and their borders would show. Sets for more
+         * than 20 samples then start at 21; the CDF placements, whose range
+         * doesn't depend on the count, get the whole set.
+         */
+        static void getSampleCounts(int nSamples, Kernel::Placement placement, std::vector<int> &counts);
+
+        /**
+         * Largest step, in pixels per unit of kernel offset, for which the
+         * taps of 'kernel' are at most 'maxTapSpacing' pixels apart on
+         * average. It's infinite for kernels of a single tap.
+         */
+        static float getMaxStep(const std::vector<KernelSample> &kernel, float maxTapSpacing);
+
+        /**
+         * Classifies the tiles of 'footprint', which must have been built
+         * with tiles of TILE_SIZE x TILE_SIZE pixels, for a frame of
+         * 'width' x 'height' pixels. Each tile gets the first of 'kernels'
+         * whose entry of 'maxSteps' (in pixels per unit of kernel offset) is
+         * at least its largest step, or the last one, which must be the full
+         * kernel, if none is.
+         */
+        void classify(const Footprint &footprint,
+                      const std::vector<std::vector<KernelSample> > &kernels,
+                      const std::vector<float> &maxSteps,
+                      int width, int height);
+
+        /**
+         * Runs 'pass' over every tile, with the kernel of its class, on
+         * 'pool' if it's not NULL. The kernel and sample count of 'pass'
+         * are ignored.
+         */
+        void run(const BlurPass &pass,
+                 const std::vector<std::vector<KernelSample> > &kernels,
+                 BlurPass::Backend backend,
+                 ThreadPool *pool=NULL) const;
+
+        /**
+         * Class of tile (tx, ty), that is, the index of its kernel.
+         */
+        int getClass(int tx, int ty) const { return classes[ty * tilesX + tx]; }
+
+        /**
+         * Number of tiles of each class, and the samples they save, in
+         * percent of the taps the full kernel would take. The savings only
+         * count the tiles with some footprint, as the others have no skin
+         * to blur.
+         */
+        const std::vector<int> &getTileCounts() const { return tileCounts; }
+        float getSavings() const { return savings; }
+
+    private:
+        void runRow(const BlurPass &pass, const std::vector<std::vector<KernelSample> > &kernels,
+                    BlurPass::Backend backend, int ty) const;
+
+        int tilesX, tilesY;
+        std::vector<unsigned char> classes;
+        std::vector<int> tileCounts;
+        float savings;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include "TileScheduler.h"
+using namespace std;
+
+
+TileScheduler::TileScheduler(ThreadPool *pool, int tileWidth, int tileHeight) :
+        pool(pool), tileWidth(tileWidth), tileHeight(tileHeight), footprint(NULL),
+        x(NULL), y(NULL), backend(BlurPass::BACKEND_AUTO),
+        tilesX(0), tilesY(0) {}
+
+
+void TileScheduler::run(const BlurPass &x, const BlurPass &y, BlurPass::Backend backend) {
+    this->x = &x;
+    this->y = &y;
+    this->backend = BlurPass::resolve(backend);
+
+    tilesX = (x.width + tileWidth - 1) / tileWidth;
+    tilesY = (x.height + tileHeight - 1) / tileHeight;
+    bandRemaining.assign(tilesY, tilesX);
+    bandWaiters.assign(tilesY, vector<int>());
+    tileRemaining.assign(tilesX * tilesY, 0);
+
+    // The bands should get finished (and the vertical tiles released) top
+    // to bottom, as early as possible. Workers run their own queue from the
+    // back, so horizontal tiles are queued bottom to top; the tiles that get
+    // stolen are then the bottom ones, which are needed last anyway. Workers
+    // that start while tiles are still being queued may take a few of them
+    // out of order:
+    for (int ty = tilesY - 1; ty >= 0; ty--)
+        for (int tx = tilesX - 1; tx >= 0; tx--)
+            pool->submit([this, tx, ty] { runHorizontal(tx, ty); });
+    pool->wait();
+}
+
+
+void TileScheduler::runHorizontal(int tx, int ty) {
+    int x0 = tx * tileWidth, x1 = min(x0 + tileWidth, x->width);
+    int y0 = ty * tileHeight, y1 = min(y0 + tileHeight, x->height);
+
+    // Clear our part of the temporal render target (and of the stencil):
+    unsigned char *dst = (unsigned char *) x->dst;
+    const size_t size = PixelFormat::getSize(x->dstFormat);
+    if (x->dstTransposed) {
+        for (int i = x0; i < x1; i++)
+            memset(dst + size * (i * x->height + y0), 0, size * (y1 - y0));
+    } else {
+        for (int j = y0; j < y1; j++)
+            memset(dst + size * (j * x->width + x0), 0, size * (x1 - x0));
+    }
+    if (x->initStencil != NULL) {
+        for (int j = y0; j < y1; j++)
+            memset(x->initStencil + j * x->width + x0, 0, x1 - x0);
+    }
+
+    x->run(x0, y0, x1, y1, backend);
+
+    // Now that the stencil and strength of this tile are known, find the
+    // bands its vertical tile will read from:
+    int r;
+    if (footprint != NULL && footprint->getTileWidth() == tileWidth && footprint->getTileHeight() == tileHeight)
+        r = footprint->reach(*y, tx, ty);
+    else if (x->dstTransposed)
+        r = y->reach(y0, x0, y1, x1);
+    else
+        r = y->reach(x0, y0, x1, y1);
+    int lo = max(0, y0 - r) / tileHeight;
+    int hi = min(x->height - 1, y1 - 1 + r) / tileHeight;
+
+    int tile = ty * tilesX + tx;
+    vector<int> ready;
+    {
+        lock_guard<mutex> lock(dependencyMutex);
+
+        if (--bandRemaining[ty] == 0) {
+            for (size_t i = 0; i < bandWaiters[ty].size(); i++)
+                if (--tileRemaining[bandWaiters[ty][i]] == 0)
+                    ready.push_back(bandWaiters[ty][i]);
+        }
+
+        int count = 0;
+        for (int band = lo; band <= hi; band++) {
+            if (bandRemaining[band] > 0) {
+                bandWaiters[band].push_back(tile);
+                count++;
+            }
+        }
+        tileRemaining[tile] = count;
+        if (count == 0)
+            ready.push_back(tile);
+    }
+
+    for (size_t i = 0; i < ready.size(); i++)
+        submitVertical(ready[i]);
+}
+
+
+void TileScheduler::submitVertical(int tile) {
+    int tx = tile % tilesX, ty = tile / tilesX;
+    pool->submit([this, tx, ty] { runVertical(tx, ty); });
+}
+
+
+void TileScheduler::runVertical(int tx, int ty) {
+    int x0 = tx * tileWidth, x1 = min(x0 + tileWidth, x->width);
+    int y0 = ty * tileHeight, y1 = min(y0 + tileHeight, x->height);
+    if (x->dstTransposed)
+        y->run(y0, x0, y1, x1, backend);
+    else
+        y->run(x0, y0, x1, y1, backend);
+}
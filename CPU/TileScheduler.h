@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include <mutex>
+#include <vector>
+#include "BlurPass.h"
+#include "Footprint.h"
+#include "ThreadPool.h"
+
+/**
+ * Runs the horizontal and vertical passes split into tiles, on a thread pool.
+ *
+ * There is no barrier between the two passes: a vertical tile starts as soon
+ * as all the horizontal tiles it depends on are finished. These are the ones
+ * in the rows (bands of tiles) its taps can reach, which are only known once
+ * its own horizontal tile has run, as the step depends on the depth and
+ * strength of each pixel. The horizontal tiles of its own band are always
+ * included, as the vertical pass overwrites the input of the horizontal one.
+ *
+ * Each horizontal tile also clears its part of the temporal buffer (and of
+ * the stencil, when it's initialized on the fly), so there's no need to
+ * clear them beforehand.
+ */
+class TileScheduler {
+    public:
+        TileScheduler(ThreadPool *pool, int tileWidth=64, int tileHeight=64);
+
+        /**
+         * 'x' must write into the buffer that 'y' reads from. If 'x' writes
+         * it transposed, 'y' must be the vertical pass expressed as a
+         * horizontal one over the transposed images (see
+         * 'SeparableSSSCPU::setTransposed').
+         */
+        void run(const BlurPass &x, const BlurPass &y, BlurPass::Backend backend);
+
+        /**
+         * If a footprint built with the same tile size is set, the reach of
+         * the vertical tiles is taken from it, instead of from a scan of
+         * their pixels.
+         */
+        void setFootprint(const Footprint *footprint) { this->footprint = footprint; }
+
+    private:
+        void runHorizontal(int tx, int ty);
+        void runVertical(int tx, int ty);
+        void submitVertical(int tile);
+
+        ThreadPool *pool;
+        int tileWidth, tileHeight;
+        const Footprint *footprint;
+
+        const BlurPass *x, *y;
+        BlurPass::Backend backend;
+        int tilesX, tilesY;
+
+        /**
+         * Dependency tracking, protected by 'dependencyMutex':
+         *   - bandRemaining: horizontal tiles not yet finished, per band.
+         *   - bandWaiters: vertical tiles waiting for each band.
+         *   - tileRemaining: bands each vertical tile is waiting for.
+         */
+        std::mutex dependencyMutex;
+        std::vector<int> bandRemaining;
+        std::vector<std::vector<int> > bandWaiters;
+        std::vector<int> tileRemaining;
+};
+
+#endif
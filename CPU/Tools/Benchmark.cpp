@@ -0,0 +1,162 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "Benchmark.h"
+using namespace std;
+
+
+/**
+ * Parses a comma separated list of values.
+ */
+template <typename T>
+static vector<T> parseList(const string &s) {
+    vector<T> values;
+    istringstream in(s);
+    string item;
+    while (getline(in, item, ',')) {
+        istringstream value(item);
+        T v;
+        if (value >> v)
+            values.push_back(v);
+    }
+    return values;
+}
+
+
+/**
+ * Parses the 'key=value' arguments of the sweep, starting at 'argv[first]'.
+ */
+static bool parseSweep(int argc, char **argv, int first, Benchmark::Sweep &sweep) {
+    for (int i = first; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq == string::npos)
+            return false;
+
+        string key = arg.substr(0, eq), value = arg.substr(eq + 1);
+        if (key == "heights")
+            sweep.heights = parseList<int>(value);
+        else if (key == "samples")
+            sweep.samples = parseList<int>(value);
+        else if (key == "follow")
+            sweep.followSurface = parseList<int>(value);
+        else if (key == "coverages")
+            sweep.coverages = parseList<float>(value);
+        else if (key == "threads")
+            sweep.threads = parseList<int>(value);
+        else if (key == "capture")
+            sweep.captures.push_back(value);
+        else if (key == "kernels")
+            sweep.nKernels = atoi(value.c_str());
+        else if (key == "repetitions")
+            sweep.repetitions = atoi(value.c_str());
+        else
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * Headless driver for the benchmarks of the CPU engine. Usage:
+ *
+ *     Benchmark [backends | scaling [max threads] | streaming [max height] |
+ *                passes | formats [max height] | kernels | materials |
+ *                profiles [materials] | transmittance | relighting |
+ *                frames [frames] [csv file] | pyramid | checkerboard |
+ *                adaptive | merging | sweep [key=value ...]]
+ *
+ * The sweep takes comma separated lists for 'heights', 'samples', 'follow'
+ * (0 and/or 1), 'coverages' and 'threads', single values for 'kernels' and
+ * 'repetitions', and any number of 'capture' prefixes (see
+ * 'Benchmark::sweep'), for example:
+ *
+ *     Benchmark sweep heights=1080,2160 samples=11,25 threads=1,8 capture=Captures/head
+ */
+int main(int argc, char **argv) {
+    const char *test = argc > 1? argv[1] : "backends";
+
+    if (strcmp(test, "backends") == 0) {
+        Benchmark::backends(cout);
+    } else if (strcmp(test, "scaling") == 0) {
+        Benchmark::scaling(cout, argc > 2? atoi(argv[2]) : 0);
+    } else if (strcmp(test, "streaming") == 0) {
+        Benchmark::streaming(cout, argc > 2? atoi(argv[2]) : 4320);
+    } else if (strcmp(test, "passes") == 0) {
+        Benchmark::passes(cout);
+    } else if (strcmp(test, "formats") == 0) {
+        Benchmark::formats(cout, argc > 2? atoi(argv[2]) : 4320);
+    } else if (strcmp(test, "kernels") == 0) {
+        Benchmark::kernels(cout);
+    } else if (strcmp(test, "materials") == 0) {
+        Benchmark::materials(cout);
+    } else if (strcmp(test, "profiles") == 0) {
+        Benchmark::profiles(cout, argc > 2? atoi(argv[2]) : 500);
+    } else if (strcmp(test, "transmittance") == 0) {
+        Benchmark::transmittance(cout);
+    } else if (strcmp(test, "relighting") == 0) {
+        Benchmark::relighting(cout);
+    } else if (strcmp(test, "frames") == 0) {
+        ofstream csv;
+        if (argc > 3)
+            csv.open(argv[3]);
+        Benchmark::frames(cout, argc > 2? atoi(argv[2]) : 500, argc > 3? &csv : NULL);
+    } else if (strcmp(test, "pyramid") == 0) {
+        Benchmark::pyramid(cout);
+    } else if (strcmp(test, "checkerboard") == 0) {
+        Benchmark::checkerboard(cout);
+    } else if (strcmp(test, "adaptive") == 0) {
+        Benchmark::adaptive(cout);
+    } else if (strcmp(test, "merging") == 0) {
+        Benchmark::merging(cout);
+    } else if (strcmp(test, "sweep") == 0) {
+        Benchmark::Sweep sweep;
+        if (!parseSweep(argc, argv, 2, sweep)) {
+            cerr << "Invalid sweep arguments" << endl;
+            return 1;
+        }
+        Benchmark::sweep(cout, sweep);
+    } else {
+        cerr << "Unknown benchmark: " << test << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,470 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "ImageDiff.h"
+#include "PFM.h"
+using namespace std;
+
+
+/**
+ * Largest differences allowed against the reference.
+ */
+struct Tolerance {
+    float maxError;
+    float rmsError;
+    float minSSIM;
+    float maxVisible; // Fraction of the pixels
+};
+
+
+/**
+ * Parameters 'SeparableSSSCPU' is created with, and the kernel atlas, if
+ * any, for frames that mix materials. Each configuration has its own
+ * reference (see 'Variant').
+ */
+struct Configuration {
+    const char *name;
+    bool stencilInitialized;
+    bool followSurface;
+    bool separateStrengthSource;
+    const KernelAtlas *atlas;
+    bool golden; // Whether its reference must match the stored golden image
+};
+
+
+/**
+ * An optimized configuration of 'SeparableSSSCPU', checked against the
+ * reference one (scalar backend, full float temporal buffer, single thread,
+ * no optional modes), which runs the code of 'SSSSBlurPS' as is.
+ */
+struct Variant {
+    const char *name;
+    PixelFormat::Format format; // Of the temporal buffer
+    function<bool(SeparableSSSCPU &)> setup; // Returns false if not supported
+    Tolerance tolerance;
+};
+
+
+struct Input {
+    string name;
+    SyntheticFrame frame;
+};
+
+
+static const Configuration defaultConfiguration = { "", true, true, true, NULL, true };
+
+
+static vector<float> render(const SyntheticFrame &frame,
+                            const Configuration &config,
+                            PixelFormat::Format format,
+                            const function<bool(SeparableSSSCPU &)> &setup,
+                            bool &supported) {
+    SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, 17,
+                        config.stencilInitialized, config.followSurface, config.separateStrengthSource, format);
+    sss.setBackend(BlurPass::BACKEND_SCALAR);
+    sss.setKernelAtlas(config.atlas);
+    vector<float> color = frame.color;
+
+    // Without an initialized stencil, the buffer is written by the
+    // horizontal pass instead:
+    vector<unsigned char> stencil = frame.stencil;
+    if (!config.stencilInitialized)
+        fill(stencil.begin(), stencil.end(), (unsigned char) 0);
+
+    supported = setup(sss);
+    if (supported)
+        sss.go(&color.front(), &frame.depth.front(), &stencil.front(), &frame.strength.front(), 1,
+               config.atlas != NULL? &frame.material.front() : NULL);
+    return color;
+}
+
+
+/**
+ * 'frame' as rendered with 'config': with an atlas, the materials are split
+ * into two, in squares of 32 pixels, so that they also change within the
+ * heads. The strength is already in the alpha channel of every input.
+ */
+static SyntheticFrame prepare(const SyntheticFrame &frame, const Configuration &config) {
+    SyntheticFrame prepared = frame;
+    if (config.atlas != NULL) {
+        for (int y = 0; y < frame.height; y++)
+            for (int x = 0; x < frame.width; x++)
+                prepared.material[y * frame.width + x] = (unsigned char) ((x / 32 + y / 32) & 1);
+    }
+    return prepared;
+}
+
+
+/**
+ * 'frame' moved 'dx' pixels to the right, wrapping around.
+ */
+static SyntheticFrame shift(const SyntheticFrame &frame, int dx) {
+    SyntheticFrame shifted = frame;
+    const int w = frame.width;
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < w; x++) {
+            int i = y * w + x;
+            int j = y * w + ((x - dx) % w + w) % w;
+            for (int c = 0; c < 4; c++)
+                shifted.color[4 * i + c] = frame.color[4 * j + c];
+            shifted.depth[i] = frame.depth[j];
+            shifted.strength[i] = frame.strength[j];
+            shifted.stencil[i] = frame.stencil[j];
+            shifted.material[i] = frame.material[j];
+        }
+    }
+    return shifted;
+}
+
+
+/**
+ * Renders 'nFrames' frames with temporal amortization over 'nPhases' frames,
+ * panning the view 'dx' pixels per frame (with the matching velocities), so
+ * that the last frame is 'frame' itself, and returns the last result.
+ */
+static vector<float> renderTemporal(const SyntheticFrame &frame, int nPhases, int nFrames, int dx) {
+    SeparableSSSCPU sss(frame.width, frame.height, 20.0f, 0.012f, 17, true, true, true);
+    sss.setBackend(BlurPass::BACKEND_SCALAR);
+    sss.setTemporal(nPhases);
+
+    vector<float> velocity(2 * frame.width * frame.height, 0.0f);
+    for (int i = 0; i < frame.width * frame.height; i++)
+        velocity[2 * i] = float(dx) / float(frame.width);
+
+    vector<float> color;
+    for (int f = 0; f < nFrames; f++) {
+        SyntheticFrame current = shift(frame, dx * (f - nFrames + 1));
+        color = current.color;
+        sss.go(&color.front(), &current.depth.front(), &current.stencil.front(), &current.strength.front(), 1, NULL, &velocity.front());
+    }
+    return color;
+}
+
+
+static vector<float> toRGB(const vector<float> &rgba) {
+    vector<float> rgb(3 * (rgba.size() / 4));
+    for (size_t i = 0; i < rgba.size() / 4; i++)
+        for (int c = 0; c < 3; c++)
+            rgb[3 * i + c] = rgba[4 * i + c];
+    return rgb;
+}
+
+
+static vector<float> toRGBA(const vector<float> &rgb) {
+    vector<float> rgba(4 * (rgb.size() / 3), 1.0f);
+    for (size_t i = 0; i < rgb.size() / 3; i++)
+        for (int c = 0; c < 3; c++)
+            rgba[4 * i + c] = rgb[3 * i + c];
+    return rgba;
+}
+
+
+static bool report(const string &input, const string &variant, const ImageDiff::Result &r, const Tolerance &t) {
+    bool ok = r.maxError <= t.maxError &&
+              r.rmsError <= t.rmsError &&
+              r.ssim >= t.minSSIM &&
+              r.nVisible <= t.maxVisible * r.nPixels;
+    cout << input << " : " << variant << " : "
+         << scientific << setprecision(2)
+         << "max " << r.maxError << " : rms " << r.rmsError << " : "
+         << fixed << setprecision(5)
+         << "ssim " << r.ssim << " : "
+         << r.nVisible << " visible : "
+         << (ok? "OK" : "FAIL") << endl;
+    return ok;
+}
+
+
+static vector<Input> loadInputs(int argc, char **argv, int first, bool &ok) {
+    vector<Input> inputs(2);
+    inputs[0].name = "synthetic_sparse";
+    inputs[0].frame = SyntheticFrame(192, 108, 0.15f);
+    inputs[1].name = "synthetic_full";
+    inputs[1].frame = SyntheticFrame(160, 90, 1.0f, 7);
+
+    ok = true;
+    for (int i = first; i < argc; i++) {
+        Input input;
+        string prefix = argv[i];
+        size_t slash = prefix.find_last_of("/\\");
+        input.name = slash == string::npos? prefix : prefix.substr(slash + 1);
+        if (input.name.empty())
+            input.name = "capture";
+        if (!input.frame.load(prefix)) {
+            cerr << "Cannot load " << prefix << endl;
+            ok = false;
+            continue;
+        }
+        inputs.push_back(input);
+    }
+    return inputs;
+}
+
+
+static bool generate(const string &directory, const vector<Input> &inputs) {
+    bool ok = true;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        bool supported;
+        vector<float> reference = render(inputs[i].frame, defaultConfiguration, PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &) { return true; }, supported);
+        string path = directory + "/" + inputs[i].name + ".pfm";
+        if (!PFM::save(path, inputs[i].frame.width, inputs[i].frame.height, 3, &toRGB(reference).front())) {
+            cerr << "Cannot write " << path << endl;
+            ok = false;
+        } else {
+            cout << "Wrote " << path << endl;
+        }
+    }
+    return ok;
+}
+
+
+static bool check(const string &directory, const vector<Input> &inputs) {
+    ThreadPool pool(4);
+
+    /**
+     * Everything but the smaller temporal buffers should match up to
+     * rounding (SIMD backends fuse multiplies and adds, and may sum in a
+     * different order). Half floats keep 11 bits of mantissa, and sRGB8
+     * takes the intermediate result down to 8 bits.
+     *
+     * The approximate modes are bounded by what they are expected to lose:
+     * the multi-resolution mode is exact for the pixels kept at full
+     * resolution, and loses some detail, mostly along silhouettes, for the
+     * ones routed to the coarser levels. Checkerboard mode keeps the error
+     * of the reconstructed pixels within about twice its threshold (0.01 by
+     * default), as both passes add up. Adaptive sampling is exact when every
+     * tile with skin gets the full kernel (a tap spacing of zero), and its
+     * error grows with the spacing allowed to the smaller kernels (at the
+     * default one, it reaches about 1e-2 for distant heads, see
+     * 'Benchmark::adaptive'). Tap merging only merges taps at most a pixel
+     * apart, which is exact between two pixels, but not across one (nor
+     * for the depth test of follow-surface), so it stays within about half
+     * a percent. Temporal amortization misses the combinations of taps of
+     * different phases, and the pixels coming into view only get the taps
+     * of the current frame.
+     */
+    const Tolerance exact = { 1e-5f, 1e-6f, 0.99999f, 0.0f };
+    const Tolerance half = { 1e-3f, 2e-4f, 0.9995f, 0.0f };
+    const Tolerance srgb8 = { 1e-2f, 4e-3f, 0.995f, 0.001f };
+    const Tolerance pyramid = { 7.5e-2f, 2e-3f, 0.999f, 0.01f };
+    const Tolerance checkerboard = { 3e-2f, 1.5e-3f, 0.999f, 0.002f };
+    const Tolerance adaptive = { 5e-3f, 5e-4f, 0.9995f, 0.0f };
+    const Tolerance coarse = { 1.5e-2f, 2e-3f, 0.998f, 0.0f };
+    const Tolerance merging = { 1e-2f, 1e-3f, 0.999f, 0.0f };
+    const Tolerance still = { 5e-3f, 1e-3f, 0.999f, 0.0f };
+    const Tolerance panning = { 6e-2f, 8e-3f, 0.995f, 0.02f };
+    Variant variants[] = {
+        { "SSE4.2", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setBackend(BlurPass::BACKEND_SSE42); return BlurPass::isSupported(BlurPass::BACKEND_SSE42); }, exact },
+        { "AVX2", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setBackend(BlurPass::BACKEND_AVX2); return BlurPass::isSupported(BlurPass::BACKEND_AVX2); }, exact },
+        { "AVX-512", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setBackend(BlurPass::BACKEND_AVX512); return BlurPass::isSupported(BlurPass::BACKEND_AVX512); }, exact },
+        { "threaded", PixelFormat::FORMAT_RGBA32F, [&pool](SeparableSSSCPU &sss) { sss.setThreadPool(&pool); return true; }, exact },
+        { "sparse", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setSparse(true); return true; }, exact },
+        { "streaming", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setStreaming(true); return true; }, exact },
+        { "streaming threaded", PixelFormat::FORMAT_RGBA32F, [&pool](SeparableSSSCPU &sss) { sss.setThreadPool(&pool); sss.setStreaming(true); return true; }, exact },
+        { "transposed", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setTransposed(true); return true; }, exact },
+        { "footprint threaded", PixelFormat::FORMAT_RGBA32F, [&pool](SeparableSSSCPU &sss) { sss.setThreadPool(&pool); sss.setFootprintPrepass(true); return true; }, exact },
+        { "RGBA16F", PixelFormat::FORMAT_RGBA16F, [](SeparableSSSCPU &) { return true; }, half },
+        { "RGBA8_SRGB", PixelFormat::FORMAT_RGBA8_SRGB, [](SeparableSSSCPU &) { return true; }, srgb8 },
+        { "checkerboard", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setCheckerboard(true); return true; }, checkerboard },
+        { "adaptive full", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setAdaptiveSampling(true, 0.0f); return true; }, exact },
+        { "merging", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setTapMerging(true); return true; }, merging },
+        { "fastest", PixelFormat::FORMAT_RGBA32F, [&pool](SeparableSSSCPU &sss) { sss.setBackend(BlurPass::BACKEND_AUTO); sss.setThreadPool(&pool); sss.setSparse(true); return true; }, exact },
+    };
+    const int nVariants = int(sizeof(variants) / sizeof(Variant));
+
+    /**
+     * The modes that take fewer samples where the footprint is small rely on
+     * follow-surface to keep the background out of the kernel: without it,
+     * they alias the edge between skin and background along silhouettes
+     * (errors of about 0.1 for the multi-resolution mode), so they are only
+     * checked with it.
+     */
+    Variant reduced[] = {
+        { "pyramid", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setPyramid(Pyramid::MAX_LEVELS); return true; }, pyramid },
+        { "adaptive", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setAdaptiveSampling(true); return true; }, adaptive },
+        { "adaptive coarse", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setAdaptiveSampling(true, 2.0f); return true; }, coarse },
+        { "merging adaptive", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setTapMerging(true); sss.setAdaptiveSampling(true); return true; }, merging },
+    };
+    const int nReduced = int(sizeof(reduced) / sizeof(Variant));
+
+    /**
+     * The modes that split the frame into tiles, spans or levels, rendered
+     * with the scalar backend and with the widest one supported, which must
+     * match up to rounding (the variants above only run them on the scalar
+     * one). Checkerboard mode evaluates in full the pixels whose residuals
+     * differ more than its threshold, so rounding can flip a few of them.
+     */
+    Variant modes[] = {
+        { "sparse", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setSparse(true); return true; }, exact },
+        { "streaming", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setStreaming(true); return true; }, exact },
+        { "transposed", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setTransposed(true); return true; }, exact },
+        { "footprint threaded", PixelFormat::FORMAT_RGBA32F, [&pool](SeparableSSSCPU &sss) { sss.setThreadPool(&pool); sss.setFootprintPrepass(true); return true; }, exact },
+        { "pyramid", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setPyramid(Pyramid::MAX_LEVELS); return true; }, exact },
+        { "checkerboard", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setCheckerboard(true); return true; }, checkerboard },
+        { "adaptive", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setAdaptiveSampling(true); return true; }, exact },
+        { "merging adaptive", PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &sss) { sss.setTapMerging(true); sss.setAdaptiveSampling(true); return true; }, exact },
+    };
+    const int nModes = int(sizeof(modes) / sizeof(Variant));
+    const BlurPass::Backend widest = BlurPass::resolve(BlurPass::BACKEND_AUTO);
+
+    /**
+     * Besides the default configuration, the strength taken from the alpha
+     * channel and a stencil initialized on the fly must give the same
+     * result, as every input has the strength in its alpha channel and the
+     * stencil marks the pixels with some strength. Follow-surface and the
+     * kernel atlas (two materials, always processed in sparse mode) change
+     * the result, so they only get checked against their own reference.
+     */
+    KernelAtlas atlas;
+    atlas.setProfile(0, 17, Vector3(0.48f, 0.41f, 0.28f), Vector3(1.0f, 0.37f, 0.3f));
+    atlas.setProfile(1, 11, Vector3(0.8f, 0.8f, 0.8f), Vector3(0.6f, 0.6f, 0.6f));
+    const Configuration configs[] = {
+        defaultConfiguration,
+        { "alpha strength", true, true, false, NULL, true },
+        { "stencil on the fly", false, true, true, NULL, true },
+        { "no follow-surface", true, false, true, NULL, false },
+        { "atlas", true, true, true, &atlas, false },
+    };
+    const int nConfigs = int(sizeof(configs) / sizeof(Configuration));
+
+    bool ok = true;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        // The stored golden image:
+        int width, height, channels;
+        vector<float> golden;
+        string path = directory + "/" + inputs[i].name + ".pfm";
+        if (!PFM::load(path, width, height, channels, golden) ||
+            width != inputs[i].frame.width || height != inputs[i].frame.height || channels != 3) {
+            cout << inputs[i].name << " : golden : missing or invalid " << path << " : FAIL" << endl;
+            ok = false;
+            golden.clear();
+        }
+
+        for (int k = 0; k < nConfigs; k++) {
+            const SyntheticFrame frame = prepare(inputs[i].frame, configs[k]);
+            const string prefix = configs[k].name[0] != '\0'? string(configs[k].name) + " " : string();
+            bool supported;
+            vector<float> reference = render(frame, configs[k], PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &) { return true; }, supported);
+
+            // The reference itself, against the stored golden image:
+            if (configs[k].golden && !golden.empty())
+                ok = report(inputs[i].name, prefix + "golden", ImageDiff::compare(&reference.front(), &toRGBA(golden).front(), width, height), exact) && ok;
+
+            const int nChecked = nVariants + (configs[k].followSurface? nReduced : 0);
+            for (int v = 0; v < nChecked; v++) {
+                const Variant &variant = v < nVariants? variants[v] : reduced[v - nVariants];
+                vector<float> color = render(frame, configs[k], variant.format, variant.setup, supported);
+                if (!supported) {
+                    cout << inputs[i].name << " : " << prefix << variant.name << " : not supported" << endl;
+                    continue;
+                }
+                ok = report(inputs[i].name, prefix + variant.name, ImageDiff::compare(&reference.front(), &color.front(), frame.width, frame.height), variant.tolerance) && ok;
+            }
+
+            for (int m = 0; m < nModes; m++) {
+                const string name = prefix + modes[m].name + " " + BlurPass::getName(widest);
+                if (widest == BlurPass::BACKEND_SCALAR) {
+                    cout << inputs[i].name << " : " << name << " : not supported" << endl;
+                    continue;
+                }
+                const function<bool(SeparableSSSCPU &)> &setup = modes[m].setup;
+                vector<float> scalar = render(frame, configs[k], modes[m].format, setup, supported);
+                vector<float> color = render(frame, configs[k], modes[m].format, [&setup, widest](SeparableSSSCPU &sss) { sss.setBackend(widest); return setup(sss); }, supported);
+                ok = report(inputs[i].name, name, ImageDiff::compare(&scalar.front(), &color.front(), frame.width, frame.height), modes[m].tolerance) && ok;
+            }
+        }
+
+        const SyntheticFrame &frame = inputs[i].frame;
+        bool supported;
+        vector<float> reference = render(frame, defaultConfiguration, PixelFormat::FORMAT_RGBA32F, [](SeparableSSSCPU &) { return true; }, supported);
+
+        // Temporal amortization, once the history is filled, for a static
+        // view and for a panning one (which loses the history of the pixels
+        // coming into view):
+        vector<float> color = renderTemporal(frame, 2, 4, 0);
+        ok = report(inputs[i].name, "temporal static", ImageDiff::compare(&reference.front(), &color.front(), frame.width, frame.height), still) && ok;
+        color = renderTemporal(frame, 2, 4, 3);
+        ok = report(inputs[i].name, "temporal panning", ImageDiff::compare(&reference.front(), &color.front(), frame.width, frame.height), panning) && ok;
+    }
+    return ok;
+}
+
+
+/**
+ * Golden image checks of the CPU engine. 'generate' renders the inputs with
+ * the reference configuration and stores the results as PFM files in the
+ * given directory; 'check' renders them again, compares the reference
+ * against the stored images, and every optimized configuration (SIMD
+ * backends, threads, sparse, streaming, transposed, smaller temporal
+ * buffers...) against the reference. This is repeated for the strength
+ * taken from the alpha channel, for a stencil initialized on the fly,
+ * without follow-surface, and with a kernel atlas of two materials, each
+ * with its own reference; the modes that split the frame are also run on
+ * the widest SIMD backend against the scalar one. Temporal amortization is
+ * checked on the fourth frame of a sequence, both for a static view and for
+ * a panning one, whose history must be reprojected. Usage:
+ *
+ *     Golden generate <directory> [capture prefix ...]
+ *     Golden check <directory> [capture prefix ...]
+ *
+ * Besides two built-in synthetic frames, captured frames can be given (see
+ * 'SyntheticFrame::load'). Returns non-zero if a check fails.
+ */
+int main(int argc, char **argv) {
+    if (argc < 3 || (strcmp(argv[1], "generate") != 0 && strcmp(argv[1], "check") != 0)) {
+        cerr << "Usage: Golden generate|check <directory> [capture prefix ...]" << endl;
+        return 1;
+    }
+
+    bool ok;
+    vector<Input> inputs = loadInputs(argc, argv, 3, ok);
+    if (!ok)
+        return 1;
+
+    if (strcmp(argv[1], "generate") == 0)
+        return generate(argv[2], inputs)? 0 : 1;
+    else
+        return check(argv[2], inputs)? 0 : 2;
+}
@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include "Kernel.h"
+using namespace std;
+
+/**
+ * Reports the error of the kernels for a given profile against the number of
+ * samples, and picks the cheapest one that meets an error budget (see
+ * 'Kernel::findSampleCount'). Usage:
+ *
+ *     KernelAnalyzer [-strength r g b] [-falloff r g b] [-pixels n]
+ *                    [-max error] [-rms error] [-placement name]
+ *
+ * Placements are given by name (for example, -placement "CDF max").
+ * Defaults are the ones of the demo, at 16 pixels per unit, with a budget of
+ * 0.02 for the largest error and 0.0025 for the RMS one.
+ */
+int main(int argc, char **argv) {
+    Vector3 strength(0.48f, 0.41f, 0.28f), falloff(1.0f, 0.37f, 0.3f);
+    float pixelsPerUnit = 16.0f;
+    float maxError = 0.02f, rmsError = 0.0025f;
+    Kernel::Placement placement = Kernel::PLACEMENT_POWER;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-strength") == 0 && i + 3 < argc) {
+            strength = Vector3(float(atof(argv[i + 1])), float(atof(argv[i + 2])), float(atof(argv[i + 3])));
+            i += 3;
+        } else if (strcmp(argv[i], "-falloff") == 0 && i + 3 < argc) {
+            falloff = Vector3(float(atof(argv[i + 1])), float(atof(argv[i + 2])), float(atof(argv[i + 3])));
+            i += 3;
+        } else if (strcmp(argv[i], "-pixels") == 0 && i + 1 < argc) {
+            pixelsPerUnit = float(atof(argv[++i]));
+        } else if (strcmp(argv[i], "-max") == 0 && i + 1 < argc) {
+            maxError = float(atof(argv[++i]));
+        } else if (strcmp(argv[i], "-rms") == 0 && i + 1 < argc) {
+            rmsError = float(atof(argv[++i]));
+        } else if (strcmp(argv[i], "-placement") == 0 && i + 1 < argc) {
+            i++;
+            int p = Kernel::PLACEMENT_POWER;
+            while (p <= Kernel::PLACEMENT_CDF_MAX && strcmp(argv[i], Kernel::getName(Kernel::Placement(p))) != 0)
+                p++;
+            if (p > Kernel::PLACEMENT_CDF_MAX) {
+                cerr << "Unknown placement: " << argv[i] << endl;
+                return 1;
+            }
+            placement = Kernel::Placement(p);
+        } else {
+            cerr << "Unknown argument: " << argv[i] << endl;
+            return 1;
+        }
+    }
+
+    cout << Kernel::getName(placement) << " placement, "
+         << pixelsPerUnit << " pixels per unit" << endl;
+    cout << setprecision(5) << fixed;
+    for (int nSamples = 3; nSamples <= 33; nSamples += 2) {
+        vector<KernelSample> kernel;
+        Kernel::calculate(kernel, nSamples, strength, falloff, placement);
+        KernelError error = Kernel::measure(kernel, strength, falloff, pixelsPerUnit);
+        cout << setw(2) << nSamples << " samples : max "
+             << error.max.x << " " << error.max.y << " " << error.max.z << " : RMS "
+             << error.rms.x << " " << error.rms.y << " " << error.rms.z << endl;
+    }
+
+    int nSamples = Kernel::findSampleCount(strength, falloff, pixelsPerUnit, maxError, rmsError, placement);
+    if (nSamples < 0) {
+        cout << "No kernel meets the budget" << endl;
+        return 2;
+    }
+    cout << "Samples: " << nSamples << endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "KernelGenerator.h"
+using namespace std;
+
+
+static void print(ostream &out) {
+    for (int quality = KernelPresets::N_QUALITIES - 1; quality >= 0; quality--) {
+        int nSamples = KernelPresets::getSampleCount(quality);
+        const KernelSample *kernel = KernelPresets::get(quality);
+
+        out << (quality == KernelPresets::N_QUALITIES - 1? "#if" : "#elif") << " SSSS_QUALITY == " << quality << endl;
+        out << "#define SSSS_N_SAMPLES " << nSamples << endl;
+        out << "float4 kernel[] = {" << endl;
+        for (int i = 0; i < nSamples; i++)
+            out << "    float4(" << kernel[i].r << ", "
+                                 << kernel[i].g << ", "
+                                 << kernel[i].b << ", "
+                                 << kernel[i].offset << ")," << endl;
+        out << "};" << endl;
+    }
+}
+
+
+static bool check(const char *path) {
+    ifstream file(path);
+    if (!file) {
+        cerr << "Cannot open " << path << endl;
+        return false;
+    }
+
+    // Collect the tables of each quality:
+    vector<KernelSample> tables[KernelPresets::N_QUALITIES];
+    int quality = -1;
+    string line;
+    while (getline(file, line)) {
+        int q;
+        if (sscanf(line.c_str(), " #if SSSS_QUALITY == %d", &q) == 1 ||
+            sscanf(line.c_str(), " #elif SSSS_QUALITY == %d", &q) == 1) {
+            quality = q >= 0 && q < KernelPresets::N_QUALITIES? q : -1;
+        } else if (line.find("#else") != string::npos || line.find("#endif") != string::npos) {
+            quality = -1;
+        } else if (quality >= 0) {
+            KernelSample s;
+            if (sscanf(line.c_str(), " float4(%f, %f, %f, %f)", &s.r, &s.g, &s.b, &s.offset) == 4)
+                tables[quality].push_back(s);
+        }
+    }
+
+    // Tables are printed with six significant digits:
+    bool ok = true;
+    for (int q = 0; q < KernelPresets::N_QUALITIES; q++) {
+        int nSamples = KernelPresets::getSampleCount(q);
+        const KernelSample *kernel = KernelPresets::get(q);
+        if (int(tables[q].size()) != nSamples) {
+            cout << "Quality " << q << ": " << tables[q].size() << " samples, expected " << nSamples << endl;
+            ok = false;
+            continue;
+        }
+        for (int i = 0; i < nSamples; i++) {
+            const float *a = &tables[q][i].r, *b = &kernel[i].r;
+            for (int c = 0; c < 4; c++) {
+                if (abs(a[c] - b[c]) > 1e-5f * abs(b[c])) {
+                    cout << "Quality " << q << ", sample " << i << ": " << a[c] << ", expected " << b[c] << endl;
+                    ok = false;
+                }
+            }
+        }
+    }
+    if (ok)
+        cout << "Presets match" << endl;
+    return ok;
+}
+
+
+/**
+ * Prints the shader code of the SSSS_QUALITY presets of 'SeparableSSS.h', as
+ * calculated at compile time by 'KernelPresets', or checks the ones of a
+ * given file against them. Usage:
+ *
+ *     KernelCode [check <path to SeparableSSS.h>]
+ *
+ * Returns non-zero if the check fails.
+ */
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "check") == 0) {
+        if (argc < 3) {
+            cerr << "Missing path" << endl;
+            return 1;
+        }
+        return check(argv[2])? 0 : 2;
+    }
+    print(cout);
+    return 0;
+}
@@ -0,0 +1,512 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include "TransmittanceCPU.h"
+#include "CPUFeatures.h"
+#include "Profiler.h"
+
+#if SSSS_X86
+#include <immintrin.h>
+#endif
+using namespace std;
+
+
+TransmittanceCPU::TransmittanceCPU(int width, int height) :
+        width(width),
+        height(height),
+        backend(BlurPass::resolve(BlurPass::BACKEND_AUTO)),
+        pool(NULL) {
+    lut.build(Profile::skin());
+}
+
+
+void TransmittanceCPU::go(float *color,
+                          const float *position,
+                          const float *normal,
+                          const vector<Light> &lights,
+                          float translucency,
+                          float sssWidth,
+                          const float *translucencyMap,
+                          const unsigned char *mask) {
+    if (lights.empty())
+        return;
+
+    SSSS_PROFILE("Transmittance CPU");
+
+    Frame frame;
+    frame.color = color;
+    frame.position = position;
+    frame.normal = normal;
+    frame.lights = &lights.front();
+    frame.nLights = int(lights.size());
+    frame.translucency = translucency;
+    frame.sssWidth = sssWidth;
+    frame.translucencyMap = translucencyMap;
+    frame.mask = mask;
+
+    for (int y0 = 0; y0 < height; y0 += BAND_HEIGHT) {
+        int y1 = min(y0 + BAND_HEIGHT, height);
+        if (pool != NULL)
+            pool->submit([this, frame, y0, y1] { run(frame, y0, y1); });
+        else
+            run(frame, y0, y1);
+    }
+    if (pool != NULL)
+        pool->wait();
+}
+
+
+void TransmittanceCPU::run(const Frame &frame, int y0, int y1) const {
+    switch (backend) {
+        case BlurPass::BACKEND_AVX2:
+            runAVX2(frame, y0, y1);
+            break;
+        case BlurPass::BACKEND_AVX512:
+            runAVX512(frame, y0, y1);
+            break;
+        default:
+            runScalar(frame, y0, y1);
+            break;
+    }
+}
+
+
+/**
+ * Bilinear lookup of a shadow map, with clamped addressing (as the
+ * 'LinearSampler' of 'SeparableSSS.h').
+ */
+static inline float sampleShadow(const TransmittanceCPU::Light &light, float u, float v) {
+    const int w = light.shadowWidth, h = light.shadowHeight;
+    float x = u * float(w) - 0.5f, y = v * float(h) - 0.5f;
+    x = x > 0.0f? min(x, float(w - 1)) : 0.0f; // Also catches NaNs
+    y = y > 0.0f? min(y, float(h - 1)) : 0.0f;
+
+    int x0 = int(x), y0 = int(y);
+    int x1 = min(x0 + 1, w - 1), y1 = min(y0 + 1, h - 1);
+    float tx = x - float(x0), ty = y - float(y0);
+
+    const float *m = light.shadowMap;
+    float top = m[y0 * w + x0] + tx * (m[y0 * w + x1] - m[y0 * w + x0]);
+    float bottom = m[y1 * w + x0] + tx * (m[y1 * w + x1] - m[y1 * w + x0]);
+    return top + ty * (bottom - top);
+}
+
+
+static inline float saturate(float x) {
+    return x > 0.0f? min(x, 1.0f) : 0.0f;
+}
+
+
+/**
+ * Transmittance of all the lights for pixel 'i', using the same operations
+ * as the SIMD backends.
+ */
+static inline Vector3 shade(const TransmittanceLUT &lut,
+                            const TransmittanceCPU::Light *lights, int nLights,
+                            const float *p, const float *n, float scale) {
+    Vector3 sum(0.0f, 0.0f, 0.0f);
+    for (int k = 0; k < nLights; k++) {
+        const TransmittanceCPU::Light &l = lights[k];
+
+        // Light vector, attenuation and spot falloff, as in 'RenderPS':
+        float lx = l.position.x - p[0], ly = l.position.y - p[1], lz = l.position.z - p[2];
+        float dist2 = lx * lx + ly * ly + lz * lz;
+        float dist = sqrt(dist2);
+        float inv = 1.0f / dist;
+        lx *= inv;
+        ly *= inv;
+        lz *= inv;
+
+        float spot = -(l.direction.x * lx + l.direction.y * ly + l.direction.z * lz);
+        if (!(spot > l.falloffStart))
+            continue;
+
+        float x = dist / l.farPlane;
+        float x2 = x * x;
+        float curve = min(x2 * x2 * x2, 1.0f);
+        float attenuation = (1.0f / (1.0f + l.attenuation * dist2)) * (1.0f - curve);
+        float falloff = saturate((spot - l.falloffStart) / l.falloffWidth);
+
+        // And 'SSSSTransmittance':
+        const float *m = l.viewProjection;
+        float sx = p[0] - 0.005f * n[0], sy = p[1] - 0.005f * n[1], sz = p[2] - 0.005f * n[2];
+        float px = sx * m[0] + sy * m[4] + sz * m[8] + m[12];
+        float py = sx * m[1] + sy * m[5] + sz * m[9] + m[13];
+        float pz = sx * m[2] + sy * m[6] + sz * m[10] + m[14];
+        float pw = sx * m[3] + sy * m[7] + sz * m[11] + m[15];
+        float d1 = sampleShadow(l, px / pw, py / pw) * l.farPlane;
+        float d = scale * abs(d1 - pz);
+        Vector3 t = lut.evaluate(d);
+
+        float c = attenuation * falloff * saturate(0.3f - (lx * n[0] + ly * n[1] + lz * n[2]));
+        sum.x += c * l.color.x * t.x;
+        sum.y += c * l.color.y * t.y;
+        sum.z += c * l.color.z * t.z;
+    }
+    return sum;
+}
+
+
+static inline void addPixel(float *color, int i, float r, float g, float b) {
+    color[4 * i + 0] += r;
+    color[4 * i + 1] += g;
+    color[4 * i + 2] += b;
+}
+
+
+void TransmittanceCPU::runPixel(const Frame &f, int i) const {
+    if (f.mask != NULL && f.mask[i] == 0)
+        return;
+    float translucency = f.translucencyMap != NULL? f.translucencyMap[i] : f.translucency;
+    float scale = 8.25f * (1.0f - translucency) / f.sssWidth;
+    Vector3 t = shade(lut, f.lights, f.nLights, f.position + 3 * i, f.normal + 3 * i, scale);
+    addPixel(f.color, i, t.x, t.y, t.z);
+}
+
+
+void TransmittanceCPU::runScalar(const Frame &f, int y0, int y1) const {
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < width; x++)
+            runPixel(f, y * width + x);
+    }
+}
+
+
+#if SSSS_X86
+
+SSSS_TARGET("avx2,fma")
+static inline __m256 sampleShadow8(const TransmittanceCPU::Light &l, __m256 u, __m256 v) {
+    const __m256 zero = _mm256_setzero_ps(), half = _mm256_set1_ps(0.5f);
+    const int w = l.shadowWidth, h = l.shadowHeight;
+
+    // 'max' returns its second operand for NaNs:
+    __m256 x = _mm256_sub_ps(_mm256_mul_ps(u, _mm256_set1_ps(float(w))), half);
+    __m256 y = _mm256_sub_ps(_mm256_mul_ps(v, _mm256_set1_ps(float(h))), half);
+    x = _mm256_min_ps(_mm256_max_ps(x, zero), _mm256_set1_ps(float(w - 1)));
+    y = _mm256_min_ps(_mm256_max_ps(y, zero), _mm256_set1_ps(float(h - 1)));
+
+    __m256i x0 = _mm256_cvttps_epi32(x), y0 = _mm256_cvttps_epi32(y);
+    __m256i x1 = _mm256_min_epi32(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), _mm256_set1_epi32(w - 1));
+    __m256i y1 = _mm256_min_epi32(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), _mm256_set1_epi32(h - 1));
+    __m256 tx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(x0));
+    __m256 ty = _mm256_sub_ps(y, _mm256_cvtepi32_ps(y0));
+
+    __m256i row0 = _mm256_mullo_epi32(y0, _mm256_set1_epi32(w));
+    __m256i row1 = _mm256_mullo_epi32(y1, _mm256_set1_epi32(w));
+    __m256 a = _mm256_i32gather_ps(l.shadowMap, _mm256_add_epi32(row0, x0), 4);
+    __m256 b = _mm256_i32gather_ps(l.shadowMap, _mm256_add_epi32(row0, x1), 4);
+    __m256 c = _mm256_i32gather_ps(l.shadowMap, _mm256_add_epi32(row1, x0), 4);
+    __m256 d = _mm256_i32gather_ps(l.shadowMap, _mm256_add_epi32(row1, x1), 4);
+    __m256 top = _mm256_add_ps(a, _mm256_mul_ps(tx, _mm256_sub_ps(b, a)));
+    __m256 bottom = _mm256_add_ps(c, _mm256_mul_ps(tx, _mm256_sub_ps(d, c)));
+    return _mm256_add_ps(top, _mm256_mul_ps(ty, _mm256_sub_ps(bottom, top)));
+}
+
+
+SSSS_TARGET("avx2,fma")
+void TransmittanceCPU::runAVX2(const Frame &f, int y0, int y1) const {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256i lane3 = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const float *table = lut.getTable();
+    const int resolution = lut.getResolution();
+    const __m256 lutScale = _mm256_set1_ps(lut.getScale());
+    const __m256 lutLast = _mm256_set1_ps(float(resolution - 1));
+    const __m256i lutLastI = _mm256_set1_epi32(resolution - 2);
+
+    for (int y = y0; y < y1; y++) {
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            const int i = y * width + x;
+            unsigned int mask = 0xff;
+            if (f.mask != NULL) {
+                mask = 0;
+                for (int l = 0; l < 8; l++)
+                    mask |= f.mask[i + l] != 0? 1 << l : 0;
+                if (mask == 0) continue;
+            }
+
+            const __m256i base = _mm256_add_epi32(_mm256_set1_epi32(3 * i), lane3);
+            __m256 px = _mm256_i32gather_ps(f.position, base, 4);
+            __m256 py = _mm256_i32gather_ps(f.position + 1, base, 4);
+            __m256 pz = _mm256_i32gather_ps(f.position + 2, base, 4);
+            __m256 nx = _mm256_i32gather_ps(f.normal, base, 4);
+            __m256 ny = _mm256_i32gather_ps(f.normal + 1, base, 4);
+            __m256 nz = _mm256_i32gather_ps(f.normal + 2, base, 4);
+
+            __m256 translucency = f.translucencyMap != NULL? _mm256_loadu_ps(f.translucencyMap + i) : _mm256_set1_ps(f.translucency);
+            __m256 scale = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(8.25f), _mm256_sub_ps(one, translucency)), _mm256_set1_ps(f.sssWidth));
+
+            const __m256 shrink = _mm256_set1_ps(0.005f);
+            __m256 sx = _mm256_sub_ps(px, _mm256_mul_ps(shrink, nx));
+            __m256 sy = _mm256_sub_ps(py, _mm256_mul_ps(shrink, ny));
+            __m256 sz = _mm256_sub_ps(pz, _mm256_mul_ps(shrink, nz));
+
+            __m256 r = zero, g = zero, b = zero;
+            for (int k = 0; k < f.nLights; k++) {
+                const Light &l = f.lights[k];
+
+                __m256 lx = _mm256_sub_ps(_mm256_set1_ps(l.position.x), px);
+                __m256 ly = _mm256_sub_ps(_mm256_set1_ps(l.position.y), py);
+                __m256 lz = _mm256_sub_ps(_mm256_set1_ps(l.position.z), pz);
+                __m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lx, lx), _mm256_mul_ps(ly, ly)), _mm256_mul_ps(lz, lz));
+                __m256 dist = _mm256_sqrt_ps(dist2);
+                __m256 inv = _mm256_div_ps(one, dist);
+                lx = _mm256_mul_ps(lx, inv);
+                ly = _mm256_mul_ps(ly, inv);
+                lz = _mm256_mul_ps(lz, inv);
+
+                __m256 spot = _mm256_xor_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(l.direction.x), lx),
+                                                                        _mm256_mul_ps(_mm256_set1_ps(l.direction.y), ly)),
+                                                          _mm256_mul_ps(_mm256_set1_ps(l.direction.z), lz)), signMask);
+                __m256 lit = _mm256_cmp_ps(spot, _mm256_set1_ps(l.falloffStart), _CMP_GT_OQ);
+                if ((_mm256_movemask_ps(lit) & mask) == 0)
+                    continue;
+
+                __m256 xd = _mm256_div_ps(dist, _mm256_set1_ps(l.farPlane));
+                __m256 x2 = _mm256_mul_ps(xd, xd);
+                __m256 curve = _mm256_min_ps(_mm256_mul_ps(_mm256_mul_ps(x2, x2), x2), one);
+                __m256 attenuation = _mm256_mul_ps(_mm256_div_ps(one, _mm256_add_ps(one, _mm256_mul_ps(_mm256_set1_ps(l.attenuation), dist2))),
+                                                   _mm256_sub_ps(one, curve));
+                __m256 falloff = _mm256_div_ps(_mm256_sub_ps(spot, _mm256_set1_ps(l.falloffStart)), _mm256_set1_ps(l.falloffWidth));
+                falloff = _mm256_min_ps(_mm256_max_ps(falloff, zero), one);
+
+                const float *m = l.viewProjection;
+                __m256 hx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, _mm256_set1_ps(m[0])), _mm256_mul_ps(sy, _mm256_set1_ps(m[4]))),
+                                                        _mm256_mul_ps(sz, _mm256_set1_ps(m[8]))), _mm256_set1_ps(m[12]));
+                __m256 hy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, _mm256_set1_ps(m[1])), _mm256_mul_ps(sy, _mm256_set1_ps(m[5]))),
+                                                        _mm256_mul_ps(sz, _mm256_set1_ps(m[9]))), _mm256_set1_ps(m[13]));
+                __m256 hz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, _mm256_set1_ps(m[2])), _mm256_mul_ps(sy, _mm256_set1_ps(m[6]))),
+                                                        _mm256_mul_ps(sz, _mm256_set1_ps(m[10]))), _mm256_set1_ps(m[14]));
+                __m256 hw = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, _mm256_set1_ps(m[3])), _mm256_mul_ps(sy, _mm256_set1_ps(m[7]))),
+                                                        _mm256_mul_ps(sz, _mm256_set1_ps(m[11]))), _mm256_set1_ps(m[15]));
+                __m256 d1 = _mm256_mul_ps(sampleShadow8(l, _mm256_div_ps(hx, hw), _mm256_div_ps(hy, hw)), _mm256_set1_ps(l.farPlane));
+                __m256 d = _mm256_mul_ps(scale, _mm256_andnot_ps(signMask, _mm256_sub_ps(d1, hz)));
+
+                // Profile lookup (see 'TransmittanceLUT::evaluate'):
+                __m256 u = _mm256_min_ps(_mm256_mul_ps(_mm256_sqrt_ps(_mm256_max_ps(d, zero)), lutScale), lutLast);
+                __m256i e = _mm256_min_epi32(_mm256_cvttps_epi32(u), lutLastI);
+                __m256 t = _mm256_sub_ps(u, _mm256_cvtepi32_ps(e));
+                __m256 r0 = _mm256_i32gather_ps(table, e, 4), r1 = _mm256_i32gather_ps(table + 1, e, 4);
+                __m256 g0 = _mm256_i32gather_ps(table + resolution, e, 4), g1 = _mm256_i32gather_ps(table + resolution + 1, e, 4);
+                __m256 b0 = _mm256_i32gather_ps(table + 2 * resolution, e, 4), b1 = _mm256_i32gather_ps(table + 2 * resolution + 1, e, 4);
+                __m256 tr = _mm256_fmadd_ps(t, _mm256_sub_ps(r1, r0), r0);
+                __m256 tg = _mm256_fmadd_ps(t, _mm256_sub_ps(g1, g0), g0);
+                __m256 tb = _mm256_fmadd_ps(t, _mm256_sub_ps(b1, b0), b0);
+
+                __m256 back = _mm256_sub_ps(_mm256_set1_ps(0.3f), _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lx, nx), _mm256_mul_ps(ly, ny)), _mm256_mul_ps(lz, nz)));
+                back = _mm256_min_ps(_mm256_max_ps(back, zero), one);
+                __m256 c = _mm256_mul_ps(_mm256_mul_ps(attenuation, falloff), back);
+
+                // Unlit lanes may hold NaNs, which are masked out:
+                r = _mm256_add_ps(r, _mm256_and_ps(lit, _mm256_mul_ps(_mm256_mul_ps(c, _mm256_set1_ps(l.color.x)), tr)));
+                g = _mm256_add_ps(g, _mm256_and_ps(lit, _mm256_mul_ps(_mm256_mul_ps(c, _mm256_set1_ps(l.color.y)), tg)));
+                b = _mm256_add_ps(b, _mm256_and_ps(lit, _mm256_mul_ps(_mm256_mul_ps(c, _mm256_set1_ps(l.color.z)), tb)));
+            }
+
+            SSSS_ALIGN(32) float rs[8], gs[8], bs[8];
+            _mm256_store_ps(rs, r);
+            _mm256_store_ps(gs, g);
+            _mm256_store_ps(bs, b);
+            for (int l = 0; mask != 0; l++, mask >>= 1)
+                if (mask & 1)
+                    addPixel(f.color, i + l, rs[l], gs[l], bs[l]);
+        }
+
+        // Remaining pixels of the row:
+        for (; x < width; x++)
+            runPixel(f, y * width + x);
+    }
+}
+
+
+/**
+ * AVX-512 versions of the above.
+ */
+SSSS_TARGET("avx512f")
+static inline __m512 sampleShadow16(const TransmittanceCPU::Light &l, __m512 u, __m512 v) {
+    const __m512 zero = _mm512_setzero_ps(), half = _mm512_set1_ps(0.5f);
+    const int w = l.shadowWidth, h = l.shadowHeight;
+
+    // 'max' returns its second operand for NaNs:
+    __m512 x = _mm512_sub_ps(_mm512_mul_ps(u, _mm512_set1_ps(float(w))), half);
+    __m512 y = _mm512_sub_ps(_mm512_mul_ps(v, _mm512_set1_ps(float(h))), half);
+    x = _mm512_min_ps(_mm512_max_ps(x, zero), _mm512_set1_ps(float(w - 1)));
+    y = _mm512_min_ps(_mm512_max_ps(y, zero), _mm512_set1_ps(float(h - 1)));
+
+    __m512i x0 = _mm512_cvttps_epi32(x), y0 = _mm512_cvttps_epi32(y);
+    __m512i x1 = _mm512_min_epi32(_mm512_add_epi32(x0, _mm512_set1_epi32(1)), _mm512_set1_epi32(w - 1));
+    __m512i y1 = _mm512_min_epi32(_mm512_add_epi32(y0, _mm512_set1_epi32(1)), _mm512_set1_epi32(h - 1));
+    __m512 tx = _mm512_sub_ps(x, _mm512_cvtepi32_ps(x0));
+    __m512 ty = _mm512_sub_ps(y, _mm512_cvtepi32_ps(y0));
+
+    __m512i row0 = _mm512_mullo_epi32(y0, _mm512_set1_epi32(w));
+    __m512i row1 = _mm512_mullo_epi32(y1, _mm512_set1_epi32(w));
+    __m512 a = _mm512_i32gather_ps(_mm512_add_epi32(row0, x0), l.shadowMap, 4);
+    __m512 b = _mm512_i32gather_ps(_mm512_add_epi32(row0, x1), l.shadowMap, 4);
+    __m512 c = _mm512_i32gather_ps(_mm512_add_epi32(row1, x0), l.shadowMap, 4);
+    __m512 d = _mm512_i32gather_ps(_mm512_add_epi32(row1, x1), l.shadowMap, 4);
+    __m512 top = _mm512_add_ps(a, _mm512_mul_ps(tx, _mm512_sub_ps(b, a)));
+    __m512 bottom = _mm512_add_ps(c, _mm512_mul_ps(tx, _mm512_sub_ps(d, c)));
+    return _mm512_add_ps(top, _mm512_mul_ps(ty, _mm512_sub_ps(bottom, top)));
+}
+
+
+SSSS_TARGET("avx512f")
+void TransmittanceCPU::runAVX512(const Frame &f, int y0, int y1) const {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512i lane3 = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+    const float *table = lut.getTable();
+    const int resolution = lut.getResolution();
+    const __m512 lutScale = _mm512_set1_ps(lut.getScale());
+    const __m512 lutLast = _mm512_set1_ps(float(resolution - 1));
+    const __m512i lutLastI = _mm512_set1_epi32(resolution - 2);
+
+    for (int y = y0; y < y1; y++) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            const int i = y * width + x;
+            unsigned int mask = 0xffff;
+            if (f.mask != NULL) {
+                mask = 0;
+                for (int l = 0; l < 16; l++)
+                    mask |= f.mask[i + l] != 0? 1 << l : 0;
+                if (mask == 0) continue;
+            }
+
+            const __m512i base = _mm512_add_epi32(_mm512_set1_epi32(3 * i), lane3);
+            __m512 px = _mm512_i32gather_ps(base, f.position, 4);
+            __m512 py = _mm512_i32gather_ps(base, f.position + 1, 4);
+            __m512 pz = _mm512_i32gather_ps(base, f.position + 2, 4);
+            __m512 nx = _mm512_i32gather_ps(base, f.normal, 4);
+            __m512 ny = _mm512_i32gather_ps(base, f.normal + 1, 4);
+            __m512 nz = _mm512_i32gather_ps(base, f.normal + 2, 4);
+
+            __m512 translucency = f.translucencyMap != NULL? _mm512_loadu_ps(f.translucencyMap + i) : _mm512_set1_ps(f.translucency);
+            __m512 scale = _mm512_div_ps(_mm512_mul_ps(_mm512_set1_ps(8.25f), _mm512_sub_ps(one, translucency)), _mm512_set1_ps(f.sssWidth));
+
+            const __m512 shrink = _mm512_set1_ps(0.005f);
+            __m512 sx = _mm512_sub_ps(px, _mm512_mul_ps(shrink, nx));
+            __m512 sy = _mm512_sub_ps(py, _mm512_mul_ps(shrink, ny));
+            __m512 sz = _mm512_sub_ps(pz, _mm512_mul_ps(shrink, nz));
+
+            __m512 r = zero, g = zero, b = zero;
+            for (int k = 0; k < f.nLights; k++) {
+                const Light &l = f.lights[k];
+
+                __m512 lx = _mm512_sub_ps(_mm512_set1_ps(l.position.x), px);
+                __m512 ly = _mm512_sub_ps(_mm512_set1_ps(l.position.y), py);
+                __m512 lz = _mm512_sub_ps(_mm512_set1_ps(l.position.z), pz);
+                __m512 dist2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(lx, lx), _mm512_mul_ps(ly, ly)), _mm512_mul_ps(lz, lz));
+                __m512 dist = _mm512_sqrt_ps(dist2);
+                __m512 inv = _mm512_div_ps(one, dist);
+                lx = _mm512_mul_ps(lx, inv);
+                ly = _mm512_mul_ps(ly, inv);
+                lz = _mm512_mul_ps(lz, inv);
+
+                __m512 spot = _mm512_sub_ps(zero, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(l.direction.x), lx),
+                                                                              _mm512_mul_ps(_mm512_set1_ps(l.direction.y), ly)),
+                                                                _mm512_mul_ps(_mm512_set1_ps(l.direction.z), lz)));
+                __mmask16 lit = _mm512_cmp_ps_mask(spot, _mm512_set1_ps(l.falloffStart), _CMP_GT_OQ);
+                if ((lit & mask) == 0)
+                    continue;
+
+                __m512 xd = _mm512_div_ps(dist, _mm512_set1_ps(l.farPlane));
+                __m512 x2 = _mm512_mul_ps(xd, xd);
+                __m512 curve = _mm512_min_ps(_mm512_mul_ps(_mm512_mul_ps(x2, x2), x2), one);
+                __m512 attenuation = _mm512_mul_ps(_mm512_div_ps(one, _mm512_add_ps(one, _mm512_mul_ps(_mm512_set1_ps(l.attenuation), dist2))),
+                                                   _mm512_sub_ps(one, curve));
+                __m512 falloff = _mm512_div_ps(_mm512_sub_ps(spot, _mm512_set1_ps(l.falloffStart)), _mm512_set1_ps(l.falloffWidth));
+                falloff = _mm512_min_ps(_mm512_max_ps(falloff, zero), one);
+
+                const float *m = l.viewProjection;
+                __m512 hx = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sx, _mm512_set1_ps(m[0])), _mm512_mul_ps(sy, _mm512_set1_ps(m[4]))),
+                                                        _mm512_mul_ps(sz, _mm512_set1_ps(m[8]))), _mm512_set1_ps(m[12]));
+                __m512 hy = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sx, _mm512_set1_ps(m[1])), _mm512_mul_ps(sy, _mm512_set1_ps(m[5]))),
+                                                        _mm512_mul_ps(sz, _mm512_set1_ps(m[9]))), _mm512_set1_ps(m[13]));
+                __m512 hz = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sx, _mm512_set1_ps(m[2])), _mm512_mul_ps(sy, _mm512_set1_ps(m[6]))),
+                                                        _mm512_mul_ps(sz, _mm512_set1_ps(m[10]))), _mm512_set1_ps(m[14]));
+                __m512 hw = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sx, _mm512_set1_ps(m[3])), _mm512_mul_ps(sy, _mm512_set1_ps(m[7]))),
+                                                        _mm512_mul_ps(sz, _mm512_set1_ps(m[11]))), _mm512_set1_ps(m[15]));
+                __m512 d1 = _mm512_mul_ps(sampleShadow16(l, _mm512_div_ps(hx, hw), _mm512_div_ps(hy, hw)), _mm512_set1_ps(l.farPlane));
+                __m512 d = _mm512_mul_ps(scale, _mm512_abs_ps(_mm512_sub_ps(d1, hz)));
+
+                // Profile lookup (see 'TransmittanceLUT::evaluate'):
+                __m512 u = _mm512_min_ps(_mm512_mul_ps(_mm512_sqrt_ps(_mm512_max_ps(d, zero)), lutScale), lutLast);
+                __m512i e = _mm512_min_epi32(_mm512_cvttps_epi32(u), lutLastI);
+                __m512 t = _mm512_sub_ps(u, _mm512_cvtepi32_ps(e));
+                __m512 r0 = _mm512_i32gather_ps(e, table, 4), r1 = _mm512_i32gather_ps(e, table + 1, 4);
+                __m512 g0 = _mm512_i32gather_ps(e, table + resolution, 4), g1 = _mm512_i32gather_ps(e, table + resolution + 1, 4);
+                __m512 b0 = _mm512_i32gather_ps(e, table + 2 * resolution, 4), b1 = _mm512_i32gather_ps(e, table + 2 * resolution + 1, 4);
+                __m512 tr = _mm512_fmadd_ps(t, _mm512_sub_ps(r1, r0), r0);
+                __m512 tg = _mm512_fmadd_ps(t, _mm512_sub_ps(g1, g0), g0);
+                __m512 tb = _mm512_fmadd_ps(t, _mm512_sub_ps(b1, b0), b0);
+
+                __m512 back = _mm512_sub_ps(_mm512_set1_ps(0.3f), _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(lx, nx), _mm512_mul_ps(ly, ny)), _mm512_mul_ps(lz, nz)));
+                back = _mm512_min_ps(_mm512_max_ps(back, zero), one);
+                __m512 c = _mm512_mul_ps(_mm512_mul_ps(attenuation, falloff), back);
+
+                // Unlit lanes may hold NaNs, which are left out:
+                r = _mm512_mask_add_ps(r, lit, r, _mm512_mul_ps(_mm512_mul_ps(c, _mm512_set1_ps(l.color.x)), tr));
+                g = _mm512_mask_add_ps(g, lit, g, _mm512_mul_ps(_mm512_mul_ps(c, _mm512_set1_ps(l.color.y)), tg));
+                b = _mm512_mask_add_ps(b, lit, b, _mm512_mul_ps(_mm512_mul_ps(c, _mm512_set1_ps(l.color.z)), tb));
+            }
+
+            SSSS_ALIGN(64) float rs[16], gs[16], bs[16];
+            _mm512_store_ps(rs, r);
+            _mm512_store_ps(gs, g);
+            _mm512_store_ps(bs, b);
+            for (int l = 0; mask != 0; l++, mask >>= 1)
+                if (mask & 1)
+                    addPixel(f.color, i + l, rs[l], gs[l], bs[l]);
+        }
+
+        // Remaining pixels of the row:
+        for (; x < width; x++)
+            runPixel(f, y * width + x);
+    }
+}
+
+#else
+
+void TransmittanceCPU::runAVX2(const Frame &f, int y0, int y1) const { runScalar(f, y0, y1); }
+void TransmittanceCPU::runAVX512(const Frame &f, int y0, int y1) const { runScalar(f, y0, y1); }
+
+#endif
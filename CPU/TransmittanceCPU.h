@@ -0,0 +1,165 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef TRANSMITTANCECPU_H
+#define TRANSMITTANCECPU_H
+
+#include <vector>
+#include "BlurPass.h"
+#include "Profile.h"
+#include "ThreadPool.h"
+#include "TransmittanceLUT.h"
+
+/**
+ * CPU counterpart of the transmittance term of 'RenderPS' in 'Main.fx': for
+ * each pixel of a G-buffer, adds the light transmitted through the object
+ * from the back, for all the lights at once:
+ *
+ *     color.rgb += f1 * SSSSTransmittance(...)
+ *
+ * where 'f1' is the color of each light times its distance attenuation and
+ * spot falloff. As in 'RenderPS', the result must still be multiplied by the
+ * albedo, which is left to the caller (it's the same for all lights).
+ *
+ * The profile is looked up in a 'TransmittanceLUT' (the skin one by default)
+ * instead of evaluating its gaussians. The SIMD backends process 8 or 16
+ * neighbouring pixels per iteration, gathering the shadow maps and the table.
+ */
+class TransmittanceCPU {
+    public:
+        /**
+         * Same as the 'Light' struct of 'Main.fx'. 'viewProjection' is
+         * row-major and multiplies row vectors (as D3DXMATRIX), and must map
+         * the positions to texture coordinates of the shadow map, which holds
+         * linear 0..1 depths (see 'ShadowMap.fx').
+         */
+        struct Light {
+            Vector3 position;
+            Vector3 direction;
+            float falloffStart;
+            float falloffWidth;
+            Vector3 color;
+            float attenuation;
+            float farPlane;
+            float viewProjection[16];
+
+            const float *shadowMap;
+            int shadowWidth, shadowHeight;
+        };
+
+        TransmittanceCPU(int width, int height);
+
+        /**
+         * All buffers are row-major, 'width * height' pixels, with the top
+         * row first.
+         *
+         * color: RGBA linear color, to which the transmittance is added (the
+         *     alpha channel is left untouched).
+         *
+         * position, normal: world space position and normal of each pixel
+         *     (three floats per pixel).
+         *
+         * translucency, sssWidth: same as the 'SSSSTransmittance' ones. If
+         *     'translucencyMap' is not NULL, it has one translucency per
+         *     pixel, which overrides 'translucency'.
+         *
+         * mask: if not NULL, only the pixels with a non-zero value are
+         *     processed.
+         */
+        void go(float *color,
+                const float *position,
+                const float *normal,
+                const std::vector<Light> &lights,
+                float translucency,
+                float sssWidth,
+                const float *translucencyMap=NULL,
+                const unsigned char *mask=NULL);
+
+        int getFrameWidth() const { return width; }
+        int getFrameHeight() const { return height; }
+
+        /**
+         * Transmittance profile (see 'Profile::getTransmittance'), and the
+         * resolution of the table it's looked up in.
+         */
+        void setProfile(const Profile &profile, int resolution=256) { lut.build(profile, resolution); }
+        const TransmittanceLUT &getLUT() const { return lut; }
+
+        /**
+         * See 'BlurPass::Backend'. SSE4.2 runs the scalar code, as it has
+         * no gathers.
+         */
+        void setBackend(BlurPass::Backend backend) { this->backend = BlurPass::resolve(backend); }
+        BlurPass::Backend getBackend() const { return backend; }
+
+        /**
+         * If a thread pool is set, bands of rows are processed in parallel.
+         * It must be kept alive while set.
+         */
+        void setThreadPool(ThreadPool *pool) { this->pool = pool; }
+        ThreadPool *getThreadPool() const { return pool; }
+
+    private:
+        /**
+         * Parameters of a 'go' call.
+         */
+        struct Frame {
+            float *color;
+            const float *position;
+            const float *normal;
+            const Light *lights;
+            int nLights;
+            float translucency;
+            float sssWidth;
+            const float *translucencyMap;
+            const unsigned char *mask;
+        };
+
+        void run(const Frame &frame, int y0, int y1) const;
+        void runPixel(const Frame &frame, int i) const;
+        void runScalar(const Frame &frame, int y0, int y1) const;
+        void runAVX2(const Frame &frame, int y0, int y1) const;
+        void runAVX512(const Frame &frame, int y0, int y1) const;
+
+        static const int BAND_HEIGHT = 16;
+
+        int width, height;
+        TransmittanceLUT lut;
+        BlurPass::Backend backend;
+        ThreadPool *pool;
+};
+
+#endif
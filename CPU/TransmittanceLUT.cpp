@@ -0,0 +1,192 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include "TransmittanceLUT.h"
+#include "CPUFeatures.h"
+
+#if SSSS_X86
+#include <immintrin.h>
+#endif
+using namespace std;
+
+
+void TransmittanceLUT::build(const Profile &profile, int resolution, float range) {
+    if (range <= 0.0f) {
+        float widest = 0.0f;
+        const vector<Profile::Term> &terms = profile.getTerms();
+        for (size_t k = 0; k < terms.size(); k++)
+            widest = max(widest, max(terms[k].variance.x, max(terms[k].variance.y, terms[k].variance.z)));
+        range = max(sqrt(widest * 16.0f * log(2.0f)), 1e-6f);
+    }
+
+    this->resolution = max(resolution, 2);
+    this->range = range;
+    scale = float(this->resolution - 1) / sqrt(range);
+
+    table.resize(3 * this->resolution);
+    for (int i = 0; i < this->resolution; i++) {
+        float u = float(i) / float(this->resolution - 1);
+        Vector3 t = profile.getTransmittance(u * u * range);
+        table[i] = t.x;
+        table[this->resolution + i] = t.y;
+        table[2 * this->resolution + i] = t.z;
+    }
+
+    // Check 16 points per interval, which is enough to catch the peak
+    // error of the lerps. Beyond the range, the error is at most the last
+    // entry:
+    const int SUBSAMPLES = 16;
+    maxError = profile.getTransmittance(range);
+    for (int i = 0; i < (this->resolution - 1) * SUBSAMPLES; i++) {
+        float u = (float(i) + 0.5f) / float((this->resolution - 1) * SUBSAMPLES);
+        float d = u * u * range;
+        Vector3 exact = profile.getTransmittance(d), lut = evaluate(d);
+        for (int c = 0; c < 3; c++)
+            maxError[c] = max(maxError[c], abs(lut[c] - exact[c]));
+    }
+}
+
+
+void TransmittanceLUT::evaluate(const float *d, float *r, float *g, float *b, int n,
+                                BlurPass::Backend backend) const {
+    switch (BlurPass::resolve(backend)) {
+        case BlurPass::BACKEND_AVX2:
+            evaluateAVX2(d, r, g, b, n);
+            break;
+        case BlurPass::BACKEND_AVX512:
+            evaluateAVX512(d, r, g, b, n);
+            break;
+        default:
+            evaluateScalar(d, r, g, b, n);
+            break;
+    }
+}
+
+
+void TransmittanceLUT::getTextureData(vector<float> &rgba) const {
+    rgba.resize(4 * resolution);
+    for (int i = 0; i < resolution; i++) {
+        rgba[4 * i + 0] = table[i];
+        rgba[4 * i + 1] = table[resolution + i];
+        rgba[4 * i + 2] = table[2 * resolution + i];
+        rgba[4 * i + 3] = 1.0f;
+    }
+}
+
+
+string TransmittanceLUT::getShaderCode(const string &texture) const {
+    // Texel 'i' is centered at '(i + 0.5) / resolution':
+    stringstream s;
+    s << "#define SSSS_TRANSMITTANCE_PROFILE(dd) SSSSSampleLevelZero(" << texture << ", float2("
+      << "sqrt(sqrt(-(dd))) * " << scale / float(resolution) << " + " << 0.5f / float(resolution)
+      << ", 0.5)).rgb" << "\r\n";
+    return s.str();
+}
+
+
+void TransmittanceLUT::evaluateScalar(const float *d, float *r, float *g, float *b, int n) const {
+    for (int i = 0; i < n; i++) {
+        Vector3 t = evaluate(d[i]);
+        r[i] = t.x;
+        g[i] = t.y;
+        b[i] = t.z;
+    }
+}
+
+
+#if SSSS_X86
+
+SSSS_TARGET("avx2,fma")
+void TransmittanceLUT::evaluateAVX2(const float *d, float *r, float *g, float *b, int n) const {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 scaleV = _mm256_set1_ps(scale);
+    const __m256 last = _mm256_set1_ps(float(resolution - 1));
+    const __m256i lastI = _mm256_set1_epi32(resolution - 2);
+    const float *tr = &table[0], *tg = tr + resolution, *tb = tg + resolution;
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // 'max' returns its second operand for NaNs:
+        __m256 u = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_max_ps(_mm256_loadu_ps(d + i), zero)), scaleV);
+        u = _mm256_min_ps(u, last);
+        __m256i k = _mm256_min_epi32(_mm256_cvttps_epi32(u), lastI);
+        __m256 t = _mm256_sub_ps(u, _mm256_cvtepi32_ps(k));
+
+        __m256 r0 = _mm256_i32gather_ps(tr, k, 4), r1 = _mm256_i32gather_ps(tr + 1, k, 4);
+        __m256 g0 = _mm256_i32gather_ps(tg, k, 4), g1 = _mm256_i32gather_ps(tg + 1, k, 4);
+        __m256 b0 = _mm256_i32gather_ps(tb, k, 4), b1 = _mm256_i32gather_ps(tb + 1, k, 4);
+        _mm256_storeu_ps(r + i, _mm256_fmadd_ps(t, _mm256_sub_ps(r1, r0), r0));
+        _mm256_storeu_ps(g + i, _mm256_fmadd_ps(t, _mm256_sub_ps(g1, g0), g0));
+        _mm256_storeu_ps(b + i, _mm256_fmadd_ps(t, _mm256_sub_ps(b1, b0), b0));
+    }
+    evaluateScalar(d + i, r + i, g + i, b + i, n - i);
+}
+
+
+SSSS_TARGET("avx512f")
+void TransmittanceLUT::evaluateAVX512(const float *d, float *r, float *g, float *b, int n) const {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 scaleV = _mm512_set1_ps(scale);
+    const __m512 last = _mm512_set1_ps(float(resolution - 1));
+    const __m512i lastI = _mm512_set1_epi32(resolution - 2);
+    const float *tr = &table[0], *tg = tr + resolution, *tb = tg + resolution;
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 u = _mm512_mul_ps(_mm512_sqrt_ps(_mm512_max_ps(_mm512_loadu_ps(d + i), zero)), scaleV);
+        u = _mm512_min_ps(u, last);
+        __m512i k = _mm512_min_epi32(_mm512_cvttps_epi32(u), lastI);
+        __m512 t = _mm512_sub_ps(u, _mm512_cvtepi32_ps(k));
+
+        __m512 r0 = _mm512_i32gather_ps(k, tr, 4), r1 = _mm512_i32gather_ps(k, tr + 1, 4);
+        __m512 g0 = _mm512_i32gather_ps(k, tg, 4), g1 = _mm512_i32gather_ps(k, tg + 1, 4);
+        __m512 b0 = _mm512_i32gather_ps(k, tb, 4), b1 = _mm512_i32gather_ps(k, tb + 1, 4);
+        _mm512_storeu_ps(r + i, _mm512_fmadd_ps(t, _mm512_sub_ps(r1, r0), r0));
+        _mm512_storeu_ps(g + i, _mm512_fmadd_ps(t, _mm512_sub_ps(g1, g0), g0));
+        _mm512_storeu_ps(b + i, _mm512_fmadd_ps(t, _mm512_sub_ps(b1, b0), b0));
+    }
+    evaluateScalar(d + i, r + i, g + i, b + i, n - i);
+}
+
+#else
+
+void TransmittanceLUT::evaluateAVX2(const float *d, float *r, float *g, float *b, int n) const { evaluateScalar(d, r, g, b, n); }
+void TransmittanceLUT::evaluateAVX512(const float *d, float *r, float *g, float *b, int n) const { evaluateScalar(d, r, g, b, n); }
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef TRANSMITTANCELUT_H
+#define TRANSMITTANCELUT_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "BlurPass.h"
+#include "Profile.h"
+
+/**
+ * Transmittance profile of 'SSSSTransmittance' (see
+ * 'Profile::getTransmittance'), tabulated against the scaled thickness 'd',
+ * so that it can be calculated with a lookup and a lerp instead of one
+ * 'exp' per gaussian.
+ *
+ * The table covers [0, range], indexed by 'sqrt(d / range)': the narrowest
+ * gaussians, which need the finest resolution, are close to zero, while the
+ * widest ones are smooth. Thicknesses beyond the range take the last entry.
+ */
+class TransmittanceLUT {
+    public:
+        TransmittanceLUT() : resolution(0), range(0.0f) {}
+
+        /**
+         * Tabulates 'profile' with 'resolution' entries. If 'range' is zero,
+         * it's set to the thickness where the widest gaussian falls below
+         * 2^-16. Then measures the maximum absolute error against the
+         * analytic profile (see 'getMaxError').
+         */
+        void build(const Profile &profile, int resolution=256, float range=0.0f);
+
+        int getResolution() const { return resolution; }
+        float getRange() const { return range; }
+
+        /**
+         * Maximum absolute error of each channel, for any thickness.
+         */
+        Vector3 getMaxError() const { return maxError; }
+
+        inline Vector3 evaluate(float d) const;
+
+        /**
+         * Evaluates 'n' thicknesses into planar outputs. The SSE4.2 backend
+         * has no gathers, so it falls back to the scalar one.
+         */
+        void evaluate(const float *d, float *r, float *g, float *b, int n,
+                      BlurPass::Backend backend=BlurPass::BACKEND_AUTO) const;
+
+        /**
+         * The table as a 'resolution' x 1 RGBA texture, ready to be uploaded
+         * as R32G32B32A32_FLOAT (alpha is one).
+         */
+        void getTextureData(std::vector<float> &rgba) const;
+
+        /**
+         * Returns a SSSS_TRANSMITTANCE_PROFILE define (see 'SeparableSSS.h')
+         * that samples the texture above, which must be declared with the
+         * name 'texture' and bound as a SSSSTexture2D.
+         */
+        std::string getShaderCode(const std::string &texture) const;
+
+        /**
+         * Raw table, for inlined lookups: entry 'i' of channel 'c' is
+         * 'table[c * resolution + i]', at 'u = sqrt(d) * scale'.
+         */
+        const float *getTable() const { return &table[0]; }
+        float getScale() const { return scale; }
+
+    private:
+        void evaluateScalar(const float *d, float *r, float *g, float *b, int n) const;
+        void evaluateAVX2(const float *d, float *r, float *g, float *b, int n) const;
+        void evaluateAVX512(const float *d, float *r, float *g, float *b, int n) const;
+
+        int resolution;
+        float range;
+        float scale; // (resolution - 1) / sqrt(range)
+        Vector3 maxError;
+
+        /**
+         * Planar: red entries first, then green and blue.
+         */
+        std::vector<float> table;
+};
+
+
+inline Vector3 TransmittanceLUT::evaluate(float d) const {
+    float u = d > 0.0f? sqrt(d) * scale : 0.0f; // Also catches NaNs
+    u = u < float(resolution - 1)? u : float(resolution - 1);
+    int i = int(u) < resolution - 2? int(u) : resolution - 2;
+    float t = u - float(i);
+
+    const float *r = &table[i], *g = r + resolution, *b = g + resolution;
+    return Vector3(r[0] + t * (r[1] - r[0]),
+                   g[0] + t * (g[1] - g[0]),
+                   b[0] + t * (b[1] - b[0]));
+}
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2012 Jorge Jimenez (jorge@iryoku.com)
+ * Copyright (C) 2012 Diego Gutierrez (diegog@unizar.es)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the following disclaimer
+ *       in the documentation and/or other materials provided with the 
+ *       distribution:
+ *
+ *       "Uses Separable SSS. Copyright (C) 2012 by Jorge Jimenez and Diego
+ *        Gutierrez."
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS 
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are 
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the copyright holders.
+ */
+
+
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+/**
+ * Blocked transposition of images (see 'BlurPass::dstTransposed').
+ */
+class Transpose {
+    public:
+        /**
+         * Size of the square blocks. A block of four-channel floats takes
+         * 16 KB, so that both the source and the destination fit in L1.
+         */
+        static const int BLOCK_SIZE = 32;
+
+        /**
+         * Copies the [x0, x1) x [y0, y1) region of 'src', an image of 'width'
+         * x 'height' pixels of 'channels' elements each, into 'dst', with
+         * pixel (x, y) going to 'x * height + y'.
+         */
+        template <class T>
+        static void run(const T *src, T *dst, int width, int height, int channels,
+                        int x0, int y0, int x1, int y1);
+};
+
+
+template <class T>
+void Transpose::run(const T *src, T *dst, int width, int height, int channels,
+                    int x0, int y0, int x1, int y1) {
+    for (int by = y0; by < y1; by += BLOCK_SIZE) {
+        const int ey = by + BLOCK_SIZE < y1? by + BLOCK_SIZE : y1;
+        for (int bx = x0; bx < x1; bx += BLOCK_SIZE) {
+            const int ex = bx + BLOCK_SIZE < x1? bx + BLOCK_SIZE : x1;
+
+            // Walk the block along the columns of the source, so that the
+            // writes are sequential:
+            for (int x = bx; x < ex; x++) {
+                T *out = dst + channels * (x * height + by);
+                for (int y = by; y < ey; y++) {
+                    const T *in = src + channels * (y * width + x);
+                    for (int c = 0; c < channels; c++)
+                        *out++ = in[c];
+                }
+            }
+        }
+    }
+}
+
+#endif
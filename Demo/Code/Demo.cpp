@@ -42,7 +42,8 @@
 #include <iomanip>
 #include <limits>
 
-#include "Timer.h"
+#include "FrameRecorder.h"
+#include "Profiler.h"
 #include "Camera.h"
 #include "RenderTarget.h"
 #include "ShadowMap.h"
@@ -75,7 +76,7 @@ vector<UINT32> dpdsData;
 bool audioEnabled = true;
 bool audioStarted = false;
 
-Timer *timer;
+ID3D10Query *flushQuery;
 ID3DX10Font *font;
 ID3DX10Sprite *sprite;
 CDXUTTextHelper *txtHelper;
@@ -95,11 +96,7 @@ int scene = 0;
 float sceneTime = 0.0f;
 int currentSkyDome = 0;
 
-float lastTimeMeasured = 0.0f;
-int nFrames = 0;
-int nFramesInverval = 0;
-int minFrames = numeric_limits<int>::max(), maxFrames = numeric_limits<int>::min();
-float introTime = 0.0f;
+FrameRecorder introFrames(1 << 16);
 
 BackbufferRenderTarget *backbufferRT;
 RenderTarget *mainRTMS;
@@ -437,25 +434,32 @@ void renderText() {
 
     wstringstream s;
 
-    if (nFrames > 0) {
+    if (introFrames.getCount() > 0) {
+        FrameRecorder::Stats stats = introFrames.getStats();
         s << setprecision(2) << std::fixed;
-        s << "Min FPS: " << minFrames << endl;
+        s << "Average FPS: " << stats.averageFPS << endl;
         txtHelper->DrawTextLine(s.str().c_str());
 
         s.str(L"");
-        s << "Max FPS: " << maxFrames << endl;
+        s << "1% Low FPS: " << stats.low1FPS << endl;
         txtHelper->DrawTextLine(s.str().c_str());
 
         s.str(L"");
-        s << "Average FPS: " << nFrames / introTime << endl;
+        s << "Frame Time: " << stats.p50 << "ms : p99 " << stats.p99 << "ms : max " << stats.max << "ms" << endl;
         txtHelper->DrawTextLine(s.str().c_str());
 
         txtHelper->DrawTextLine(L"");
     }
 
-    if (timer->isEnabled()) {
+    if (Profiler::get().isEnabled()) {
+        Profiler &profiler = Profiler::get();
         s.str(L"");
-        s << *timer;
+        s << setprecision(2) << std::fixed;
+        for (int i = 0; i < profiler.getZoneCount(); i++) {
+            Profiler::Stats stats = profiler.getStats(i);
+            if (stats.count > 0)
+                s << profiler.getZoneName(i).c_str() << L" : " << stats.mean << L"ms : p95 " << stats.p95 << L"ms : p99 " << stats.p99 << L"ms" << endl;
+        }
         txtHelper->DrawTextLine(s.str().c_str());
     }
 
@@ -463,42 +467,94 @@ void renderText() {
 }
 
 
+void flushGPU() {
+    flushQuery->End();
+
+    BOOL queryData;
+    while (flushQuery->GetData(&queryData, sizeof(BOOL), 0) != S_OK);
+}
+
+
+/**
+ * Profiler zone for GPU work: while profiling, the GPU is flushed when
+ * opening and closing it, so that it measures the commands issued within.
+ */
+class GPUZone {
+    public:
+        GPUZone(int zone) : enabled(Profiler::get().isEnabled()) {
+            if (enabled) {
+                flushGPU();
+                Profiler::get().begin(zone);
+            }
+        }
+
+        ~GPUZone() {
+            if (enabled) {
+                flushGPU();
+                Profiler::get().end();
+            }
+        }
+
+    private:
+        bool enabled;
+};
+
+#define GPU_PROFILE(name) \
+    static const int SSSS_PROFILE_CONCAT(gpuZone, __LINE__) = Profiler::get().getZone(name); \
+    GPUZone SSSS_PROFILE_CONCAT(gpuScope, __LINE__)(SSSS_PROFILE_CONCAT(gpuZone, __LINE__))
+
+
 void renderScene(ID3D10Device *device, double time, float elapsedTime) {
     // Shadow Pass
-    timer->start();
-    shadowPass(device);
-    timer->clock(L"Shadows");
+    {
+        GPU_PROFILE("Shadows");
+        shadowPass(device);
+    }
 
     // Main Pass
-    mainPass(device);
-    timer->clock(L"Main Pass");
+    {
+        GPU_PROFILE("Main Pass");
+        mainPass(device);
+    }
 
     // Subsurface Scattering Pass
-    if (mainHud.GetCheckBox(IDC_SSS)->GetChecked())
-        separableSSS->go(*mainRT, *mainRT, *depthRT, *depthStencil, *specularsRT, 1);
-    timer->clock(L"Skin");
+    {
+        GPU_PROFILE("Skin");
+        if (mainHud.GetCheckBox(IDC_SSS)->GetChecked())
+            separableSSS->go(*mainRT, *mainRT, *depthRT, *depthStencil, *specularsRT, 1);
+    }
 
-    if (mainHud.GetCheckBox(IDC_SEPARATE_SPECULARS)->GetChecked())
-        addSpecular(device, mainRT);
-    timer->clock(L"Separate Speculars");
+    {
+        GPU_PROFILE("Separate Speculars");
+        if (mainHud.GetCheckBox(IDC_SEPARATE_SPECULARS)->GetChecked())
+            addSpecular(device, mainRT);
+    }
 
     // Bloom Pass
-    bloom->go(*mainRT, *tmpRT_SRGB);
-    timer->clock(L"Bloom");
+    {
+        GPU_PROFILE("Bloom");
+        bloom->go(*mainRT, *tmpRT_SRGB);
+    }
     
     // Depth of Field Pass
-    dof->go(*tmpRT_SRGB, *tmpRT_SRGB, *depthRT);
-    timer->clock(L"DoF");
+    {
+        GPU_PROFILE("DoF");
+        dof->go(*tmpRT_SRGB, *tmpRT_SRGB, *depthRT);
+    }
 
     // SMAA Pass
     if (SMAA::Mode(antialiasingMode) == SMAA::MODE_SMAA_T2X) {
+        GPU_PROFILE("SMAA");
         smaaPass(device);
-        timer->clock(L"SMAA");
     }
 
     // Film Grain Pass
-    filmGrain->go(*tmpRT_SRGB, *backbufferRT, 2.5f * float(time));
-    timer->clock(L"Film Grain");
+    {
+        GPU_PROFILE("Film Grain");
+        filmGrain->go(*tmpRT_SRGB, *backbufferRT, 2.5f * float(time));
+    }
+
+    Profiler::get().collect();
 }
 
 
@@ -781,23 +837,19 @@ void CALLBACK onFrameRender(ID3D10Device *device, double time, float elapsedTime
             device->OMSetRenderTargets(1, *backbufferRT, NULL);
             Fade::go(Animation::linear(float(time - tFade), 0.0f, 1.0f, 1.0f, 0.0f));
 
-            // Update counters:
-            nFramesInverval += 1;
-            if (lastTimeMeasured + 1.0f < float(time - t0)) {
-                nFrames += nFramesInverval;
-                minFrames = min(minFrames, nFramesInverval);
-                maxFrames = max(maxFrames, nFramesInverval);
-                lastTimeMeasured = float(time - t0);
-                nFramesInverval = 0;
-            }
+            // Record the frame time:
+            introFrames.record(1000.0 * elapsedTime);
 
             // If the scene or the fade have finished:
             if (finished || float(time - tFade) > 1.0f) {
                // Setup next state:
                state = STATE_SPLASH_OUTRO;
-               introTime = float(time - t0);
                t0 = time;
 
+               // Dump the frame times of the intro, for benchmarking:
+               ofstream file("FrameTimes.csv");
+               introFrames.writeCSV(file);
+
                // Reset the scene:
                reset();
                break;
@@ -941,7 +993,7 @@ void CALLBACK keyboardProc(UINT nChar, bool keydown, bool altdown, void *context
         }
         case 'X':
             mainHud.GetCheckBox(IDC_PROFILE)->SetChecked(!mainHud.GetCheckBox(IDC_PROFILE)->GetChecked());
-            timer->setEnabled(mainHud.GetCheckBox(IDC_PROFILE)->GetChecked());
+            Profiler::get().setEnabled(mainHud.GetCheckBox(IDC_PROFILE)->GetChecked());
             break;
         case '1':
             object = OBJECT_CAMERA;
@@ -1212,7 +1264,7 @@ void CALLBACK onGUIEvent(UINT event, int id, CDXUTControl *control, void *contex
             break;
         case IDC_PROFILE:
             if (event == EVENT_CHECKBOX_CHANGED)
-                timer->setEnabled(mainHud.GetCheckBox(IDC_PROFILE)->GetChecked());
+                Profiler::get().setEnabled(mainHud.GetCheckBox(IDC_PROFILE)->GetChecked());
             break;
         case IDC_SSS: {
             bool sssEnabled = mainHud.GetCheckBox(IDC_SSS)->GetChecked();
@@ -1385,8 +1437,11 @@ HRESULT CALLBACK onCreateDevice(ID3D10Device *device, const DXGI_SURFACE_DESC *d
 
     V_RETURN(dialogResourceManager.OnD3D10CreateDevice(device));
 
-    timer = new Timer(device);
-    timer->setEnabled(mainHud.GetCheckBox(IDC_PROFILE)->GetChecked());
+    D3D10_QUERY_DESC queryDesc;
+    queryDesc.Query = D3D10_QUERY_EVENT;
+    queryDesc.MiscFlags = 0;
+    V_RETURN(device->CreateQuery(&queryDesc, &flushQuery));
+    Profiler::get().setEnabled(mainHud.GetCheckBox(IDC_PROFILE)->GetChecked());
 
     V_RETURN(D3DX10CreateFont(device, 15, 0, FW_BOLD, 1, FALSE, DEFAULT_CHARSET,
                               OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE,
@@ -1463,7 +1518,7 @@ void CALLBACK onDestroyDevice(void *context) {
     dialogResourceManager.OnD3D10DestroyDevice();
     DXUTGetGlobalResourceCache().OnDestroyDevice();
 
-    SAFE_DELETE(timer);
+    SAFE_RELEASE(flushQuery);
     SAFE_RELEASE(font);
     SAFE_RELEASE(sprite);
     SAFE_DELETE(txtHelper);
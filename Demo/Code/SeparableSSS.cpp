@@ -103,7 +103,8 @@ SeparableSSS::SeparableSSS(ID3D10Device *device,
                            nSamples(nSamples),
                            stencilInitialized(stencilInitialized),
                            strength(D3DXVECTOR3(0.48f, 0.41f, 0.28f)),
-                           falloff(D3DXVECTOR3(1.0f, 0.37f, 0.3f)) {
+                           falloff(D3DXVECTOR3(1.0f, 0.37f, 0.3f)),
+                           placement(Kernel::PLACEMENT_POWER) {
     HRESULT hr;
 
     // Setup the defines for compiling the effect:
@@ -169,97 +170,21 @@ SeparableSSS::~SeparableSSS() {
 }
 
 
-D3DXVECTOR3 SeparableSSS::gaussian(float variance, float r) {
-    /**
-     * We use a falloff to modulate the shape of the profile. Big falloffs
-     * spreads the shape making it wider, while small falloffs make it
-     * narrower.
-     */
-    D3DXVECTOR3 g;
-    for (int i = 0; i < 3; i++) {
-        float rr = r / (0.001f + falloff[i]);
-        g[i] = exp((-(rr * rr)) / (2.0f * variance)) / (2.0f * 3.14f * variance);
-    }
-    return g;
-}
-
-
-D3DXVECTOR3 SeparableSSS::profile(float r) {
-    /**
-     * We used the red channel of the original skin profile defined in
-     * [d'Eon07] for all three channels. We noticed it can be used for green
-     * and blue channels (scaled using the falloff parameter) without
-     * introducing noticeable differences and allowing for total control over
-     * the profile. For example, it allows to create blue SSS gradients, which
-     * could be useful in case of rendering blue creatures.
-     */
-    return  // 0.233f * gaussian(0.0064f, r) + /* We consider this one to be directly bounced light, accounted by the strength parameter (see @STRENGTH) */
-               0.100f * gaussian(0.0484f, r) +
-               0.118f * gaussian( 0.187f, r) +
-               0.113f * gaussian( 0.567f, r) +
-               0.358f * gaussian(  1.99f, r) +
-               0.078f * gaussian(  7.41f, r);
-} 
-
-
 void SeparableSSS::calculateKernel() {
     HRESULT hr;
 
-    const float RANGE = nSamples > 20? 3.0f : 2.0f;
-    const float EXPONENT = 2.0f;
+    // The kernel math lives in the portable implementation, which also has
+    // the presets precalculated (when the compiler supports it). Kernels are
+    // cached, as sliders and 'setupSSS' recalculate them all the time:
+    vector<KernelSample> samples;
+    KernelCache::getShared().calculate(samples, nSamples,
+                                       Vector3(strength.x, strength.y, strength.z),
+                                       Vector3(falloff.x, falloff.y, falloff.z),
+                                       placement);
 
     kernel.resize(nSamples);
-
-    // Calculate the offsets:
-    float step = 2.0f * RANGE / (nSamples - 1);
-    for (int i = 0; i < nSamples; i++) {
-        float o = -RANGE + float(i) * step;
-        float sign = o < 0.0f? -1.0f : 1.0f;
-        kernel[i].w = RANGE * sign * abs(pow(o, EXPONENT)) / pow(RANGE, EXPONENT);
-    }
-
-    // Calculate the weights:
-    for (int i = 0; i < nSamples; i++) {
-        float w0 = i > 0? abs(kernel[i].w - kernel[i - 1].w) : 0.0f;
-        float w1 = i < nSamples - 1? abs(kernel[i].w - kernel[i + 1].w) : 0.0f;
-        float area = (w0 + w1) / 2.0f;
-        D3DXVECTOR3 t = area * profile(kernel[i].w);
-        kernel[i].x = t.x;
-        kernel[i].y = t.y;
-        kernel[i].z = t.z;
-    }
-
-    // We want the offset 0.0 to come first:
-    D3DXVECTOR4 t = kernel[nSamples / 2];
-    for (int i = nSamples / 2; i > 0; i--)
-        kernel[i] = kernel[i - 1];
-    kernel[0] = t;
-    
-    // Calculate the sum of the weights, we will need to normalize them below:
-    D3DXVECTOR3 sum = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
     for (int i = 0; i < nSamples; i++)
-        sum += D3DXVECTOR3(kernel[i]);
-
-    // Normalize the weights:
-    for (int i = 0; i < nSamples; i++) {
-        kernel[i].x /= sum.x;
-        kernel[i].y /= sum.y;
-        kernel[i].z /= sum.z;
-    }
-
-    // Tweak them using the desired strength. The first one is:
-    //     lerp(1.0, kernel[0].rgb, strength)
-    kernel[0].x = (1.0f - strength.x) * 1.0f + strength.x * kernel[0].x;
-    kernel[0].y = (1.0f - strength.y) * 1.0f + strength.y * kernel[0].y;
-    kernel[0].z = (1.0f - strength.z) * 1.0f + strength.z * kernel[0].z;
-
-    // The others:
-    //     lerp(0.0, kernel[0].rgb, strength)
-    for (int i = 1; i < nSamples; i++) {
-        kernel[i].x *= strength.x;
-        kernel[i].y *= strength.y;
-        kernel[i].z *= strength.z;
-    }
+        kernel[i] = D3DXVECTOR4(samples[i].r, samples[i].g, samples[i].b, samples[i].offset);
 
     // Finally, set 'em!
     V(kernelVariable->SetFloatVectorArray((float *) &kernel.front(), 0, nSamples));
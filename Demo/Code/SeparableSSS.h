@@ -43,6 +43,8 @@
 #include <d3d10.h>
 #include <d3dx10.h>
 #include <dxerr.h>
+#include "Kernel.h"
+#include "KernelCache.h"
 
 class SeparableSSS {
     public:
@@ -154,6 +156,17 @@ class SeparableSSS {
         void setFalloff(D3DXVECTOR3 falloff) { this->falloff = falloff; calculateKernel(); }
         D3DXVECTOR3 getFalloff() const { return falloff; }
 
+        /**
+         * This parameter selects how the samples of the kernel are placed.
+         * By default they follow a fixed power curve, but they can also be
+         * importance sampled from the profile, which packs them where it
+         * carries most of its energy (see 'Kernel::Placement' in the CPU
+         * directory). Importance sampling usually needs fewer samples for
+         * the same quality ('Kernel::measure' can be used to check it).
+         */
+        void setKernelPlacement(Kernel::Placement placement) { this->placement = placement; calculateKernel(); }
+        Kernel::Placement getKernelPlacement() const { return placement; }
+
         /**
          * This one is just for convenience, it returns the shader code of
          * current kernel.
@@ -161,8 +174,6 @@ class SeparableSSS {
         std::string getKernelCode() const;
 
     private:
-        D3DXVECTOR3 gaussian(float variance, float r);
-        D3DXVECTOR3 profile(float r);
         void calculateKernel();
 
         ID3D10Device *device;
@@ -172,6 +183,7 @@ class SeparableSSS {
         bool stencilInitialized;
         D3DXVECTOR3 strength;
         D3DXVECTOR3 falloff;
+        Kernel::Placement placement;
 
         ID3D10Effect *effect;
         RenderTarget *tmpRT;
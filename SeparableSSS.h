@@ -118,6 +118,13 @@
 #define SSSS_STREGTH_SOURCE (colorM.a)
 #endif
 
+/**
+ * SSSS_TRANSMITTANCE_PROFILE(dd) allows to replace the skin transmittance
+ * profile of 'SSSSTransmittance' by a custom one, given 'dd = -d * d' (see
+ * 'Profile::getTransmittanceCode' in the CPU directory, which writes it for
+ * profiles fitted to measured data).
+ */
+
 /**
  * If SSSS_N_SAMPLES is defined at this point, a custom filter kernel must be
  * set by the runtime.
@@ -133,8 +140,10 @@ float4 kernel[SSSS_N_SAMPLES];
 /**
  * Here you have ready-to-use kernels for quickstarters. Three kernels are 
  * readily available, with varying quality.
- * To create new kernels take a look into SSS::calculateKernel, or simply
- * push CTRL+C in the demo to copy the customized kernel into the clipboard.
+ * To create new kernels take a look into KernelGenerator.h in the CPU
+ * directory, or simply push CTRL+C in the demo to copy the customized kernel
+ * into the clipboard. The KernelCode tool checks these ones against the
+ * generator.
  *
  * Note: these preset kernels are not used by the demo. They are calculated on
  * the fly depending on the selected values in the interface, by directly using
@@ -345,15 +354,20 @@ float3 SSSSTransmittance(
     /**
      * Armed with the thickness, we can now calculate the color by means of the
      * precalculated transmittance profile.
-     * (It can be precomputed into a texture, for maximum performance):
+     * (It can be precomputed into a texture, for maximum performance; see
+     * 'TransmittanceLUT::getShaderCode' in the CPU directory):
      */
     float dd = -d * d;
+    #ifdef SSSS_TRANSMITTANCE_PROFILE
+    float3 profile = SSSS_TRANSMITTANCE_PROFILE(dd);
+    #else
     float3 profile = float3(0.233, 0.455, 0.649) * exp(dd / 0.0064) +
                      float3(0.1,   0.336, 0.344) * exp(dd / 0.0484) +
                      float3(0.118, 0.198, 0.0)   * exp(dd / 0.187)  +
                      float3(0.113, 0.007, 0.007) * exp(dd / 0.567)  +
                      float3(0.358, 0.004, 0.0)   * exp(dd / 1.99)   +
                      float3(0.078, 0.0,   0.0)   * exp(dd / 7.41);
+    #endif
 
     /** 
      * Using the profile, we finally approximate the transmitted lighting from